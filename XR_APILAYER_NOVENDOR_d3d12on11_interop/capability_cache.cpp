@@ -0,0 +1,169 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "capability_cache.h"
+#include "log.h"
+
+namespace {
+
+    enum CapabilityFlags : uint32_t {
+        ImportTested = 1,
+        Importable = 2,
+    };
+
+    // Lookups probe a few entries after the one designated by the key.
+    constexpr size_t MaxProbes = 8;
+
+    uint64_t Fnv1a(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 0x100000001b3;
+        }
+        return hash;
+    }
+
+    template <typename T>
+    uint64_t Fnv1a(const T& value, uint64_t hash) {
+        return Fnv1a(&value, sizeof(value), hash);
+    }
+
+} // namespace
+
+namespace d3d12on11_interop {
+
+    using namespace d3d12on11_interop::log;
+
+    CapabilityCache::CapabilityCache(const std::filesystem::path& path) {
+        m_file.reset(CreateFileW(path.c_str(),
+                                 GENERIC_READ | GENERIC_WRITE,
+                                 FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                 nullptr,
+                                 OPEN_ALWAYS,
+                                 FILE_ATTRIBUTE_NORMAL,
+                                 nullptr));
+        if (!m_file) {
+            Log("Failed to open the capability cache: %d\n", GetLastError());
+            return;
+        }
+
+        // The file is grown to the size of the mapping if needed, with zeroes (empty entries).
+        m_mapping.reset(CreateFileMappingW(m_file.get(), nullptr, PAGE_READWRITE, 0, sizeof(File), nullptr));
+        if (!m_mapping) {
+            Log("Failed to map the capability cache: %d\n", GetLastError());
+            return;
+        }
+        m_view = reinterpret_cast<File*>(MapViewOfFile(m_mapping.get(), FILE_MAP_ALL_ACCESS, 0, 0, sizeof(File)));
+        if (!m_view) {
+            Log("Failed to map the capability cache: %d\n", GetLastError());
+            return;
+        }
+
+        if (m_view->magic != Magic || m_view->version != Version) {
+            ZeroMemory(m_view->entries, sizeof(m_view->entries));
+            m_view->version = Version;
+            m_view->magic = Magic;
+        }
+    }
+
+    CapabilityCache::~CapabilityCache() {
+        if (m_view) {
+            UnmapViewOfFile(m_view);
+        }
+    }
+
+    std::optional<Capabilities> CapabilityCache::lookup(uint64_t key) const {
+        if (!m_view || !key) {
+            return {};
+        }
+
+        for (size_t i = 0; i < MaxProbes; i++) {
+            const volatile Entry& slot = m_view->entries[(key + i) % EntryCount];
+            if (slot.key != key) {
+                continue;
+            }
+
+            // Another process might be writing the entry, so we check the key again after reading.
+            Entry entry;
+            memcpy(&entry, const_cast<const Entry*>(&slot), sizeof(entry));
+            if (slot.key != key || entry.key != key) {
+                break;
+            }
+
+            return Capabilities{
+                entry.desc, entry.imageCount, !!(entry.flags & ImportTested), !!(entry.flags & Importable)};
+        }
+
+        return {};
+    }
+
+    void CapabilityCache::store(uint64_t key, const Capabilities& capabilities) {
+        if (!m_view || !key) {
+            return;
+        }
+
+        // Reuse the entry for the key, or an empty one. When all the probed entries are used, evict the first one.
+        volatile Entry* slot = &m_view->entries[key % EntryCount];
+        for (size_t i = 0; i < MaxProbes; i++) {
+            volatile Entry& candidate = m_view->entries[(key + i) % EntryCount];
+            if (candidate.key == key || !candidate.key) {
+                slot = &candidate;
+                break;
+            }
+        }
+
+        // Publish the key last.
+        slot->key = 0;
+        MemoryBarrier();
+        Entry entry{};
+        entry.flags = (capabilities.importTested ? ImportTested : 0) | (capabilities.importable ? Importable : 0);
+        entry.imageCount = capabilities.imageCount;
+        entry.desc = capabilities.desc;
+        memcpy(const_cast<Entry*>(slot), &entry, sizeof(entry));
+        MemoryBarrier();
+        slot->key = key;
+    }
+
+    uint64_t CapabilityCache::MakeKey(const std::string& runtimeName, const LUID& adapterLuid, int64_t driverVersion) {
+        uint64_t hash = Fnv1a(runtimeName.data(), runtimeName.size());
+        hash = Fnv1a(adapterLuid, hash);
+        return Fnv1a(driverVersion, hash);
+    }
+
+    uint64_t CapabilityCache::MakeKey(uint64_t sessionKey, const XrSwapchainCreateInfo& createInfo) {
+        uint64_t hash = Fnv1a(sessionKey, 0xcbf29ce484222325);
+        hash = Fnv1a(createInfo.createFlags, hash);
+        hash = Fnv1a(createInfo.usageFlags, hash);
+        hash = Fnv1a(createInfo.format, hash);
+        hash = Fnv1a(createInfo.sampleCount, hash);
+        hash = Fnv1a(createInfo.width, hash);
+        hash = Fnv1a(createInfo.height, hash);
+        hash = Fnv1a(createInfo.faceCount, hash);
+        hash = Fnv1a(createInfo.arraySize, hash);
+        hash = Fnv1a(createInfo.mipCount, hash);
+
+        // 0 denotes an empty entry.
+        return hash ? hash : 1;
+    }
+
+} // namespace d3d12on11_interop
@@ -0,0 +1,86 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace d3d12on11_interop {
+
+    // What the runtime and the driver were found to support for a swapchain descriptor.
+    struct Capabilities {
+        // The runtime texture descriptor returned by xrEnumerateSwapchainImages().
+        D3D11_TEXTURE2D_DESC desc;
+        uint32_t imageCount;
+
+        // Whether the runtime textures could be imported in Direct3D 12 despite not being shareable (only valid when
+        // importTested is set).
+        bool importTested;
+        bool importable;
+    };
+
+    // A persistent cache of the capabilities, shared between all the processes through a memory-mapped file. The
+    // entries are keyed by a hash of the runtime, the adapter, the driver and the swapchain descriptor, so a change
+    // in any of them simply misses the cache.
+    class CapabilityCache {
+      public:
+        explicit CapabilityCache(const std::filesystem::path& path);
+        ~CapabilityCache();
+
+        bool isValid() const {
+            return m_view != nullptr;
+        }
+
+        std::optional<Capabilities> lookup(uint64_t key) const;
+        void store(uint64_t key, const Capabilities& capabilities);
+
+        // Key for a runtime on an adapter.
+        static uint64_t MakeKey(const std::string& runtimeName, const LUID& adapterLuid, int64_t driverVersion);
+
+        // Key for a swapchain descriptor, derived from the key above.
+        static uint64_t MakeKey(uint64_t sessionKey, const XrSwapchainCreateInfo& createInfo);
+
+      private:
+        struct Entry {
+            // A key of 0 is an empty entry.
+            uint64_t key;
+            uint32_t flags;
+            uint32_t imageCount;
+            D3D11_TEXTURE2D_DESC desc;
+        };
+
+        static constexpr uint32_t Magic = 0x50414358; // 'XCAP'
+        static constexpr uint32_t Version = 1;
+        static constexpr size_t EntryCount = 256;
+
+        struct File {
+            uint32_t magic;
+            uint32_t version;
+            Entry entries[EntryCount];
+        };
+
+        wil::unique_hfile m_file;
+        wil::unique_handle m_mapping;
+        File* m_view{nullptr};
+    };
+
+} // namespace d3d12on11_interop
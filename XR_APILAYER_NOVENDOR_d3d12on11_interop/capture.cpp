@@ -0,0 +1,240 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "capture.h"
+
+namespace d3d12on11_interop::capture {
+    std::atomic<bool> g_enabled{false};
+    thread_local int64_t t_downstreamTime = 0;
+
+    namespace {
+
+        // File format (all values are little-endian):
+        //   header: char[8] magic, uint32_t version, uint32_t reserved, int64_t ticksPerSecond
+        //   records, each starting with a one byte tag:
+        //     'N': uint16_t apiId, uint16_t length, char[length] apiName
+        //     'C': uint16_t apiId, uint32_t threadId, int32_t result, int64_t start, int64_t end,
+        //          int64_t downstream, uint32_t payloadSize, uint8_t[payloadSize] payload
+        // The downstream time (version 2 and later) is the part of the call spent in the next layer or the runtime.
+        constexpr char Magic[8] = {'X', 'R', 'C', 'A', 'P', 'T', 'U', 'R'};
+        constexpr uint32_t Version = 2;
+        constexpr uint8_t NameTag = 'N';
+        constexpr uint8_t CallTag = 'C';
+
+        // How much data to accumulate before writing to the file.
+        constexpr size_t FlushThreshold = 64 * 1024;
+
+        std::mutex g_mutex;
+        std::ofstream g_file;
+        std::vector<uint8_t> g_pending;
+        std::unordered_map<std::string_view, uint16_t> g_apiIds;
+
+        // The arguments for the call being recorded on this thread.
+        thread_local std::vector<uint8_t> t_payload;
+
+        template <typename T>
+        void Append(std::vector<uint8_t>& buffer, const T& value) {
+            const auto bytes = reinterpret_cast<const uint8_t*>(&value);
+            buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+        }
+
+        // Must be called with the mutex held.
+        void InternalFlush() {
+            if (g_file.is_open() && !g_pending.empty()) {
+                g_file.write(reinterpret_cast<const char*>(g_pending.data()), g_pending.size());
+                g_file.flush();
+            }
+            g_pending.clear();
+        }
+
+        // Must be called with the mutex held.
+        uint16_t GetApiId(const char* apiName) {
+            const auto it = g_apiIds.find(apiName);
+            if (it != g_apiIds.cend()) {
+                return it->second;
+            }
+
+            // First occurrence of this API: emit its definition.
+            const uint16_t apiId = (uint16_t)g_apiIds.size();
+            g_apiIds.insert_or_assign(apiName, apiId);
+
+            const std::string_view name(apiName);
+            Append(g_pending, NameTag);
+            Append(g_pending, apiId);
+            Append(g_pending, (uint16_t)name.size());
+            g_pending.insert(g_pending.end(), name.begin(), name.end());
+
+            return apiId;
+        }
+
+    } // namespace
+
+    void Start(const std::filesystem::path& path) {
+        std::unique_lock lock(g_mutex);
+
+        if (g_file.is_open()) {
+            return;
+        }
+
+        g_file.open(path, std::ios_base::binary | std::ios_base::app);
+        if (!g_file.is_open()) {
+            return;
+        }
+
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+
+        g_pending.clear();
+        g_apiIds.clear();
+        g_pending.insert(g_pending.end(), std::begin(Magic), std::end(Magic));
+        Append(g_pending, Version);
+        Append(g_pending, (uint32_t)0);
+        Append(g_pending, (int64_t)frequency.QuadPart);
+        InternalFlush();
+
+        g_enabled = true;
+    }
+
+    void Flush() {
+        std::unique_lock lock(g_mutex);
+        InternalFlush();
+    }
+
+    void Stop() {
+        std::unique_lock lock(g_mutex);
+
+        g_enabled = false;
+        InternalFlush();
+        g_file.close();
+    }
+
+    Record::Record(const char* apiName, const Timestamp& start, XrResult result)
+        : m_apiName(apiName), m_startTime(start.time), m_endTime(Now()),
+          m_downstreamTime(t_downstreamTime - start.downstreamTime), m_result(result) {
+        t_payload.clear();
+    }
+
+    Record::~Record() {
+        std::unique_lock lock(g_mutex);
+
+        if (!g_file.is_open()) {
+            return;
+        }
+
+        // The name of the API must be defined before the record referencing it.
+        const uint16_t apiId = GetApiId(m_apiName);
+        Append(g_pending, CallTag);
+        Append(g_pending, apiId);
+        Append(g_pending, (uint32_t)GetCurrentThreadId());
+        Append(g_pending, (int32_t)m_result);
+        Append(g_pending, m_startTime);
+        Append(g_pending, m_endTime);
+        Append(g_pending, m_downstreamTime);
+        Append(g_pending, (uint32_t)t_payload.size());
+        g_pending.insert(g_pending.end(), t_payload.begin(), t_payload.end());
+
+        if (g_pending.size() >= FlushThreshold) {
+            InternalFlush();
+        }
+    }
+
+    void Record::write(const void* data, size_t size) {
+        const auto bytes = reinterpret_cast<const uint8_t*>(data);
+        t_payload.insert(t_payload.end(), bytes, bytes + size);
+    }
+
+    Record& Record::operator<<(XrInstance handle) {
+        return *this << (uint64_t)handle;
+    }
+
+    Record& Record::operator<<(XrSession handle) {
+        return *this << (uint64_t)handle;
+    }
+
+    Record& Record::operator<<(XrSwapchain handle) {
+        return *this << (uint64_t)handle;
+    }
+
+    Record& Record::operator<<(const XrSession* session) {
+        return *this << (session ? *session : XR_NULL_HANDLE);
+    }
+
+    Record& Record::operator<<(const XrSwapchain* swapchain) {
+        return *this << (swapchain ? *swapchain : XR_NULL_HANDLE);
+    }
+
+    Record& Record::operator<<(const XrSystemId* systemId) {
+        return *this << (systemId ? *systemId : XR_NULL_SYSTEM_ID);
+    }
+
+    Record& Record::operator<<(const uint32_t* value) {
+        return *this << (value ? *value : 0u);
+    }
+
+    Record& Record::operator<<(const XrSwapchainCreateInfo* createInfo) {
+        *this << (uint8_t)(createInfo != nullptr);
+        if (createInfo) {
+            *this << createInfo->createFlags << createInfo->usageFlags << createInfo->format
+                  << createInfo->sampleCount << createInfo->width << createInfo->height << createInfo->faceCount
+                  << createInfo->arraySize << createInfo->mipCount;
+        }
+        return *this;
+    }
+
+    Record& Record::operator<<(const XrFrameEndInfo* frameEndInfo) {
+        const auto writeSubImage = [&](const XrSwapchainSubImage& subImage) {
+            *this << subImage.swapchain << subImage.imageRect.offset.x << subImage.imageRect.offset.y
+                  << subImage.imageRect.extent.width << subImage.imageRect.extent.height << subImage.imageArrayIndex;
+        };
+
+        *this << (uint8_t)(frameEndInfo != nullptr);
+        if (frameEndInfo) {
+            *this << frameEndInfo->displayTime << frameEndInfo->environmentBlendMode << frameEndInfo->layerCount;
+            for (uint32_t i = 0; i < frameEndInfo->layerCount; i++) {
+                const XrCompositionLayerBaseHeader* layer = frameEndInfo->layers[i];
+                *this << layer->type << layer->layerFlags << (uint64_t)layer->space;
+
+                if (layer->type == XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
+                    const XrCompositionLayerProjection* projection =
+                        reinterpret_cast<const XrCompositionLayerProjection*>(layer);
+                    *this << projection->viewCount;
+                    for (uint32_t view = 0; view < projection->viewCount; view++) {
+                        writeSubImage(projection->views[view].subImage);
+                    }
+                } else if (layer->type == XR_TYPE_COMPOSITION_LAYER_QUAD) {
+                    const XrCompositionLayerQuad* quad = reinterpret_cast<const XrCompositionLayerQuad*>(layer);
+                    *this << quad->eyeVisibility;
+                    writeSubImage(quad->subImage);
+                    *this << quad->size.width << quad->size.height;
+                }
+            }
+        }
+        return *this;
+    }
+
+    Record& Record::operator<<(const void* ptr) {
+        return *this << (uint8_t)(ptr != nullptr);
+    }
+
+} // namespace d3d12on11_interop::capture
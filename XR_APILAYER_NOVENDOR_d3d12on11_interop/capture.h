@@ -0,0 +1,123 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace d3d12on11_interop::capture {
+
+    // Whether the capture of OpenXR calls is active. Kept inline since it is tested on every intercepted call.
+    extern std::atomic<bool> g_enabled;
+    inline bool IsEnabled() {
+        return g_enabled.load(std::memory_order_relaxed);
+    }
+
+    // Begin capturing to the specified file. The file is append-only and written in a compact binary format. See
+    // scripts/capture_report.py for the decoder.
+    void Start(const std::filesystem::path& path);
+
+    // Write any buffered data to the file.
+    void Flush();
+
+    // Stop capturing and close the file.
+    void Stop();
+
+    // The timestamp used for the capture (in QueryPerformanceCounter() ticks).
+    inline int64_t Now() {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return counter.QuadPart;
+    }
+
+    // The time spent by this thread in the calls to the next layer or the runtime (in ticks).
+    extern thread_local int64_t t_downstreamTime;
+
+    // The start of an intercepted call, used to separate the time spent in the layer from the time spent downstream.
+    struct Timestamp {
+        int64_t time{0};
+        int64_t downstreamTime{0};
+    };
+
+    inline Timestamp Begin() {
+        return {Now(), t_downstreamTime};
+    }
+
+    // Account the duration of a call to the next layer or the runtime, for the duration of its scope.
+    class DownstreamCall {
+      public:
+        DownstreamCall() : m_startTime(IsEnabled() ? Now() : 0) {
+        }
+
+        ~DownstreamCall() {
+            if (m_startTime) {
+                t_downstreamTime += Now() - m_startTime;
+            }
+        }
+
+      private:
+        const int64_t m_startTime;
+    };
+
+    // A single captured call. The arguments are serialized with the << operator, and the record is committed to the
+    // capture file upon destruction. The time spent downstream since the start of the call is recorded separately.
+    class Record {
+      public:
+        Record(const char* apiName, const Timestamp& start, XrResult result);
+        ~Record();
+
+        // Scalar values are stored as-is.
+        template <typename T>
+        std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>, Record&> operator<<(T value) {
+            write(&value, sizeof(value));
+            return *this;
+        }
+
+        // Handles are stored as their 64-bit value.
+        Record& operator<<(XrInstance handle);
+        Record& operator<<(XrSession handle);
+        Record& operator<<(XrSwapchain handle);
+
+        // Output values are stored as returned by the call.
+        Record& operator<<(const XrSession* session);
+        Record& operator<<(const XrSwapchain* swapchain);
+        Record& operator<<(const XrSystemId* systemId);
+        Record& operator<<(const uint32_t* value);
+
+        // The structure chains that matter for performance analysis are stored in details.
+        Record& operator<<(const XrSwapchainCreateInfo* createInfo);
+        Record& operator<<(const XrFrameEndInfo* frameEndInfo);
+
+        // Any other structure is stored as a presence flag.
+        Record& operator<<(const void* ptr);
+
+      private:
+        void write(const void* data, size_t size);
+
+        const char* const m_apiName;
+        const int64_t m_startTime;
+        const int64_t m_endTime;
+        const int64_t m_downstreamTime;
+        const XrResult m_result;
+    };
+
+} // namespace d3d12on11_interop::capture
@@ -0,0 +1,79 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "copy_engine.h"
+
+namespace d3d12on11_interop {
+
+    std::vector<SubresourceCopy> ComputeSubresourceCopies(UINT arraySize,
+                                                          UINT mipCount,
+                                                          UINT destinationMipLevels,
+                                                          UINT sourceMipLevels) {
+        std::vector<SubresourceCopy> copies;
+        mipCount = (std::min)({mipCount, destinationMipLevels, sourceMipLevels});
+        copies.reserve(arraySize * mipCount);
+        for (UINT slice = 0; slice < arraySize; slice++) {
+            for (UINT mip = 0; mip < mipCount; mip++) {
+                copies.push_back({D3D11CalcSubresource(mip, slice, destinationMipLevels),
+                                  D3D11CalcSubresource(mip, slice, sourceMipLevels)});
+            }
+        }
+        return copies;
+    }
+
+    D3D11CopyEngine::D3D11CopyEngine(const XrSwapchainCreateInfo& createInfo,
+                                     const D3D11_TEXTURE2D_DESC& destinationDesc,
+                                     const D3D11_TEXTURE2D_DESC& sourceDesc) {
+        const UINT arraySize = createInfo.arraySize * createInfo.faceCount;
+
+        // The runtime may allocate more than the app requested, in which case we only copy what the app can see.
+        m_wholeResource = destinationDesc.Width == sourceDesc.Width && destinationDesc.Height == sourceDesc.Height &&
+                          destinationDesc.Format == sourceDesc.Format &&
+                          destinationDesc.SampleDesc.Count == sourceDesc.SampleDesc.Count &&
+                          destinationDesc.ArraySize == sourceDesc.ArraySize &&
+                          destinationDesc.MipLevels == sourceDesc.MipLevels && destinationDesc.ArraySize == arraySize &&
+                          destinationDesc.MipLevels == createInfo.mipCount;
+
+        if (!m_wholeResource) {
+            const UINT copyArraySize = (std::min)({arraySize, destinationDesc.ArraySize, sourceDesc.ArraySize});
+            m_copies = ComputeSubresourceCopies(
+                copyArraySize, createInfo.mipCount, destinationDesc.MipLevels, sourceDesc.MipLevels);
+        }
+    }
+
+    void D3D11CopyEngine::copy(ID3D11DeviceContext* context,
+                               ID3D11Texture2D* destination,
+                               ID3D11Texture2D* source) const {
+        if (m_wholeResource) {
+            context->CopyResource(destination, source);
+            return;
+        }
+
+        for (const auto& [destinationSubresource, sourceSubresource] : m_copies) {
+            context->CopySubresourceRegion(
+                destination, destinationSubresource, 0, 0, 0, source, sourceSubresource, nullptr);
+        }
+    }
+
+} // namespace d3d12on11_interop
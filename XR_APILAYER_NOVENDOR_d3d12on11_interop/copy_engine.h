@@ -0,0 +1,63 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace d3d12on11_interop {
+
+    // A subresource copy, as (destination subresource, source subresource).
+    using SubresourceCopy = std::pair<UINT, UINT>;
+
+    // Compute the subresources to copy for a swapchain with the given array size (including cube faces) and mip
+    // count, between two textures with the given number of mip levels.
+    std::vector<SubresourceCopy> ComputeSubresourceCopies(UINT arraySize,
+                                                          UINT mipCount,
+                                                          UINT destinationMipLevels,
+                                                          UINT sourceMipLevels);
+
+    // Copies the intermediate textures into the runtime textures on the D3D11 context. The copies are planned once
+    // for the swapchain: a single CopyResource() when the whole resource is needed, otherwise one copy per
+    // subresource.
+    class D3D11CopyEngine {
+      public:
+        D3D11CopyEngine(const XrSwapchainCreateInfo& createInfo,
+                        const D3D11_TEXTURE2D_DESC& destinationDesc,
+                        const D3D11_TEXTURE2D_DESC& sourceDesc);
+
+        void copy(ID3D11DeviceContext* context, ID3D11Texture2D* destination, ID3D11Texture2D* source) const;
+
+        bool isWholeResource() const {
+            return m_wholeResource;
+        }
+
+        const std::vector<SubresourceCopy>& getCopies() const {
+            return m_copies;
+        }
+
+      private:
+        bool m_wholeResource;
+        std::vector<SubresourceCopy> m_copies;
+    };
+
+} // namespace d3d12on11_interop
@@ -0,0 +1,315 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "cross_adapter.h"
+#include "log.h"
+
+namespace d3d12on11_interop {
+
+    using namespace d3d12on11_interop::log;
+
+    CrossAdapterTransfer::CrossAdapterTransfer(ID3D12Device* appDevice,
+                                               ID3D12CommandQueue* appQueue,
+                                               IDXGIAdapter1* runtimeAdapter,
+                                               ID3D11Device5* runtimeDevice,
+                                               ID3D11DeviceContext4* runtimeContext,
+                                               uint32_t depth)
+        : m_appDevice(appDevice), m_appQueue(appQueue), m_runtimeContext(runtimeContext) {
+        CHECK_HRCMD(D3D12CreateDevice(
+            runtimeAdapter, D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(m_runtimeDevice.ReleaseAndGetAddressOf())));
+
+        D3D12_COMMAND_QUEUE_DESC queueDesc{};
+        queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+        CHECK_HRCMD(
+            m_runtimeDevice->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(m_runtimeQueue.ReleaseAndGetAddressOf())));
+
+        {
+            CHECK_HRCMD(
+                m_appDevice->CreateFence(0,
+                                         D3D12_FENCE_FLAG_SHARED | D3D12_FENCE_FLAG_SHARED_CROSS_ADAPTER,
+                                         IID_PPV_ARGS(m_writtenFence.ReleaseAndGetAddressOf())));
+            wil::unique_handle fenceHandle;
+            CHECK_HRCMD(m_appDevice->CreateSharedHandle(
+                m_writtenFence.Get(), nullptr, GENERIC_ALL, nullptr, fenceHandle.put()));
+            CHECK_HRCMD(m_runtimeDevice->OpenSharedHandle(
+                fenceHandle.get(), IID_PPV_ARGS(m_runtimeWrittenFence.ReleaseAndGetAddressOf())));
+        }
+
+        {
+            CHECK_HRCMD(
+                m_runtimeDevice->CreateFence(0,
+                                             D3D12_FENCE_FLAG_SHARED | D3D12_FENCE_FLAG_SHARED_CROSS_ADAPTER,
+                                             IID_PPV_ARGS(m_readFence.ReleaseAndGetAddressOf())));
+            wil::unique_handle fenceHandle;
+            CHECK_HRCMD(m_runtimeDevice->CreateSharedHandle(
+                m_readFence.Get(), nullptr, GENERIC_ALL, nullptr, fenceHandle.put()));
+            CHECK_HRCMD(runtimeDevice->OpenSharedFence(fenceHandle.get(),
+                                                       IID_PPV_ARGS(m_d3d11ReadFence.ReleaseAndGetAddressOf())));
+        }
+        *m_event.put() = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+
+        m_slots.resize((std::max)(depth, 2u));
+
+        // Not all copy queues support timestamps.
+        D3D12_FEATURE_DATA_D3D12_OPTIONS3 options{};
+        if (SUCCEEDED(m_runtimeDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS3, &options, sizeof(options))) &&
+            options.CopyQueueTimestampQueriesSupported) {
+            D3D12_QUERY_HEAP_DESC queryHeapDesc{};
+            queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_COPY_QUEUE_TIMESTAMP;
+            queryHeapDesc.Count = (UINT)m_slots.size() * 2;
+            CHECK_HRCMD(m_runtimeDevice->CreateQueryHeap(&queryHeapDesc,
+                                                         IID_PPV_ARGS(m_queryHeap.ReleaseAndGetAddressOf())));
+
+            D3D12_HEAP_PROPERTIES heapProperties{};
+            heapProperties.Type = D3D12_HEAP_TYPE_READBACK;
+            D3D12_RESOURCE_DESC bufferDesc{};
+            bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+            bufferDesc.Width = queryHeapDesc.Count * sizeof(uint64_t);
+            bufferDesc.Height = bufferDesc.DepthOrArraySize = bufferDesc.MipLevels = 1;
+            bufferDesc.SampleDesc.Count = 1;
+            bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+            CHECK_HRCMD(m_runtimeDevice->CreateCommittedResource(
+                &heapProperties,
+                D3D12_HEAP_FLAG_NONE,
+                &bufferDesc,
+                D3D12_RESOURCE_STATE_COPY_DEST,
+                nullptr,
+                IID_PPV_ARGS(m_queryReadback.ReleaseAndGetAddressOf())));
+            CHECK_HRCMD(m_runtimeQueue->GetTimestampFrequency(&m_timestampFrequency));
+        }
+
+        Log("Using cross-adapter transfers (%zu staging buffers, %s)\n",
+            m_slots.size(),
+            m_queryHeap ? "timed" : "not timed");
+    }
+
+    ComPtr<ID3D12Resource> CrossAdapterTransfer::importTexture(ID3D11Texture2D* texture) {
+        ComPtr<IDXGIResource1> dxgiResource;
+        CHECK_HRCMD(texture->QueryInterface(IID_PPV_ARGS(dxgiResource.ReleaseAndGetAddressOf())));
+
+        // KMT handles must not be closed.
+        HANDLE textureHandle = nullptr;
+        CHECK_HRCMD(dxgiResource->GetSharedHandle(&textureHandle));
+
+        ComPtr<ID3D12Resource> resource;
+        CHECK_HRCMD(m_runtimeDevice->OpenSharedHandle(textureHandle, IID_PPV_ARGS(resource.ReleaseAndGetAddressOf())));
+
+        return resource;
+    }
+
+    void CrossAdapterTransfer::transfer(ID3D12Resource* source,
+                                        D3D12_RESOURCE_STATES sourceState,
+                                        ID3D12Resource* destination) {
+        const auto desc = source->GetDesc();
+        D3D12_FEATURE_DATA_FORMAT_INFO formatInfo{desc.Format};
+        if (FAILED(m_appDevice->CheckFeatureSupport(D3D12_FEATURE_FORMAT_INFO, &formatInfo, sizeof(formatInfo)))) {
+            formatInfo.PlaneCount = 1;
+        }
+        const UINT subresourceCount = desc.MipLevels * desc.DepthOrArraySize * formatInfo.PlaneCount;
+        std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprints(subresourceCount);
+        UINT64 size = 0;
+        m_appDevice->GetCopyableFootprints(&desc, 0, subresourceCount, 0, footprints.data(), nullptr, nullptr, &size);
+
+        // Wait for the slot to be free. This only blocks when the runtime's adapter is several frames late.
+        const size_t index = m_nextSlot;
+        auto& slot = m_slots[index];
+        if (slot.pending) {
+            if (m_readFence->GetCompletedValue() < slot.fenceValue) {
+                // Wait in bounded steps, so that a runtime that stopped reading the images shows in the log.
+                const auto start = std::chrono::steady_clock::now();
+                CHECK_HRCMD(m_readFence->SetEventOnCompletion(slot.fenceValue, m_event.get()));
+                while (WaitForSingleObject(m_event.get(), 1000) == WAIT_TIMEOUT) {
+                    Log("Still waiting for a cross-adapter staging buffer after %.0f ms\n",
+                        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                }
+                m_stats.stalls++;
+            }
+            retireSlot(slot, index);
+        }
+        if (slot.size < size) {
+            allocateBuffers(slot, size);
+        }
+        m_nextSlot = (m_nextSlot + 1) % m_slots.size();
+
+        // On the app's adapter, copy the texture into the staging buffer after the app's rendering.
+        if (!slot.appAllocator) {
+            CHECK_HRCMD(m_appDevice->CreateCommandAllocator(
+                m_appQueue->GetDesc().Type, IID_PPV_ARGS(slot.appAllocator.ReleaseAndGetAddressOf())));
+            CHECK_HRCMD(m_appDevice->CreateCommandList(0,
+                                                       m_appQueue->GetDesc().Type,
+                                                       slot.appAllocator.Get(),
+                                                       nullptr,
+                                                       IID_PPV_ARGS(slot.appCommandList.ReleaseAndGetAddressOf())));
+            CHECK_HRCMD(m_runtimeDevice->CreateCommandAllocator(
+                D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(slot.runtimeAllocator.ReleaseAndGetAddressOf())));
+            CHECK_HRCMD(
+                m_runtimeDevice->CreateCommandList(0,
+                                                   D3D12_COMMAND_LIST_TYPE_COPY,
+                                                   slot.runtimeAllocator.Get(),
+                                                   nullptr,
+                                                   IID_PPV_ARGS(slot.runtimeCommandList.ReleaseAndGetAddressOf())));
+        } else {
+            CHECK_HRCMD(slot.appAllocator->Reset());
+            CHECK_HRCMD(slot.appCommandList->Reset(slot.appAllocator.Get(), nullptr));
+            CHECK_HRCMD(slot.runtimeAllocator->Reset());
+            CHECK_HRCMD(slot.runtimeCommandList->Reset(slot.runtimeAllocator.Get(), nullptr));
+        }
+
+        D3D12_RESOURCE_BARRIER barrier{};
+        barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+        barrier.Transition.pResource = source;
+        barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+        barrier.Transition.StateBefore = sourceState;
+        barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_SOURCE;
+        slot.appCommandList->ResourceBarrier(1, &barrier);
+        for (UINT i = 0; i < subresourceCount; i++) {
+            D3D12_TEXTURE_COPY_LOCATION sourceLocation{};
+            sourceLocation.pResource = source;
+            sourceLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+            sourceLocation.SubresourceIndex = i;
+            D3D12_TEXTURE_COPY_LOCATION bufferLocation{};
+            bufferLocation.pResource = slot.appBuffer.Get();
+            bufferLocation.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+            bufferLocation.PlacedFootprint = footprints[i];
+            slot.appCommandList->CopyTextureRegion(&bufferLocation, 0, 0, 0, &sourceLocation, nullptr);
+        }
+        std::swap(barrier.Transition.StateBefore, barrier.Transition.StateAfter);
+        slot.appCommandList->ResourceBarrier(1, &barrier);
+        CHECK_HRCMD(slot.appCommandList->Close());
+
+        ID3D12CommandList* lists[] = {slot.appCommandList.Get()};
+        m_appQueue->ExecuteCommandLists(1, lists);
+        CHECK_HRCMD(m_appQueue->Signal(m_writtenFence.Get(), ++m_fenceValue));
+
+        // On the runtime's adapter, copy the staging buffer into the destination texture. The texture is promoted
+        // from the common state by the copy queue.
+        if (m_queryHeap) {
+            slot.runtimeCommandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, (UINT)index * 2);
+        }
+        for (UINT i = 0; i < subresourceCount; i++) {
+            D3D12_TEXTURE_COPY_LOCATION bufferLocation{};
+            bufferLocation.pResource = slot.runtimeBuffer.Get();
+            bufferLocation.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+            bufferLocation.PlacedFootprint = footprints[i];
+            D3D12_TEXTURE_COPY_LOCATION destinationLocation{};
+            destinationLocation.pResource = destination;
+            destinationLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+            destinationLocation.SubresourceIndex = i;
+            slot.runtimeCommandList->CopyTextureRegion(&destinationLocation, 0, 0, 0, &bufferLocation, nullptr);
+        }
+        if (m_queryHeap) {
+            slot.runtimeCommandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, (UINT)index * 2 + 1);
+            slot.runtimeCommandList->ResolveQueryData(m_queryHeap.Get(),
+                                                      D3D12_QUERY_TYPE_TIMESTAMP,
+                                                      (UINT)index * 2,
+                                                      2,
+                                                      m_queryReadback.Get(),
+                                                      index * 2 * sizeof(uint64_t));
+        }
+        CHECK_HRCMD(slot.runtimeCommandList->Close());
+
+        CHECK_HRCMD(m_runtimeQueue->Wait(m_runtimeWrittenFence.Get(), m_fenceValue));
+        lists[0] = slot.runtimeCommandList.Get();
+        m_runtimeQueue->ExecuteCommandLists(1, lists);
+        CHECK_HRCMD(m_runtimeQueue->Signal(m_readFence.Get(), m_fenceValue));
+        CHECK_HRCMD(m_runtimeContext->Wait(m_d3d11ReadFence.Get(), m_fenceValue));
+
+        slot.fenceValue = m_fenceValue;
+        slot.bytes = size;
+        slot.pending = true;
+    }
+
+    CrossAdapterTransfer::Statistics CrossAdapterTransfer::getStatistics() {
+        const UINT64 completedValue = m_readFence->GetCompletedValue();
+        for (size_t i = 0; i < m_slots.size(); i++) {
+            if (m_slots[i].pending && m_slots[i].fenceValue <= completedValue) {
+                retireSlot(m_slots[i], i);
+            }
+        }
+
+        return m_stats;
+    }
+
+    void CrossAdapterTransfer::allocateBuffers(Slot& slot, UINT64 size) {
+        // Round up to limit re-allocations when the swapchains are resized.
+        size = (size + (1 << 20) - 1) & ~((1ull << 20) - 1);
+
+        D3D12_HEAP_DESC heapDesc{};
+        heapDesc.SizeInBytes = size;
+        heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+        heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+        heapDesc.Flags = D3D12_HEAP_FLAG_SHARED | D3D12_HEAP_FLAG_SHARED_CROSS_ADAPTER;
+        ComPtr<ID3D12Heap> appHeap;
+        CHECK_HRCMD(m_appDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(appHeap.ReleaseAndGetAddressOf())));
+
+        wil::unique_handle heapHandle;
+        CHECK_HRCMD(m_appDevice->CreateSharedHandle(appHeap.Get(), nullptr, GENERIC_ALL, nullptr, heapHandle.put()));
+        ComPtr<ID3D12Heap> runtimeHeap;
+        CHECK_HRCMD(
+            m_runtimeDevice->OpenSharedHandle(heapHandle.get(), IID_PPV_ARGS(runtimeHeap.ReleaseAndGetAddressOf())));
+
+        D3D12_RESOURCE_DESC bufferDesc{};
+        bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+        bufferDesc.Width = size;
+        bufferDesc.Height = bufferDesc.DepthOrArraySize = bufferDesc.MipLevels = 1;
+        bufferDesc.SampleDesc.Count = 1;
+        bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+        bufferDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_CROSS_ADAPTER;
+        CHECK_HRCMD(m_appDevice->CreatePlacedResource(appHeap.Get(),
+                                                      0,
+                                                      &bufferDesc,
+                                                      D3D12_RESOURCE_STATE_COMMON,
+                                                      nullptr,
+                                                      IID_PPV_ARGS(slot.appBuffer.ReleaseAndGetAddressOf())));
+        CHECK_HRCMD(m_runtimeDevice->CreatePlacedResource(runtimeHeap.Get(),
+                                                          0,
+                                                          &bufferDesc,
+                                                          D3D12_RESOURCE_STATE_COMMON,
+                                                          nullptr,
+                                                          IID_PPV_ARGS(slot.runtimeBuffer.ReleaseAndGetAddressOf())));
+        slot.size = size;
+    }
+
+    void CrossAdapterTransfer::retireSlot(Slot& slot, size_t index) {
+        m_stats.transfers++;
+        m_stats.bytes += slot.bytes;
+
+        if (m_queryHeap) {
+            const D3D12_RANGE range{index * 2 * sizeof(uint64_t), (index * 2 + 2) * sizeof(uint64_t)};
+            uint64_t* timestamps;
+            CHECK_HRCMD(m_queryReadback->Map(0, &range, reinterpret_cast<void**>(&timestamps)));
+            if (timestamps[index * 2 + 1] > timestamps[index * 2]) {
+                m_stats.transferTime +=
+                    (double)(timestamps[index * 2 + 1] - timestamps[index * 2]) * 1e6 / m_timestampFrequency;
+                m_stats.timedTransfers++;
+                m_stats.timedBytes += slot.bytes;
+            }
+            const D3D12_RANGE emptyRange{0, 0};
+            m_queryReadback->Unmap(0, &emptyRange);
+        }
+
+        slot.pending = false;
+    }
+
+} // namespace d3d12on11_interop
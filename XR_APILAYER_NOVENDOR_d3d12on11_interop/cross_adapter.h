@@ -0,0 +1,110 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace d3d12on11_interop {
+
+    // Transfers textures from the app's Direct3D 12 device to the runtime's device when they are on different
+    // adapters. Each transfer goes through a staging buffer in a cross-adapter heap: the app's queue copies the texture
+    // into the buffer, then a copy queue on the runtime's adapter copies the buffer into the destination texture. The
+    // two adapters synchronize with cross-adapter fences, and the staging buffers form a ring so that the transfer of
+    // a frame overlaps the rendering of the next frames.
+    class CrossAdapterTransfer {
+      public:
+        CrossAdapterTransfer(ID3D12Device* appDevice,
+                             ID3D12CommandQueue* appQueue,
+                             IDXGIAdapter1* runtimeAdapter,
+                             ID3D11Device5* runtimeDevice,
+                             ID3D11DeviceContext4* runtimeContext,
+                             uint32_t depth = 3);
+
+        // Open a shareable texture of the runtime's Direct3D 11 device as a transfer destination.
+        ComPtr<ID3D12Resource> importTexture(ID3D11Texture2D* texture);
+
+        // Queue the transfer of a texture of the app (in the given state) after the work already submitted to the
+        // app's queue. The runtime's context waits on the GPU for the transfer to complete.
+        void transfer(ID3D12Resource* source, D3D12_RESOURCE_STATES sourceState, ID3D12Resource* destination);
+
+        struct Statistics {
+            uint64_t transfers{0};
+            uint64_t bytes{0};
+
+            // GPU time of the copies on the runtime's adapter (only with copy queue timestamps support).
+            double transferTime{0};
+            uint64_t timedTransfers{0};
+            uint64_t timedBytes{0};
+
+            // Number of times the ring was full and the CPU waited for a transfer to complete.
+            uint64_t stalls{0};
+        };
+        Statistics getStatistics();
+
+      private:
+        struct Slot {
+            // The same cross-adapter heap, opened on both devices.
+            ComPtr<ID3D12Resource> appBuffer;
+            ComPtr<ID3D12Resource> runtimeBuffer;
+            UINT64 size{0};
+
+            ComPtr<ID3D12CommandAllocator> appAllocator;
+            ComPtr<ID3D12GraphicsCommandList> appCommandList;
+            ComPtr<ID3D12CommandAllocator> runtimeAllocator;
+            ComPtr<ID3D12GraphicsCommandList> runtimeCommandList;
+
+            // The fence value of the last transfer through this slot.
+            UINT64 fenceValue{0};
+            UINT64 bytes{0};
+            bool pending{false};
+        };
+
+        void allocateBuffers(Slot& slot, UINT64 size);
+        void retireSlot(Slot& slot, size_t index);
+
+        const ComPtr<ID3D12Device> m_appDevice;
+        const ComPtr<ID3D12CommandQueue> m_appQueue;
+        const ComPtr<ID3D11DeviceContext4> m_runtimeContext;
+        ComPtr<ID3D12Device> m_runtimeDevice;
+        ComPtr<ID3D12CommandQueue> m_runtimeQueue;
+
+        // The app's queue signals the written fence once a staging buffer is written, and the runtime's copy queue
+        // signals the read fence once it is read. The runtime's context also waits for the read fence.
+        ComPtr<ID3D12Fence> m_writtenFence;
+        ComPtr<ID3D12Fence> m_runtimeWrittenFence;
+        ComPtr<ID3D12Fence> m_readFence;
+        ComPtr<ID3D11Fence> m_d3d11ReadFence;
+        UINT64 m_fenceValue{0};
+        wil::unique_handle m_event;
+
+        // Timestamps of the copies on the runtime's adapter, two per slot.
+        ComPtr<ID3D12QueryHeap> m_queryHeap;
+        ComPtr<ID3D12Resource> m_queryReadback;
+        UINT64 m_timestampFrequency{0};
+
+        std::vector<Slot> m_slots;
+        size_t m_nextSlot{0};
+        Statistics m_stats;
+    };
+
+} // namespace d3d12on11_interop
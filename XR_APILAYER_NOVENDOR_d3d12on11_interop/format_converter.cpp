@@ -0,0 +1,215 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "format_converter.h"
+#include "log.h"
+
+namespace {
+
+    // The formats that the app may prefer but that runtimes often do not offer, each with the runtime formats it can
+    // be converted into without loss of range or precision (except for the alpha channel of R11G11B10_FLOAT, which
+    // has none), by order of preference.
+    const std::vector<std::pair<DXGI_FORMAT, std::vector<DXGI_FORMAT>>> EmulatedFormats = {
+        {DXGI_FORMAT_R11G11B10_FLOAT, {DXGI_FORMAT_R16G16B16A16_FLOAT, DXGI_FORMAT_R32G32B32A32_FLOAT}},
+        {DXGI_FORMAT_R10G10B10A2_UNORM, {DXGI_FORMAT_R16G16B16A16_UNORM, DXGI_FORMAT_R16G16B16A16_FLOAT}},
+        {DXGI_FORMAT_R8G8B8A8_UNORM, {DXGI_FORMAT_B8G8R8A8_UNORM}},
+        {DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, {DXGI_FORMAT_B8G8R8A8_UNORM_SRGB}},
+        {DXGI_FORMAT_B8G8R8A8_UNORM, {DXGI_FORMAT_R8G8B8A8_UNORM}},
+        {DXGI_FORMAT_B8G8R8A8_UNORM_SRGB, {DXGI_FORMAT_R8G8B8A8_UNORM_SRGB}},
+    };
+
+    // A full-screen triangle.
+    const char VertexShaderSource[] = R"_(
+float4 main(uint id : SV_VertexID) : SV_Position {
+    const float2 uv = float2((id << 1) & 2, id & 2);
+    return float4(uv * float2(2, -2) + float2(-1, 1), 0, 1);
+}
+)_";
+
+    // The views select a single mip level and array slice. The sRGB views decode and encode the values, so the
+    // conversion is done in linear space.
+    const char PixelShaderSource[] = R"_(
+Texture2DArray<float4> source : register(t0);
+
+float4 main(float4 position : SV_Position) : SV_Target {
+    return source.Load(int4(position.xy, 0, 0));
+}
+)_";
+
+    ComPtr<ID3DBlob> CompileShader(const char* source, size_t length, const char* target) {
+        ComPtr<ID3DBlob> code;
+        ComPtr<ID3DBlob> errors;
+        const HRESULT hr = D3DCompile(source,
+                                      length,
+                                      nullptr,
+                                      nullptr,
+                                      nullptr,
+                                      "main",
+                                      target,
+                                      D3DCOMPILE_OPTIMIZATION_LEVEL3,
+                                      0,
+                                      code.ReleaseAndGetAddressOf(),
+                                      errors.ReleaseAndGetAddressOf());
+        if (FAILED(hr) && errors) {
+            d3d12on11_interop::log::Log("%s\n", reinterpret_cast<const char*>(errors->GetBufferPointer()));
+        }
+        CHECK_HRCMD(hr);
+
+        return code;
+    }
+
+} // namespace
+
+namespace d3d12on11_interop {
+
+    DXGI_FORMAT FindEmulationFormat(DXGI_FORMAT format, const std::vector<int64_t>& runtimeFormats) {
+        const auto it = std::find_if(EmulatedFormats.cbegin(), EmulatedFormats.cend(), [&](const auto& entry) {
+            return entry.first == format;
+        });
+        if (it == EmulatedFormats.cend()) {
+            return DXGI_FORMAT_UNKNOWN;
+        }
+
+        for (const DXGI_FORMAT candidate : it->second) {
+            if (std::find(runtimeFormats.cbegin(), runtimeFormats.cend(), (int64_t)candidate) !=
+                runtimeFormats.cend()) {
+                return candidate;
+            }
+        }
+
+        return DXGI_FORMAT_UNKNOWN;
+    }
+
+    std::vector<int64_t> GetEmulatedFormats(const std::vector<int64_t>& runtimeFormats) {
+        std::vector<int64_t> formats;
+        for (const auto& [format, candidates] : EmulatedFormats) {
+            if (std::find(runtimeFormats.cbegin(), runtimeFormats.cend(), (int64_t)format) == runtimeFormats.cend() &&
+                FindEmulationFormat(format, runtimeFormats) != DXGI_FORMAT_UNKNOWN) {
+                formats.push_back(format);
+            }
+        }
+
+        return formats;
+    }
+
+    FormatConverter::FormatConverter(ID3D11Device* device,
+                                     const XrSwapchainCreateInfo& createInfo,
+                                     DXGI_FORMAT runtimeFormat)
+        : m_device(device), m_createInfo(createInfo), m_runtimeFormat(runtimeFormat) {
+        // The shaders are compiled once for all the swapchains.
+        static std::once_flag compileOnce;
+        static ComPtr<ID3DBlob> vertexShaderCode;
+        static ComPtr<ID3DBlob> pixelShaderCode;
+        std::call_once(compileOnce, [&] {
+            vertexShaderCode = CompileShader(VertexShaderSource, sizeof(VertexShaderSource) - 1, "vs_5_0");
+            pixelShaderCode = CompileShader(PixelShaderSource, sizeof(PixelShaderSource) - 1, "ps_5_0");
+        });
+
+        CHECK_HRCMD(m_device->CreateVertexShader(vertexShaderCode->GetBufferPointer(),
+                                                 vertexShaderCode->GetBufferSize(),
+                                                 nullptr,
+                                                 m_vertexShader.ReleaseAndGetAddressOf()));
+        CHECK_HRCMD(m_device->CreatePixelShader(pixelShaderCode->GetBufferPointer(),
+                                                pixelShaderCode->GetBufferSize(),
+                                                nullptr,
+                                                m_pixelShader.ReleaseAndGetAddressOf()));
+
+        ComPtr<ID3D11Device1> device1;
+        CHECK_HRCMD(m_device->QueryInterface(IID_PPV_ARGS(device1.ReleaseAndGetAddressOf())));
+        const D3D_FEATURE_LEVEL featureLevel = m_device->GetFeatureLevel();
+        CHECK_HRCMD(device1->CreateDeviceContextState(0,
+                                                      &featureLevel,
+                                                      1,
+                                                      D3D11_SDK_VERSION,
+                                                      __uuidof(ID3D11Device),
+                                                      nullptr,
+                                                      m_state.ReleaseAndGetAddressOf()));
+    }
+
+    void FormatConverter::addImage(ID3D11Texture2D* destination, ID3D11Texture2D* source) {
+        D3D11_TEXTURE2D_DESC sourceDesc;
+        source->GetDesc(&sourceDesc);
+
+        const uint32_t arraySize = m_createInfo.arraySize * (m_createInfo.faceCount == 6 ? 6 : 1);
+        std::vector<View> views;
+        for (uint32_t mip = 0; mip < m_createInfo.mipCount; mip++) {
+            for (uint32_t slice = 0; slice < arraySize; slice++) {
+                View view;
+
+                D3D11_SHADER_RESOURCE_VIEW_DESC sourceViewDesc{};
+                sourceViewDesc.Format = sourceDesc.Format;
+                sourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+                sourceViewDesc.Texture2DArray.MostDetailedMip = mip;
+                sourceViewDesc.Texture2DArray.MipLevels = 1;
+                sourceViewDesc.Texture2DArray.FirstArraySlice = slice;
+                sourceViewDesc.Texture2DArray.ArraySize = 1;
+                CHECK_HRCMD(m_device->CreateShaderResourceView(
+                    source, &sourceViewDesc, view.source.ReleaseAndGetAddressOf()));
+
+                D3D11_RENDER_TARGET_VIEW_DESC destinationViewDesc{};
+                destinationViewDesc.Format = m_runtimeFormat;
+                destinationViewDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
+                destinationViewDesc.Texture2DArray.MipSlice = mip;
+                destinationViewDesc.Texture2DArray.FirstArraySlice = slice;
+                destinationViewDesc.Texture2DArray.ArraySize = 1;
+                CHECK_HRCMD(m_device->CreateRenderTargetView(
+                    destination, &destinationViewDesc, view.destination.ReleaseAndGetAddressOf()));
+
+                view.viewport = {0.f,
+                                 0.f,
+                                 (float)(std::max)(m_createInfo.width >> mip, 1u),
+                                 (float)(std::max)(m_createInfo.height >> mip, 1u),
+                                 0.f,
+                                 1.f};
+                views.push_back(std::move(view));
+            }
+        }
+        m_views.push_back(std::move(views));
+    }
+
+    void FormatConverter::convert(ID3D11DeviceContext1* context, uint32_t index) const {
+        ComPtr<ID3DDeviceContextState> previousState;
+        context->SwapDeviceContextState(m_state.Get(), previousState.ReleaseAndGetAddressOf());
+
+        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        context->VSSetShader(m_vertexShader.Get(), nullptr, 0);
+        context->PSSetShader(m_pixelShader.Get(), nullptr, 0);
+        for (const auto& view : m_views[index]) {
+            ID3D11RenderTargetView* const renderTargets[] = {view.destination.Get()};
+            context->OMSetRenderTargets(1, renderTargets, nullptr);
+            context->RSSetViewports(1, &view.viewport);
+            ID3D11ShaderResourceView* const sources[] = {view.source.Get()};
+            context->PSSetShaderResources(0, 1, sources);
+            context->Draw(3, 0);
+        }
+
+        // Unbind the views, so that the textures can be used by the app and the runtime.
+        ID3D11ShaderResourceView* const nullSources[] = {nullptr};
+        context->PSSetShaderResources(0, 1, nullSources);
+        context->OMSetRenderTargets(0, nullptr, nullptr);
+
+        context->SwapDeviceContextState(previousState.Get(), nullptr);
+    }
+
+} // namespace d3d12on11_interop
@@ -0,0 +1,67 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace d3d12on11_interop {
+
+    // Find the runtime format to use for a format that the runtime does not offer, among the runtime's formats (by
+    // order of preference of the runtime). Returns DXGI_FORMAT_UNKNOWN if the format cannot be emulated.
+    DXGI_FORMAT FindEmulationFormat(DXGI_FORMAT format, const std::vector<int64_t>& runtimeFormats);
+
+    // The formats that can be emulated with the runtime's formats, to offer to the app after the runtime's formats.
+    std::vector<int64_t> GetEmulatedFormats(const std::vector<int64_t>& runtimeFormats);
+
+    // Converts the app's textures of an emulated format into the runtime textures, with a pixel shader pass on the
+    // Direct3D 11 context: one draw per mip level and array slice. The views are created once for each image, and the
+    // pass runs in its own context state, so the state of the runtime's context is left untouched.
+    class FormatConverter {
+      public:
+        FormatConverter(ID3D11Device* device, const XrSwapchainCreateInfo& createInfo, DXGI_FORMAT runtimeFormat);
+
+        // Create the views for an image (the app's texture as the source, the runtime texture as the destination).
+        void addImage(ID3D11Texture2D* destination, ID3D11Texture2D* source);
+
+        void convert(ID3D11DeviceContext1* context, uint32_t index) const;
+
+      private:
+        struct View {
+            ComPtr<ID3D11ShaderResourceView> source;
+            ComPtr<ID3D11RenderTargetView> destination;
+            D3D11_VIEWPORT viewport;
+        };
+
+        const ComPtr<ID3D11Device> m_device;
+        const XrSwapchainCreateInfo m_createInfo;
+        const DXGI_FORMAT m_runtimeFormat;
+
+        ComPtr<ID3DDeviceContextState> m_state;
+        ComPtr<ID3D11VertexShader> m_vertexShader;
+        ComPtr<ID3D11PixelShader> m_pixelShader;
+
+        // The views for each image, for each mip level and array slice.
+        std::vector<std::vector<View>> m_views;
+    };
+
+} // namespace d3d12on11_interop
@@ -0,0 +1,287 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "frame_capture.h"
+#include "log.h"
+
+namespace {
+
+    // The DDS file layout (see the DirectX documentation for DDS_HEADER and DDS_HEADER_DXT10).
+    struct DdsPixelFormat {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t fourCC;
+        uint32_t rgbBitCount;
+        uint32_t bitMasks[4];
+    };
+
+    struct DdsHeader {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t height;
+        uint32_t width;
+        uint32_t pitchOrLinearSize;
+        uint32_t depth;
+        uint32_t mipMapCount;
+        uint32_t reserved1[11];
+        DdsPixelFormat pixelFormat;
+        uint32_t caps[4];
+        uint32_t reserved2;
+    };
+
+    struct DdsHeaderDxt10 {
+        uint32_t dxgiFormat;
+        uint32_t resourceDimension;
+        uint32_t miscFlag;
+        uint32_t arraySize;
+        uint32_t miscFlags2;
+    };
+
+    constexpr uint32_t DdsMagic = 0x20534444; // 'DDS '
+    constexpr uint32_t DdsFlags = 0x100f;     // CAPS | HEIGHT | WIDTH | PIXELFORMAT | PITCH
+    constexpr uint32_t DdsFourCC = 0x4;
+    constexpr uint32_t DdsCapsTexture = 0x1000;
+    constexpr uint32_t DdsDx10 = 0x30315844; // 'DX10'
+
+    // The size of a pixel for the formats used by swapchains, or 0 if the format cannot be captured.
+    uint32_t GetBytesPerPixel(DXGI_FORMAT format) {
+        switch (format) {
+        case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+        case DXGI_FORMAT_R10G10B10A2_UNORM:
+        case DXGI_FORMAT_R11G11B10_FLOAT:
+        case DXGI_FORMAT_R32_TYPELESS:
+        case DXGI_FORMAT_R32_FLOAT:
+        case DXGI_FORMAT_D32_FLOAT:
+        case DXGI_FORMAT_R24G8_TYPELESS:
+        case DXGI_FORMAT_D24_UNORM_S8_UINT:
+            return 4;
+        case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        case DXGI_FORMAT_R32G8X24_TYPELESS:
+        case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+            return 8;
+        case DXGI_FORMAT_R16_TYPELESS:
+        case DXGI_FORMAT_R16_UNORM:
+        case DXGI_FORMAT_D16_UNORM:
+            return 2;
+        default:
+            return 0;
+        }
+    }
+
+} // namespace
+
+namespace d3d12on11_interop {
+
+    using namespace d3d12on11_interop::log;
+
+    FrameCapture::FrameCapture(ID3D11Device* device,
+                               ID3D11DeviceContext* context,
+                               const std::filesystem::path& directory,
+                               uint32_t depth)
+        : m_device(device), m_context(context), m_directory(directory) {
+        m_slots.resize((std::max)(depth, 2u));
+        std::filesystem::create_directories(m_directory);
+        Log("Capturing frames to %s\n", m_directory.string().c_str());
+    }
+
+    FrameCapture::~FrameCapture() {
+        {
+            std::unique_lock lock(m_mutex);
+            m_shutdown = true;
+        }
+        m_wakeUp.notify_all();
+
+        // The images already read back are written before exiting.
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    bool FrameCapture::capture(uint64_t frameIndex,
+                               ID3D11Texture2D* texture,
+                               uint32_t arraySlice,
+                               const std::string& metadata) {
+        D3D11_TEXTURE2D_DESC desc;
+        texture->GetDesc(&desc);
+
+        // Staging textures cannot be multisampled.
+        auto& slot = m_slots[m_nextSlot];
+        if (slot.pending || desc.SampleDesc.Count > 1 || !GetBytesPerPixel(desc.Format)) {
+            m_stats.dropped++;
+            return false;
+        }
+
+        D3D11_TEXTURE2D_DESC stagingDesc{};
+        stagingDesc.Width = desc.Width;
+        stagingDesc.Height = desc.Height;
+        stagingDesc.MipLevels = 1;
+        stagingDesc.ArraySize = 1;
+        stagingDesc.Format = desc.Format;
+        stagingDesc.SampleDesc.Count = 1;
+        stagingDesc.Usage = D3D11_USAGE_STAGING;
+        stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+        // The staging textures are re-used as long as the images do not change.
+        if (!slot.staging || memcmp(&slot.desc, &stagingDesc, sizeof(stagingDesc))) {
+            CHECK_HRCMD(m_device->CreateTexture2D(&stagingDesc, nullptr, slot.staging.ReleaseAndGetAddressOf()));
+            slot.desc = stagingDesc;
+        }
+
+        m_context->CopySubresourceRegion(slot.staging.Get(),
+                                         0,
+                                         0,
+                                         0,
+                                         0,
+                                         texture,
+                                         D3D11CalcSubresource(0, arraySlice, desc.MipLevels),
+                                         nullptr);
+        slot.frameIndex = frameIndex;
+        slot.metadata = metadata;
+        slot.pending = true;
+        m_nextSlot = (m_nextSlot + 1) % m_slots.size();
+
+        return true;
+    }
+
+    void FrameCapture::poll() {
+        // Read back in submission order, starting with the oldest copy.
+        for (size_t i = 0; i < m_slots.size(); i++) {
+            auto& slot = m_slots[(m_nextSlot + i) % m_slots.size()];
+            if (!slot.pending) {
+                continue;
+            }
+
+            // Never wait for the GPU: the copy is read back by a later call if it is not complete.
+            D3D11_MAPPED_SUBRESOURCE mapped;
+            const HRESULT hr =
+                m_context->Map(slot.staging.Get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+            if (hr == DXGI_ERROR_WAS_STILL_DRAWING) {
+                break;
+            }
+            CHECK_HRCMD(hr);
+
+            {
+                std::unique_lock lock(m_mutex);
+
+                // The thread is only started upon first use.
+                if (!m_thread.joinable()) {
+                    m_thread = std::thread([this] { writerThread(); });
+                }
+
+                // Bound the memory used by the images not written yet. A dropped image does not use a file name.
+                // Only this thread adds images, so the queue cannot fill up until the image is added below.
+                if (m_images.size() >= m_slots.size()) {
+                    m_context->Unmap(slot.staging.Get(), 0);
+                    slot.pending = false;
+                    m_stats.dropped++;
+                    continue;
+                }
+            }
+
+            Image image;
+            image.path = m_directory / fmt::format("image{:06}.dds", m_imageCount++);
+            image.desc = slot.desc;
+            image.rowPitch = slot.desc.Width * GetBytesPerPixel(slot.desc.Format);
+            image.pixels.resize((size_t)image.rowPitch * slot.desc.Height);
+            for (uint32_t y = 0; y < slot.desc.Height; y++) {
+                memcpy(image.pixels.data() + (size_t)y * image.rowPitch,
+                       static_cast<const uint8_t*>(mapped.pData) + (size_t)y * mapped.RowPitch,
+                       image.rowPitch);
+            }
+            image.metadata = fmt::format("{},{},{},{},{},{}",
+                                         slot.frameIndex,
+                                         image.path.filename().string(),
+                                         slot.desc.Width,
+                                         slot.desc.Height,
+                                         (int)slot.desc.Format,
+                                         slot.metadata);
+            m_context->Unmap(slot.staging.Get(), 0);
+            slot.pending = false;
+            m_stats.captured++;
+
+            std::unique_lock lock(m_mutex);
+            m_images.push_back(std::move(image));
+            m_wakeUp.notify_all();
+        }
+    }
+
+    void FrameCapture::writerThread() {
+        std::ofstream index(m_directory / "frames.csv", std::ios_base::app);
+        index << "frame,file,width,height,format,swapchain,layer,view,arraySlice,displayTime\n";
+
+        std::unique_lock lock(m_mutex);
+        while (true) {
+            m_wakeUp.wait(lock, [&] { return m_shutdown || !m_images.empty(); });
+            if (m_images.empty()) {
+                break;
+            }
+
+            Image image = std::move(m_images.front());
+            m_images.pop_front();
+            lock.unlock();
+
+            writeImage(image);
+            index << image.metadata << "\n";
+            index.flush();
+
+            lock.lock();
+        }
+    }
+
+    void FrameCapture::writeImage(const Image& image) {
+        DdsHeader header{};
+        header.size = sizeof(DdsHeader);
+        header.flags = DdsFlags;
+        header.height = image.desc.Height;
+        header.width = image.desc.Width;
+        header.pitchOrLinearSize = image.rowPitch;
+        header.mipMapCount = 1;
+        header.pixelFormat.size = sizeof(DdsPixelFormat);
+        header.pixelFormat.flags = DdsFourCC;
+        header.pixelFormat.fourCC = DdsDx10;
+        header.caps[0] = DdsCapsTexture;
+
+        DdsHeaderDxt10 headerDxt10{};
+        headerDxt10.dxgiFormat = image.desc.Format;
+        headerDxt10.resourceDimension = D3D11_RESOURCE_DIMENSION_TEXTURE2D;
+        headerDxt10.arraySize = 1;
+
+        std::ofstream file(image.path, std::ios_base::binary);
+        file.write(reinterpret_cast<const char*>(&DdsMagic), sizeof(DdsMagic));
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(&headerDxt10), sizeof(headerDxt10));
+        file.write(reinterpret_cast<const char*>(image.pixels.data()), image.pixels.size());
+        if (!file) {
+            Log("Failed to write %s\n", image.path.string().c_str());
+        }
+    }
+
+} // namespace d3d12on11_interop
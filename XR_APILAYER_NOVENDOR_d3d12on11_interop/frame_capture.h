@@ -0,0 +1,91 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace d3d12on11_interop {
+
+    // Captures the images submitted to the runtime without stalling. The images are copied into a ring of Direct3D 11
+    // staging textures, mapped a few frames later once the copies are complete, and written to DDS files by a
+    // background thread, along with a frames.csv file describing each image.
+    class FrameCapture {
+      public:
+        FrameCapture(ID3D11Device* device,
+                     ID3D11DeviceContext* context,
+                     const std::filesystem::path& directory,
+                     uint32_t depth = 4);
+        ~FrameCapture();
+
+        // Queue the copy of an array slice of a submitted texture. The metadata is appended to the image's line in
+        // frames.csv (swapchain, layer, view, arraySlice, displayTime). Returns false if the image is dropped (ring
+        // full, or unsupported format).
+        bool capture(uint64_t frameIndex, ID3D11Texture2D* texture, uint32_t arraySlice, const std::string& metadata);
+
+        // Read back the copies that are complete, and hand them over to the writer thread.
+        void poll();
+
+        struct Statistics {
+            uint64_t captured{0};
+            uint64_t dropped{0};
+        };
+        Statistics getStatistics() const {
+            return m_stats;
+        }
+
+      private:
+        struct Slot {
+            ComPtr<ID3D11Texture2D> staging;
+            D3D11_TEXTURE2D_DESC desc{};
+            uint64_t frameIndex{0};
+            std::string metadata;
+            bool pending{false};
+        };
+
+        struct Image {
+            std::filesystem::path path;
+            D3D11_TEXTURE2D_DESC desc;
+            uint32_t rowPitch;
+            std::vector<uint8_t> pixels;
+            std::string metadata;
+        };
+
+        void writerThread();
+        void writeImage(const Image& image);
+
+        const ComPtr<ID3D11Device> m_device;
+        const ComPtr<ID3D11DeviceContext> m_context;
+        const std::filesystem::path m_directory;
+        std::vector<Slot> m_slots;
+        size_t m_nextSlot{0};
+        uint64_t m_imageCount{0};
+        Statistics m_stats;
+
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_wakeUp;
+        std::deque<Image> m_images;
+        bool m_shutdown{false};
+    };
+
+} // namespace d3d12on11_interop
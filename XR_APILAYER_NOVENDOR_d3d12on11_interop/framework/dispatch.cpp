@@ -26,6 +26,8 @@
 
 #include "dispatch.h"
 #include "log.h"
+#include "capture.h"
+#include "xr_d3d12on11_interop.h"
 
 #ifndef LAYER_NAMESPACE
 #error Must define LAYER_NAMESPACE
@@ -62,7 +64,8 @@ namespace LAYER_NAMESPACE {
             }
         }
 
-        // Remove the D3D12 extension and add the D3D11 one instead (when needed).
+        // Remove the D3D12 extension and add the D3D11 one instead (when needed). Also remove the extensions implemented
+        // by the layer.
         XrInstanceCreateInfo chainInstanceCreateInfo = *instanceCreateInfo;
         std::vector<const char*> newEnabledExtensionNames;
         bool needUseD3D11 = false;
@@ -74,10 +77,11 @@ namespace LAYER_NAMESPACE {
                 return std::tolower(c);
             });
 
-            if (extLowerCase != "xr_khr_d3d12_enable") {
-                newEnabledExtensionNames.push_back(ext.data());
-            } else {
+            if (extLowerCase == "xr_khr_d3d12_enable") {
                 needUseD3D11 = true;
+            } else if (ext != XR_NOVENDOR_D3D12ON11_QUEUES_EXTENSION_NAME &&
+                       ext != XR_NOVENDOR_D3D12ON11_STATISTICS_EXTENSION_NAME) {
+                newEnabledExtensionNames.push_back(ext.data());
             }
         }
         if (needUseD3D11) {
@@ -131,6 +135,11 @@ namespace LAYER_NAMESPACE {
             if (XR_SUCCEEDED(result)) {
                 LAYER_NAMESPACE::ResetInstance();
             }
+
+            // Make sure the capture is complete on disk in case the app exits without unloading us.
+            if (capture::IsEnabled()) {
+                capture::Flush();
+            }
         } catch (std::runtime_error exc) {
             Log("%s\n", exc.what());
             result = XR_ERROR_RUNTIME_FAILURE;
@@ -27,6 +27,7 @@
 
 #include "dispatch.h"
 #include "log.h"
+#include "capture.h"
 
 #ifndef LAYER_NAMESPACE
 #error Must define LAYER_NAMESPACE
@@ -39,10 +40,66 @@ namespace LAYER_NAMESPACE
 
 	// Auto-generated wrappers for the requested APIs.
 
+	XrResult xrEnumerateInstanceExtensionProperties(const char* layerName, uint32_t propertyCapacityInput, uint32_t* propertyCountOutput, XrExtensionProperties* properties)
+	{
+		DebugLog("--> xrEnumerateInstanceExtensionProperties\n");
+
+		const capture::Timestamp captureStart = capture::IsEnabled() ? capture::Begin() : capture::Timestamp{};
+
+		XrResult result;
+		try
+		{
+			result = LAYER_NAMESPACE::GetInstance()->xrEnumerateInstanceExtensionProperties(layerName, propertyCapacityInput, propertyCountOutput, properties);
+		}
+		catch (std::exception exc)
+		{
+			Log("%s\n", exc.what());
+			result = XR_ERROR_RUNTIME_FAILURE;
+		}
+
+		if (capture::IsEnabled())
+		{
+			capture::Record("xrEnumerateInstanceExtensionProperties", captureStart, result) << layerName << propertyCapacityInput << propertyCountOutput << properties;
+		}
+
+		DebugLog("<-- xrEnumerateInstanceExtensionProperties %s\n", xr::ToCString(result));
+
+		return result;
+	}
+
+	XrResult xrPollEvent(XrInstance instance, XrEventDataBuffer* eventData)
+	{
+		DebugLog("--> xrPollEvent\n");
+
+		const capture::Timestamp captureStart = capture::IsEnabled() ? capture::Begin() : capture::Timestamp{};
+
+		XrResult result;
+		try
+		{
+			result = LAYER_NAMESPACE::GetInstance()->xrPollEvent(instance, eventData);
+		}
+		catch (std::exception exc)
+		{
+			Log("%s\n", exc.what());
+			result = XR_ERROR_RUNTIME_FAILURE;
+		}
+
+		if (capture::IsEnabled())
+		{
+			capture::Record("xrPollEvent", captureStart, result) << instance << eventData;
+		}
+
+		DebugLog("<-- xrPollEvent %s\n", xr::ToCString(result));
+
+		return result;
+	}
+
 	XrResult xrGetSystem(XrInstance instance, const XrSystemGetInfo* getInfo, XrSystemId* systemId)
 	{
 		DebugLog("--> xrGetSystem\n");
 
+		const capture::Timestamp captureStart = capture::IsEnabled() ? capture::Begin() : capture::Timestamp{};
+
 		XrResult result;
 		try
 		{
@@ -54,6 +111,11 @@ namespace LAYER_NAMESPACE
 			result = XR_ERROR_RUNTIME_FAILURE;
 		}
 
+		if (capture::IsEnabled())
+		{
+			capture::Record("xrGetSystem", captureStart, result) << instance << getInfo << systemId;
+		}
+
 		DebugLog("<-- xrGetSystem %s\n", xr::ToCString(result));
 
 		return result;
@@ -63,6 +125,8 @@ namespace LAYER_NAMESPACE
 	{
 		DebugLog("--> xrCreateSession\n");
 
+		const capture::Timestamp captureStart = capture::IsEnabled() ? capture::Begin() : capture::Timestamp{};
+
 		XrResult result;
 		try
 		{
@@ -74,6 +138,11 @@ namespace LAYER_NAMESPACE
 			result = XR_ERROR_RUNTIME_FAILURE;
 		}
 
+		if (capture::IsEnabled())
+		{
+			capture::Record("xrCreateSession", captureStart, result) << instance << createInfo << session;
+		}
+
 		DebugLog("<-- xrCreateSession %s\n", xr::ToCString(result));
 
 		return result;
@@ -83,6 +152,8 @@ namespace LAYER_NAMESPACE
 	{
 		DebugLog("--> xrDestroySession\n");
 
+		const capture::Timestamp captureStart = capture::IsEnabled() ? capture::Begin() : capture::Timestamp{};
+
 		XrResult result;
 		try
 		{
@@ -94,15 +165,49 @@ namespace LAYER_NAMESPACE
 			result = XR_ERROR_RUNTIME_FAILURE;
 		}
 
+		if (capture::IsEnabled())
+		{
+			capture::Record("xrDestroySession", captureStart, result) << session;
+		}
+
 		DebugLog("<-- xrDestroySession %s\n", xr::ToCString(result));
 
 		return result;
 	}
 
+	XrResult xrEnumerateSwapchainFormats(XrSession session, uint32_t formatCapacityInput, uint32_t* formatCountOutput, int64_t* formats)
+	{
+		DebugLog("--> xrEnumerateSwapchainFormats\n");
+
+		const capture::Timestamp captureStart = capture::IsEnabled() ? capture::Begin() : capture::Timestamp{};
+
+		XrResult result;
+		try
+		{
+			result = LAYER_NAMESPACE::GetInstance()->xrEnumerateSwapchainFormats(session, formatCapacityInput, formatCountOutput, formats);
+		}
+		catch (std::exception exc)
+		{
+			Log("%s\n", exc.what());
+			result = XR_ERROR_RUNTIME_FAILURE;
+		}
+
+		if (capture::IsEnabled())
+		{
+			capture::Record("xrEnumerateSwapchainFormats", captureStart, result) << session << formatCapacityInput << formatCountOutput << formats;
+		}
+
+		DebugLog("<-- xrEnumerateSwapchainFormats %s\n", xr::ToCString(result));
+
+		return result;
+	}
+
 	XrResult xrCreateSwapchain(XrSession session, const XrSwapchainCreateInfo* createInfo, XrSwapchain* swapchain)
 	{
 		DebugLog("--> xrCreateSwapchain\n");
 
+		const capture::Timestamp captureStart = capture::IsEnabled() ? capture::Begin() : capture::Timestamp{};
+
 		XrResult result;
 		try
 		{
@@ -114,6 +219,11 @@ namespace LAYER_NAMESPACE
 			result = XR_ERROR_RUNTIME_FAILURE;
 		}
 
+		if (capture::IsEnabled())
+		{
+			capture::Record("xrCreateSwapchain", captureStart, result) << session << createInfo << swapchain;
+		}
+
 		DebugLog("<-- xrCreateSwapchain %s\n", xr::ToCString(result));
 
 		return result;
@@ -123,6 +233,8 @@ namespace LAYER_NAMESPACE
 	{
 		DebugLog("--> xrDestroySwapchain\n");
 
+		const capture::Timestamp captureStart = capture::IsEnabled() ? capture::Begin() : capture::Timestamp{};
+
 		XrResult result;
 		try
 		{
@@ -134,6 +246,11 @@ namespace LAYER_NAMESPACE
 			result = XR_ERROR_RUNTIME_FAILURE;
 		}
 
+		if (capture::IsEnabled())
+		{
+			capture::Record("xrDestroySwapchain", captureStart, result) << swapchain;
+		}
+
 		DebugLog("<-- xrDestroySwapchain %s\n", xr::ToCString(result));
 
 		return result;
@@ -143,6 +260,8 @@ namespace LAYER_NAMESPACE
 	{
 		DebugLog("--> xrEnumerateSwapchainImages\n");
 
+		const capture::Timestamp captureStart = capture::IsEnabled() ? capture::Begin() : capture::Timestamp{};
+
 		XrResult result;
 		try
 		{
@@ -154,6 +273,11 @@ namespace LAYER_NAMESPACE
 			result = XR_ERROR_RUNTIME_FAILURE;
 		}
 
+		if (capture::IsEnabled())
+		{
+			capture::Record("xrEnumerateSwapchainImages", captureStart, result) << swapchain << imageCapacityInput << imageCountOutput << images;
+		}
+
 		DebugLog("<-- xrEnumerateSwapchainImages %s\n", xr::ToCString(result));
 
 		return result;
@@ -163,6 +287,8 @@ namespace LAYER_NAMESPACE
 	{
 		DebugLog("--> xrAcquireSwapchainImage\n");
 
+		const capture::Timestamp captureStart = capture::IsEnabled() ? capture::Begin() : capture::Timestamp{};
+
 		XrResult result;
 		try
 		{
@@ -174,15 +300,49 @@ namespace LAYER_NAMESPACE
 			result = XR_ERROR_RUNTIME_FAILURE;
 		}
 
+		if (capture::IsEnabled())
+		{
+			capture::Record("xrAcquireSwapchainImage", captureStart, result) << swapchain << acquireInfo << index;
+		}
+
 		DebugLog("<-- xrAcquireSwapchainImage %s\n", xr::ToCString(result));
 
 		return result;
 	}
 
+	XrResult xrWaitSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageWaitInfo* waitInfo)
+	{
+		DebugLog("--> xrWaitSwapchainImage\n");
+
+		const capture::Timestamp captureStart = capture::IsEnabled() ? capture::Begin() : capture::Timestamp{};
+
+		XrResult result;
+		try
+		{
+			result = LAYER_NAMESPACE::GetInstance()->xrWaitSwapchainImage(swapchain, waitInfo);
+		}
+		catch (std::exception exc)
+		{
+			Log("%s\n", exc.what());
+			result = XR_ERROR_RUNTIME_FAILURE;
+		}
+
+		if (capture::IsEnabled())
+		{
+			capture::Record("xrWaitSwapchainImage", captureStart, result) << swapchain << waitInfo;
+		}
+
+		DebugLog("<-- xrWaitSwapchainImage %s\n", xr::ToCString(result));
+
+		return result;
+	}
+
 	XrResult xrReleaseSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageReleaseInfo* releaseInfo)
 	{
 		DebugLog("--> xrReleaseSwapchainImage\n");
 
+		const capture::Timestamp captureStart = capture::IsEnabled() ? capture::Begin() : capture::Timestamp{};
+
 		XrResult result;
 		try
 		{
@@ -194,15 +354,49 @@ namespace LAYER_NAMESPACE
 			result = XR_ERROR_RUNTIME_FAILURE;
 		}
 
+		if (capture::IsEnabled())
+		{
+			capture::Record("xrReleaseSwapchainImage", captureStart, result) << swapchain << releaseInfo;
+		}
+
 		DebugLog("<-- xrReleaseSwapchainImage %s\n", xr::ToCString(result));
 
 		return result;
 	}
 
+	XrResult xrWaitFrame(XrSession session, const XrFrameWaitInfo* frameWaitInfo, XrFrameState* frameState)
+	{
+		DebugLog("--> xrWaitFrame\n");
+
+		const capture::Timestamp captureStart = capture::IsEnabled() ? capture::Begin() : capture::Timestamp{};
+
+		XrResult result;
+		try
+		{
+			result = LAYER_NAMESPACE::GetInstance()->xrWaitFrame(session, frameWaitInfo, frameState);
+		}
+		catch (std::exception exc)
+		{
+			Log("%s\n", exc.what());
+			result = XR_ERROR_RUNTIME_FAILURE;
+		}
+
+		if (capture::IsEnabled())
+		{
+			capture::Record("xrWaitFrame", captureStart, result) << session << frameWaitInfo << frameState;
+		}
+
+		DebugLog("<-- xrWaitFrame %s\n", xr::ToCString(result));
+
+		return result;
+	}
+
 	XrResult xrEndFrame(XrSession session, const XrFrameEndInfo* frameEndInfo)
 	{
 		DebugLog("--> xrEndFrame\n");
 
+		const capture::Timestamp captureStart = capture::IsEnabled() ? capture::Begin() : capture::Timestamp{};
+
 		XrResult result;
 		try
 		{
@@ -214,6 +408,11 @@ namespace LAYER_NAMESPACE
 			result = XR_ERROR_RUNTIME_FAILURE;
 		}
 
+		if (capture::IsEnabled())
+		{
+			capture::Record("xrEndFrame", captureStart, result) << session << frameEndInfo;
+		}
+
 		DebugLog("<-- xrEndFrame %s\n", xr::ToCString(result));
 
 		return result;
@@ -234,6 +433,16 @@ namespace LAYER_NAMESPACE
 				m_xrDestroyInstance = reinterpret_cast<PFN_xrDestroyInstance>(*function);
 				*function = reinterpret_cast<PFN_xrVoidFunction>(LAYER_NAMESPACE::xrDestroyInstance);
 			}
+			else if (apiName == "xrEnumerateInstanceExtensionProperties")
+			{
+				m_xrEnumerateInstanceExtensionProperties = reinterpret_cast<PFN_xrEnumerateInstanceExtensionProperties>(*function);
+				*function = reinterpret_cast<PFN_xrVoidFunction>(LAYER_NAMESPACE::xrEnumerateInstanceExtensionProperties);
+			}
+			else if (apiName == "xrPollEvent")
+			{
+				m_xrPollEvent = reinterpret_cast<PFN_xrPollEvent>(*function);
+				*function = reinterpret_cast<PFN_xrVoidFunction>(LAYER_NAMESPACE::xrPollEvent);
+			}
 			else if (apiName == "xrGetSystem")
 			{
 				m_xrGetSystem = reinterpret_cast<PFN_xrGetSystem>(*function);
@@ -249,6 +458,11 @@ namespace LAYER_NAMESPACE
 				m_xrDestroySession = reinterpret_cast<PFN_xrDestroySession>(*function);
 				*function = reinterpret_cast<PFN_xrVoidFunction>(LAYER_NAMESPACE::xrDestroySession);
 			}
+			else if (apiName == "xrEnumerateSwapchainFormats")
+			{
+				m_xrEnumerateSwapchainFormats = reinterpret_cast<PFN_xrEnumerateSwapchainFormats>(*function);
+				*function = reinterpret_cast<PFN_xrVoidFunction>(LAYER_NAMESPACE::xrEnumerateSwapchainFormats);
+			}
 			else if (apiName == "xrCreateSwapchain")
 			{
 				m_xrCreateSwapchain = reinterpret_cast<PFN_xrCreateSwapchain>(*function);
@@ -269,11 +483,21 @@ namespace LAYER_NAMESPACE
 				m_xrAcquireSwapchainImage = reinterpret_cast<PFN_xrAcquireSwapchainImage>(*function);
 				*function = reinterpret_cast<PFN_xrVoidFunction>(LAYER_NAMESPACE::xrAcquireSwapchainImage);
 			}
+			else if (apiName == "xrWaitSwapchainImage")
+			{
+				m_xrWaitSwapchainImage = reinterpret_cast<PFN_xrWaitSwapchainImage>(*function);
+				*function = reinterpret_cast<PFN_xrVoidFunction>(LAYER_NAMESPACE::xrWaitSwapchainImage);
+			}
 			else if (apiName == "xrReleaseSwapchainImage")
 			{
 				m_xrReleaseSwapchainImage = reinterpret_cast<PFN_xrReleaseSwapchainImage>(*function);
 				*function = reinterpret_cast<PFN_xrVoidFunction>(LAYER_NAMESPACE::xrReleaseSwapchainImage);
 			}
+			else if (apiName == "xrWaitFrame")
+			{
+				m_xrWaitFrame = reinterpret_cast<PFN_xrWaitFrame>(*function);
+				*function = reinterpret_cast<PFN_xrVoidFunction>(LAYER_NAMESPACE::xrWaitFrame);
+			}
 			else if (apiName == "xrEndFrame")
 			{
 				m_xrEndFrame = reinterpret_cast<PFN_xrEndFrame>(*function);
@@ -23,6 +23,8 @@
 
 #pragma once
 
+#include "capture.h"
+
 #ifndef LAYER_NAMESPACE
 #error Must define LAYER_NAMESPACE
 #endif
@@ -67,9 +69,19 @@ namespace LAYER_NAMESPACE
 
 		// Auto-generated entries for the requested APIs.
 
+	public:
+		virtual XrResult xrEnumerateInstanceExtensionProperties(const char* layerName, uint32_t propertyCapacityInput, uint32_t* propertyCountOutput, XrExtensionProperties* properties)
+		{
+			const capture::DownstreamCall downstream;
+			return m_xrEnumerateInstanceExtensionProperties(layerName, propertyCapacityInput, propertyCountOutput, properties);
+		}
+	private:
+		PFN_xrEnumerateInstanceExtensionProperties m_xrEnumerateInstanceExtensionProperties{ nullptr };
+
 	public:
 		virtual XrResult xrDestroyInstance(XrInstance instance)
 		{
+			const capture::DownstreamCall downstream;
 			return m_xrDestroyInstance(instance);
 		}
 	private:
@@ -78,14 +90,25 @@ namespace LAYER_NAMESPACE
 	public:
 		virtual XrResult xrGetInstanceProperties(XrInstance instance, XrInstanceProperties* instanceProperties)
 		{
+			const capture::DownstreamCall downstream;
 			return m_xrGetInstanceProperties(instance, instanceProperties);
 		}
 	private:
 		PFN_xrGetInstanceProperties m_xrGetInstanceProperties{ nullptr };
 
+	public:
+		virtual XrResult xrPollEvent(XrInstance instance, XrEventDataBuffer* eventData)
+		{
+			const capture::DownstreamCall downstream;
+			return m_xrPollEvent(instance, eventData);
+		}
+	private:
+		PFN_xrPollEvent m_xrPollEvent{ nullptr };
+
 	public:
 		virtual XrResult xrGetSystem(XrInstance instance, const XrSystemGetInfo* getInfo, XrSystemId* systemId)
 		{
+			const capture::DownstreamCall downstream;
 			return m_xrGetSystem(instance, getInfo, systemId);
 		}
 	private:
@@ -94,6 +117,7 @@ namespace LAYER_NAMESPACE
 	public:
 		virtual XrResult xrGetSystemProperties(XrInstance instance, XrSystemId systemId, XrSystemProperties* properties)
 		{
+			const capture::DownstreamCall downstream;
 			return m_xrGetSystemProperties(instance, systemId, properties);
 		}
 	private:
@@ -102,6 +126,7 @@ namespace LAYER_NAMESPACE
 	public:
 		virtual XrResult xrCreateSession(XrInstance instance, const XrSessionCreateInfo* createInfo, XrSession* session)
 		{
+			const capture::DownstreamCall downstream;
 			return m_xrCreateSession(instance, createInfo, session);
 		}
 	private:
@@ -110,14 +135,25 @@ namespace LAYER_NAMESPACE
 	public:
 		virtual XrResult xrDestroySession(XrSession session)
 		{
+			const capture::DownstreamCall downstream;
 			return m_xrDestroySession(session);
 		}
 	private:
 		PFN_xrDestroySession m_xrDestroySession{ nullptr };
 
+	public:
+		virtual XrResult xrEnumerateSwapchainFormats(XrSession session, uint32_t formatCapacityInput, uint32_t* formatCountOutput, int64_t* formats)
+		{
+			const capture::DownstreamCall downstream;
+			return m_xrEnumerateSwapchainFormats(session, formatCapacityInput, formatCountOutput, formats);
+		}
+	private:
+		PFN_xrEnumerateSwapchainFormats m_xrEnumerateSwapchainFormats{ nullptr };
+
 	public:
 		virtual XrResult xrCreateSwapchain(XrSession session, const XrSwapchainCreateInfo* createInfo, XrSwapchain* swapchain)
 		{
+			const capture::DownstreamCall downstream;
 			return m_xrCreateSwapchain(session, createInfo, swapchain);
 		}
 	private:
@@ -126,6 +162,7 @@ namespace LAYER_NAMESPACE
 	public:
 		virtual XrResult xrDestroySwapchain(XrSwapchain swapchain)
 		{
+			const capture::DownstreamCall downstream;
 			return m_xrDestroySwapchain(swapchain);
 		}
 	private:
@@ -134,6 +171,7 @@ namespace LAYER_NAMESPACE
 	public:
 		virtual XrResult xrEnumerateSwapchainImages(XrSwapchain swapchain, uint32_t imageCapacityInput, uint32_t* imageCountOutput, XrSwapchainImageBaseHeader* images)
 		{
+			const capture::DownstreamCall downstream;
 			return m_xrEnumerateSwapchainImages(swapchain, imageCapacityInput, imageCountOutput, images);
 		}
 	private:
@@ -142,22 +180,43 @@ namespace LAYER_NAMESPACE
 	public:
 		virtual XrResult xrAcquireSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageAcquireInfo* acquireInfo, uint32_t* index)
 		{
+			const capture::DownstreamCall downstream;
 			return m_xrAcquireSwapchainImage(swapchain, acquireInfo, index);
 		}
 	private:
 		PFN_xrAcquireSwapchainImage m_xrAcquireSwapchainImage{ nullptr };
 
+	public:
+		virtual XrResult xrWaitSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageWaitInfo* waitInfo)
+		{
+			const capture::DownstreamCall downstream;
+			return m_xrWaitSwapchainImage(swapchain, waitInfo);
+		}
+	private:
+		PFN_xrWaitSwapchainImage m_xrWaitSwapchainImage{ nullptr };
+
 	public:
 		virtual XrResult xrReleaseSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageReleaseInfo* releaseInfo)
 		{
+			const capture::DownstreamCall downstream;
 			return m_xrReleaseSwapchainImage(swapchain, releaseInfo);
 		}
 	private:
 		PFN_xrReleaseSwapchainImage m_xrReleaseSwapchainImage{ nullptr };
 
+	public:
+		virtual XrResult xrWaitFrame(XrSession session, const XrFrameWaitInfo* frameWaitInfo, XrFrameState* frameState)
+		{
+			const capture::DownstreamCall downstream;
+			return m_xrWaitFrame(session, frameWaitInfo, frameState);
+		}
+	private:
+		PFN_xrWaitFrame m_xrWaitFrame{ nullptr };
+
 	public:
 		virtual XrResult xrEndFrame(XrSession session, const XrFrameEndInfo* frameEndInfo)
 		{
+			const capture::DownstreamCall downstream;
 			return m_xrEndFrame(session, frameEndInfo);
 		}
 	private:
@@ -107,6 +107,13 @@ class DispatchGenOutputGenerator(AutomaticSourceOutputGenerator):
 
         return arguments_list
 
+    def makeCaptureList(self, cmd):
+        capture_list = ""
+        for param in cmd.params:
+            capture_list += ' << ' + param.name
+
+        return capture_list
+
 class DispatchGenCppOutputGenerator(DispatchGenOutputGenerator):
     '''Generator for dispatch.gen.cpp.'''
     def beginFile(self, genOpts):
@@ -117,6 +124,7 @@ class DispatchGenCppOutputGenerator(DispatchGenOutputGenerator):
 
 #include "dispatch.h"
 #include "log.h"
+#include "capture.h"
 
 #ifndef LAYER_NAMESPACE
 #error Must define LAYER_NAMESPACE
@@ -158,6 +166,7 @@ namespace LAYER_NAMESPACE
             if cur_cmd.name in layer_apis.override_functions:
                 parameters_list = self.makeParametersList(cur_cmd)
                 arguments_list = self.makeArgumentsList(cur_cmd)
+                capture_list = self.makeCaptureList(cur_cmd)
 
                 if cur_cmd.return_type is not None:
                     generated += f'''
@@ -165,6 +174,8 @@ namespace LAYER_NAMESPACE
 	{{
 		DebugLog("--> {cur_cmd.name}\\n");
 
+		const capture::Timestamp captureStart = capture::IsEnabled() ? capture::Begin() : capture::Timestamp{};
+
 		XrResult result;
 		try
 		{{
@@ -176,6 +187,11 @@ namespace LAYER_NAMESPACE
 			result = XR_ERROR_RUNTIME_FAILURE;
 		}}
 
+		if (capture::IsEnabled())
+		{{
+			capture::Record("{cur_cmd.name}", captureStart, result){capture_list};
+		}}
+
 		DebugLog("<-- {cur_cmd.name} %s\\n", xr::ToCString(result));
 
 		return result;
@@ -261,6 +277,8 @@ class DispatchGenHOutputGenerator(DispatchGenOutputGenerator):
         DispatchGenOutputGenerator.beginFile(self, genOpts)
         preamble = '''#pragma once
 
+#include "capture.h"
+
 #ifndef LAYER_NAMESPACE
 #error Must define LAYER_NAMESPACE
 #endif
@@ -339,6 +357,7 @@ namespace LAYER_NAMESPACE
                     generated += f'''
 		virtual XrResult {cur_cmd.name}({parameters_list})
 		{{
+			const capture::DownstreamCall downstream;
 			return m_{cur_cmd.name}({arguments_list});
 		}}
 '''
@@ -346,6 +365,7 @@ namespace LAYER_NAMESPACE
                     generated += f'''
 		virtual void {cur_cmd.name}({parameters_list})
 		{{
+			const capture::DownstreamCall downstream;
 			m_{cur_cmd.name}({arguments_list});
 		}}
 '''
@@ -26,6 +26,7 @@
 
 #include "dispatch.h"
 #include "log.h"
+#include "capture.h"
 
 #ifndef LAYER_NAMESPACE
 #error Must define LAYER_NAMESPACE
@@ -37,11 +38,6 @@ namespace LAYER_NAMESPACE {
 
     // The path to store logs & others.
     std::filesystem::path localAppData;
-
-    namespace log {
-        // The file logger.
-        std::ofstream logStream;
-    } // namespace log
 } // namespace LAYER_NAMESPACE
 
 using namespace LAYER_NAMESPACE;
@@ -54,10 +50,32 @@ XrResult __declspec(dllexport) XRAPI_CALL
     xrNegotiateLoaderApiLayerInterface(const XrNegotiateLoaderInfo* const loaderInfo,
                                        const char* const apiLayerName,
                                        XrNegotiateApiLayerRequest* const apiLayerRequest) {
+    localAppData = std::filesystem::path(getenv("LOCALAPPDATA"));
+
+    // Find the folder where the DLL is installed.
+    if (dllHome.empty()) {
+        HMODULE module;
+        if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                               reinterpret_cast<LPCSTR>(&dllHome),
+                               &module)) {
+            char path[_MAX_PATH];
+            GetModuleFileNameA(module, path, sizeof(path));
+            dllHome = std::filesystem::path(path).parent_path();
+        }
+    }
+
     // Start logging to file.
-    if (!logStream.is_open()) {
-        std::string logFile = (std::filesystem::path(getenv("LOCALAPPDATA")) / (LayerName + ".log")).string();
-        logStream.open(logFile, std::ios_base::ate);
+    if (!IsFileLogOpen()) {
+        OpenFileLog(localAppData / (LayerName + ".log"));
+    }
+
+    // Start capturing the OpenXR calls when requested.
+    if (getenv(("CAPTURE_" + LayerName).c_str()) && !capture::IsEnabled()) {
+        const auto captureFile = localAppData / (LayerName + ".capture");
+        capture::Start(captureFile);
+        if (capture::IsEnabled()) {
+            Log("Capturing OpenXR calls to: %s\n", captureFile.string().c_str());
+        }
     }
 
     DebugLog("--> xrNegotiateLoaderApiLayerInterface\n");
@@ -1,13 +1,18 @@
 # The list of OpenXR functions our layer will override.
 override_functions = [
+    "xrEnumerateInstanceExtensionProperties",
+    "xrPollEvent",
     "xrGetSystem",
     "xrCreateSession",
     "xrDestroySession",
+    "xrEnumerateSwapchainFormats",
     "xrCreateSwapchain",
     "xrDestroySwapchain",
     "xrEnumerateSwapchainImages",
     "xrAcquireSwapchainImage",
+    "xrWaitSwapchainImage",
     "xrReleaseSwapchainImage",
+    "xrWaitFrame",
     "xrEndFrame"
 ]
 
@@ -0,0 +1,125 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "gpu_timers.h"
+
+namespace d3d12on11_interop {
+
+    GpuTimers::GpuTimers(ID3D11Device* device, ID3D11DeviceContext* context, uint32_t depth)
+        : m_device(device), m_context(context), m_frames(depth) {
+        for (auto& frame : m_frames) {
+            frame.disjoint = createQuery(D3D11_QUERY_TIMESTAMP_DISJOINT);
+        }
+    }
+
+    void GpuTimers::begin(uint64_t key) {
+        Frame& frame = currentFrame();
+
+        // Queries are reused from one frame to the next, so there is no allocation once warmed up.
+        if (frame.sectionsUsed == frame.sections.size()) {
+            frame.sections.push_back({0, createQuery(D3D11_QUERY_TIMESTAMP), createQuery(D3D11_QUERY_TIMESTAMP)});
+        }
+        Section& section = frame.sections[frame.sectionsUsed++];
+        section.key = key;
+        m_context->End(section.begin.Get());
+    }
+
+    void GpuTimers::end(uint64_t key) {
+        Frame& frame = currentFrame();
+
+        // Close the most recent section for this key.
+        for (size_t i = frame.sectionsUsed; i > 0; i--) {
+            if (frame.sections[i - 1].key == key) {
+                m_context->End(frame.sections[i - 1].end.Get());
+                break;
+            }
+        }
+    }
+
+    void GpuTimers::endFrame() {
+        Frame& frame = m_frames[m_currentFrame];
+        if (!frame.started) {
+            return;
+        }
+
+        m_context->End(frame.disjoint.Get());
+        frame.started = false;
+        frame.pending = true;
+        m_currentFrame = (m_currentFrame + 1) % m_frames.size();
+    }
+
+    void GpuTimers::poll(const std::function<void(uint64_t key, double duration)>& callback) {
+        for (auto& frame : m_frames) {
+            if (!frame.pending) {
+                continue;
+            }
+
+            D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+            if (m_context->GetData(
+                    frame.disjoint.Get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+                continue;
+            }
+
+            // Once the disjoint query is complete, all the timestamps within the frame are available.
+            frame.pending = false;
+            if (disjoint.Disjoint) {
+                continue;
+            }
+
+            for (size_t i = 0; i < frame.sectionsUsed; i++) {
+                UINT64 begin, end;
+                if (m_context->GetData(frame.sections[i].begin.Get(),
+                                       &begin,
+                                       sizeof(begin),
+                                       D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK &&
+                    m_context->GetData(
+                        frame.sections[i].end.Get(), &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK &&
+                    end >= begin) {
+                    callback(frame.sections[i].key, (end - begin) * 1e6 / disjoint.Frequency);
+                }
+            }
+        }
+    }
+
+    GpuTimers::Frame& GpuTimers::currentFrame() {
+        Frame& frame = m_frames[m_currentFrame];
+        if (!frame.started) {
+            // If the results from the previous use of this frame were never read back, they are dropped.
+            frame.pending = false;
+            frame.sectionsUsed = 0;
+            frame.started = true;
+            m_context->Begin(frame.disjoint.Get());
+        }
+        return frame;
+    }
+
+    ComPtr<ID3D11Query> GpuTimers::createQuery(D3D11_QUERY type) {
+        D3D11_QUERY_DESC desc{};
+        desc.Query = type;
+        ComPtr<ID3D11Query> query;
+        CHECK_HRCMD(m_device->CreateQuery(&desc, query.ReleaseAndGetAddressOf()));
+        return query;
+    }
+
+} // namespace d3d12on11_interop
@@ -0,0 +1,69 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace d3d12on11_interop {
+
+    // A ring of Direct3D 11 timestamp queries to measure sections of GPU work without ever stalling the CPU. The
+    // results are read back asynchronously a few frames later, and dropped if they are not available yet.
+    class GpuTimers {
+      public:
+        GpuTimers(ID3D11Device* device, ID3D11DeviceContext* context, uint32_t depth = 4);
+
+        // Bracket a section of GPU work. The key identifies the section when the results are retrieved.
+        void begin(uint64_t key);
+        void end(uint64_t key);
+
+        // Close the current frame. All sections within the frame share the same disjoint query.
+        void endFrame();
+
+        // Retrieve the results that are available, as (key, duration in microseconds).
+        void poll(const std::function<void(uint64_t key, double duration)>& callback);
+
+      private:
+        struct Section {
+            uint64_t key;
+            ComPtr<ID3D11Query> begin;
+            ComPtr<ID3D11Query> end;
+        };
+
+        struct Frame {
+            ComPtr<ID3D11Query> disjoint;
+            std::vector<Section> sections;
+            size_t sectionsUsed{0};
+            bool started{false};
+            bool pending{false};
+        };
+
+        Frame& currentFrame();
+        ComPtr<ID3D11Query> createQuery(D3D11_QUERY type);
+
+        const ComPtr<ID3D11Device> m_device;
+        const ComPtr<ID3D11DeviceContext> m_context;
+        std::vector<Frame> m_frames;
+        size_t m_currentFrame{0};
+    };
+
+} // namespace d3d12on11_interop
@@ -0,0 +1,144 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "heap_allocator.h"
+
+namespace d3d12on11_interop {
+
+    HeapAllocator::HeapAllocator(ID3D12Device* device, D3D12_HEAP_FLAGS flags, UINT64 heapSize)
+        : m_device(device), m_flags(flags), m_heapSize(heapSize) {
+    }
+
+    HeapAllocator::Allocation HeapAllocator::allocate(const D3D12_RESOURCE_ALLOCATION_INFO& info,
+                                                      UINT64 completedFenceValue) {
+        std::unique_lock lock(m_mutex);
+
+        reclaim(completedFenceValue);
+
+        const auto tryAllocate = [&](Heap& heap) -> std::optional<Allocation> {
+            for (auto it = heap.freeBlocks.begin(); it != heap.freeBlocks.end(); it++) {
+                const UINT64 offset = (it->offset + info.Alignment - 1) & ~(info.Alignment - 1);
+                if (offset + info.SizeInBytes > it->offset + it->size) {
+                    continue;
+                }
+
+                // Split the block, keeping the space before and after the allocation.
+                const Block before{it->offset, offset - it->offset};
+                const Block after{offset + info.SizeInBytes, it->offset + it->size - (offset + info.SizeInBytes)};
+                it = heap.freeBlocks.erase(it);
+                if (after.size) {
+                    it = heap.freeBlocks.insert(it, after);
+                }
+                if (before.size) {
+                    heap.freeBlocks.insert(it, before);
+                }
+
+                return Allocation{heap.heap, offset, info.SizeInBytes};
+            }
+            return {};
+        };
+
+        for (auto& heap : m_heaps) {
+            if (auto allocation = tryAllocate(heap)) {
+                m_stats.allocations++;
+                m_stats.reuses++;
+                return allocation.value();
+            }
+        }
+
+        // Create a new heap, large enough for the resource.
+        Heap heap;
+        heap.size = (std::max)(m_heapSize, info.SizeInBytes);
+        D3D12_HEAP_DESC heapDesc{};
+        heapDesc.SizeInBytes = heap.size;
+        heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+        heapDesc.Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+        heapDesc.Flags = m_flags;
+        CHECK_HRCMD(m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(heap.heap.ReleaseAndGetAddressOf())));
+        heap.freeBlocks.push_back({0, heap.size});
+        m_heaps.push_back(std::move(heap));
+        m_stats.heaps++;
+
+        m_stats.allocations++;
+        return tryAllocate(m_heaps.back()).value();
+    }
+
+    void HeapAllocator::free(const Allocation& allocation, UINT64 fenceValue) {
+        std::unique_lock lock(m_mutex);
+
+        m_pendingFrees.push_back({allocation.heap.Get(), {allocation.offset, allocation.size}, fenceValue});
+    }
+
+    std::vector<ComPtr<ID3D12Heap>> HeapAllocator::getHeaps() const {
+        std::unique_lock lock(m_mutex);
+
+        std::vector<ComPtr<ID3D12Heap>> heaps;
+        for (const auto& heap : m_heaps) {
+            heaps.push_back(heap.heap);
+        }
+        return heaps;
+    }
+
+    HeapAllocator::Statistics HeapAllocator::getStatistics() const {
+        std::unique_lock lock(m_mutex);
+
+        return m_stats;
+    }
+
+    void HeapAllocator::reclaim(UINT64 completedFenceValue) {
+        for (auto it = m_pendingFrees.begin(); it != m_pendingFrees.end();) {
+            if (it->fenceValue > completedFenceValue) {
+                it++;
+                continue;
+            }
+
+            for (auto& heap : m_heaps) {
+                if (heap.heap.Get() == it->heap) {
+                    insertFreeBlock(heap, it->block);
+                    break;
+                }
+            }
+            it = m_pendingFrees.erase(it);
+        }
+    }
+
+    void HeapAllocator::insertFreeBlock(Heap& heap, const Block& block) {
+        auto it = std::lower_bound(heap.freeBlocks.begin(),
+                                   heap.freeBlocks.end(),
+                                   block.offset,
+                                   [](const Block& entry, UINT64 offset) { return entry.offset < offset; });
+        it = heap.freeBlocks.insert(it, block);
+
+        // Merge with the next and the previous blocks.
+        if (it + 1 != heap.freeBlocks.end() && it->offset + it->size == (it + 1)->offset) {
+            it->size += (it + 1)->size;
+            heap.freeBlocks.erase(it + 1);
+        }
+        if (it != heap.freeBlocks.begin() && (it - 1)->offset + (it - 1)->size == it->offset) {
+            (it - 1)->size += it->size;
+            heap.freeBlocks.erase(it);
+        }
+    }
+
+} // namespace d3d12on11_interop
@@ -0,0 +1,95 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace d3d12on11_interop {
+
+    // Sub-allocates placed resources from a few large Direct3D 12 heaps, instead of one kernel allocation per
+    // resource. The ranges are allocated first-fit, and a freed range is only reused once the GPU is done with it, as
+    // indicated by a fence value.
+    class HeapAllocator {
+      public:
+        HeapAllocator(ID3D12Device* device, D3D12_HEAP_FLAGS flags, UINT64 heapSize);
+
+        struct Allocation {
+            ComPtr<ID3D12Heap> heap;
+            UINT64 offset{0};
+            UINT64 size{0};
+        };
+
+        // Find a range for a resource, creating a new heap if needed. The ranges freed up to the completed fence value
+        // may be reused.
+        Allocation allocate(const D3D12_RESOURCE_ALLOCATION_INFO& info, UINT64 completedFenceValue);
+
+        // Release a range. It will be reusable once the fence value is completed.
+        void free(const Allocation& allocation, UINT64 fenceValue);
+
+        std::vector<ComPtr<ID3D12Heap>> getHeaps() const;
+
+        struct Statistics {
+            uint64_t heaps{0};
+            uint64_t allocations{0};
+
+            // Number of allocations that did not require a new heap.
+            uint64_t reuses{0};
+        };
+
+        Statistics getStatistics() const;
+
+      private:
+        struct Block {
+            UINT64 offset;
+            UINT64 size;
+        };
+
+        struct Heap {
+            ComPtr<ID3D12Heap> heap;
+            UINT64 size;
+
+            // Sorted by offset, adjacent blocks are merged.
+            std::vector<Block> freeBlocks;
+        };
+
+        struct PendingFree {
+            ID3D12Heap* heap;
+            Block block;
+            UINT64 fenceValue;
+        };
+
+        void reclaim(UINT64 completedFenceValue);
+        static void insertFreeBlock(Heap& heap, const Block& block);
+
+        const ComPtr<ID3D12Device> m_device;
+        const D3D12_HEAP_FLAGS m_flags;
+        const UINT64 m_heapSize;
+
+        // Allocations may happen from the worker threads.
+        mutable std::mutex m_mutex;
+        std::vector<Heap> m_heaps;
+        std::vector<PendingFree> m_pendingFrees;
+        Statistics m_stats;
+    };
+
+} // namespace d3d12on11_interop
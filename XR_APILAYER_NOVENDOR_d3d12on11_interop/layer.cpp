@@ -26,6 +26,25 @@
 
 #include "layer.h"
 #include "log.h"
+#include "capability_cache.h"
+#include "capture.h"
+#include "copy_engine.h"
+#include "cross_adapter.h"
+#include "format_converter.h"
+#include "frame_capture.h"
+#include "gpu_timers.h"
+#include "heap_allocator.h"
+#include "memory_manager.h"
+#include "reclaimer.h"
+#include "settings.h"
+#include "stall_watchdog.h"
+#include "strategy_tuner.h"
+#include "worker_pool.h"
+#include "xr_d3d12on11_interop.h"
+
+namespace d3d12on11_interop {
+    extern std::filesystem::path localAppData;
+} // namespace d3d12on11_interop
 
 namespace {
 
@@ -38,10 +57,19 @@ namespace {
         struct Session {
             XrSession xrSession{XR_NULL_HANDLE};
 
+            // The latest state reported by the runtime (see xrPollEvent()).
+            XrSessionState state{XR_SESSION_STATE_UNKNOWN};
+
+            // The latest hint from xrWaitFrame().
+            bool shouldRender{true};
+
             // We create a D3D11 device that the runtime will be using.
             ComPtr<ID3D11Device5> d3d11Device;
             ComPtr<ID3D11DeviceContext4> d3d11Context;
 
+            // With the D3D11On12 backend, the D3D11 device wraps the app's device and queue.
+            ComPtr<ID3D11On12Device2> d3d11On12Device;
+
             // We store information about the D3D12 device that the app is using.
             ComPtr<ID3D12Device> d3d12Device;
             ComPtr<ID3D12CommandQueue> d3d12Queue;
@@ -50,6 +78,112 @@ namespace {
             ComPtr<ID3D11Fence> d3d11Fence;
             ComPtr<ID3D12Fence> d3d12Fence;
             UINT64 fenceValue{0};
+
+            // For CPU waits on the fence.
+            wil::unique_handle fenceEvent;
+
+            // The additional app queues registered with XR_NOVENDOR_d3d12on11_queues, each with its own fence.
+            struct AdditionalQueue {
+                ComPtr<ID3D12CommandQueue> queue;
+                ComPtr<ID3D11Fence> d3d11Fence;
+                ComPtr<ID3D12Fence> d3d12Fence;
+                UINT64 fenceValue{0};
+            };
+            std::vector<AdditionalQueue> additionalQueues;
+
+            // Before copying from an intermediate texture, the app's queue signals the release fence when it is done
+            // rendering to the texture.
+            ComPtr<ID3D11Fence> d3d11ReleaseFence;
+            ComPtr<ID3D12Fence> d3d12ReleaseFence;
+            UINT64 releaseFenceValue{0};
+
+            // The formats offered by the runtime, when emulating the other formats (see format_emulation).
+            std::vector<int64_t> runtimeFormats;
+
+            // The key for the capability cache entries of this session's swapchains.
+            uint64_t capabilitiesKey{0};
+
+            // For measuring the GPU time of the interop work (optional).
+            std::unique_ptr<GpuTimers> gpuTimers;
+
+            // When the runtime uses another adapter than the app (see cross_adapter), the images are transferred
+            // between the adapters. The shared fences are then cross-adapter fences.
+            std::unique_ptr<CrossAdapterTransfer> crossAdapter;
+
+            // For capturing the submitted images (optional).
+            std::unique_ptr<FrameCapture> frameCapture;
+
+            // For attributing the late frames (optional).
+            std::unique_ptr<StallWatchdog> stallWatchdog;
+
+            // For picking the sync mode and copy timing from the measured timings (optional). The candidates are
+            // evaluated again upon the next synchronized frame after a swapchain is created.
+            std::unique_ptr<StrategyTuner> tuner;
+            bool needsTuning{false};
+
+            // Accounting and residency of the layer's resources.
+            std::unique_ptr<MemoryManager> memory;
+
+            // When copying on a D3D12 copy queue (see copy_strategy), we use additional fences:
+            // - the runtime's D3D11 context signals the runtime fence when it is done reading the runtime texture;
+            // - the copy queue signals the copy fence when the copy is done.
+            ComPtr<ID3D12CommandQueue> copyQueue;
+            ComPtr<ID3D11Fence> d3d11RuntimeFence;
+            ComPtr<ID3D12Fence> d3d12RuntimeFence;
+            UINT64 runtimeFenceValue{0};
+            ComPtr<ID3D11Fence> d3d11CopyFence;
+            ComPtr<ID3D12Fence> d3d12CopyFence;
+            UINT64 copyFenceValue{0};
+
+            // With the image ring (see image_ring), the runtime's D3D11 context signals the ring fence when it is done
+            // copying from a ring image, and the app's queue waits for it before rendering to that image again.
+            ComPtr<ID3D11Fence> d3d11RingFence;
+            ComPtr<ID3D12Fence> d3d12RingFence;
+            UINT64 ringFenceValue{0};
+
+            // The heaps for the intermediate textures of the copy queue (see placed_resources).
+            std::unique_ptr<HeapAllocator> heapAllocator;
+
+            // Statistics about the synchronization, logged at the end of the session.
+            struct {
+                uint64_t frames{0};
+                uint64_t idleFrames{0};
+
+                // Frames submitting only static swapchains that were already copied, which need no synchronization.
+                uint64_t staticFrames{0};
+
+                // With the image ring, the submissions of a swapchain whose copy timed out (the runtime displays the
+                // previous image), and the layers removed because the runtime never had an image of the swapchain.
+                uint64_t staleRingSubmissions{0};
+                uint64_t removedRingLayers{0};
+                std::chrono::steady_clock::time_point firstFrameTime;
+                std::chrono::steady_clock::time_point lastFrameTime;
+                std::chrono::microseconds cpuWaitTime{0};
+                uint64_t cpuWaitTimeouts{0};
+
+                // Accumulation of the number of frames not yet completed by the GPU at xrEndFrame().
+                uint64_t framesInFlight{0};
+
+                // GPU time that the D3D11 context spent waiting on the fence (requires the GPU timers).
+                double gpuWaitTime{0};
+                uint64_t gpuWaitSamples{0};
+
+                // GPU time of the copies on the D3D11 context, for all swapchains (requires the GPU timers).
+                double gpuCopyTime{0};
+
+                // Time spent creating and importing the swapchain images (in milliseconds).
+                double swapchainImportTime{0};
+
+                // Number of swapchains released upon xrEndFrame() after the app destroyed them.
+                uint64_t releasedSwapchains{0};
+
+                // The copies from the intermediate textures, for all swapchains.
+                uint64_t copies{0};
+                uint64_t bytesCopied{0};
+
+                // CPU time spent in the frame functions, excluding the calls to the runtime.
+                std::chrono::nanoseconds cpuTime{0};
+            } stats;
         };
 
         struct Swapchain {
@@ -59,24 +193,107 @@ namespace {
             // The current image.
             uint32_t acquiredIndex{0};
 
+            // With the cross-adapter transfers, the intermediate textures opened on the runtime's adapter.
+            std::vector<ComPtr<ID3D12Resource>> crossAdapterTextures;
+
+            // The runtime image last released, which is the one submitted to the runtime.
+            std::optional<uint32_t> releasedIndex;
+
             // The parent session.
             XrSession xrSession{XR_NULL_HANDLE};
 
+            // Static swapchains (XR_SWAPCHAIN_CREATE_STATIC_IMAGE_BIT) are acquired and released only once. Their
+            // image is copied upon release, and the frames do not need to synchronize with them afterwards.
+            bool isStatic{false};
+            bool isStaticImageCopied{false};
+
+            // The capabilities found by a previous session, if any. With them, the intermediate textures may be
+            // created before the runtime returns its textures.
+            uint64_t capabilitiesKey{0};
+            std::optional<Capabilities> cachedCapabilities;
+            bool hasPrecreatedImages{false};
+
             // We import the D3D11 textures into our D3D12 device.
             std::vector<ComPtr<ID3D12Resource>> d3d12Textures;
 
             // If the runtime texture is not shareable, we must use an intermediate texture. We also save the original
-            // texture from the runtime.
+            // textures from the runtime (in all cases, see frame_capture).
             std::vector<ComPtr<ID3D11Texture2D>> intermediateTextures;
             std::vector<ComPtr<ID3D11Texture2D>> d3d11Textures;
+            std::unique_ptr<D3D11CopyEngine> copyEngine;
+
+            // For a format emulated by the layer, the format of the runtime textures. The intermediate textures are
+            // converted instead of copied.
+            DXGI_FORMAT runtimeFormat{DXGI_FORMAT_UNKNOWN};
+            std::unique_ptr<FormatConverter> formatConverter;
+
+            // When copying on the D3D12 copy queue, the intermediate textures are D3D12 resources (in d3d12Textures)
+            // and we import the runtime textures into D3D12. The command lists are recorded once and re-submitted
+            // for each copy, so there is no allocation per frame.
+            std::vector<ComPtr<ID3D12Resource>> d3d12RuntimeTextures;
+            ComPtr<ID3D12CommandAllocator> directCommandAllocator;
+            ComPtr<ID3D12CommandAllocator> copyCommandAllocator;
+            std::vector<HeapAllocator::Allocation> placedAllocations;
+            struct CopyCommands {
+                // Transition the intermediate texture to and from the common state, usable by the copy queue.
+                ComPtr<ID3D12GraphicsCommandList> toCommonState;
+                ComPtr<ID3D12GraphicsCommandList> toAppState;
+
+                ComPtr<ID3D12GraphicsCommandList> copy;
+
+                // The copy fence value for the last copy, until the texture is returned to the app's state.
+                UINT64 pendingCopyFenceValue{0};
+            };
+            std::vector<CopyCommands> copyCommands;
+
+            // With the D3D11On12 backend, the app renders directly to the resources underlying the runtime textures,
+            // between their unwrapping upon xrAcquireSwapchainImage() and their return upon xrReleaseSwapchainImage().
+            // Only the transitions are used.
+            std::vector<CopyCommands> unwrapCommands;
+
+            // With the image ring, the app renders to ringDepth layer-owned images (in intermediateTextures) and the
+            // runtime images (in d3d11Textures) are only acquired upon xrEndFrame().
+            uint32_t ringDepth{0};
+            uint32_t nextRingIndex{0};
+            std::optional<uint32_t> ringReleasedIndex;
+
+            // The ring fence value for the last copy from each ring image.
+            std::vector<UINT64> ringFenceValues;
+
+            // The runtime image acquired for a copy whose wait timed out, to wait for again upon the next frame.
+            std::optional<uint32_t> ringRuntimeIndex;
+
+            // The size of the runtime texture, accounted for each copy.
+            uint64_t bytesPerCopy{0};
+
+            // The image released while the session was idle, that must be copied before the next frame that
+            // submits layers. The runtime image is only released to the runtime once the copy is made, so that the
+            // runtime never reads it before the copy.
+            std::optional<uint32_t> deferredCopyIndex;
+
+            // Statistics about the copies, logged when the swapchain is destroyed.
+            struct {
+                uint64_t copies{0};
+                uint64_t deferredCopies{0};
+
+                // Deferred copies dropped because the app acquired another image while the session was idle.
+                uint64_t droppedCopies{0};
+
+                // GPU time of the copies (requires the GPU timers).
+                double gpuCopyTime{0};
+                uint64_t gpuCopySamples{0};
+            } stats;
         };
 
       public:
         OpenXrLayer() = default;
 
         ~OpenXrLayer() override {
+            // When the app exits without destroying the instance, we are called upon process exit under the loader
+            // lock, where no thread can start: the sessions are released on this thread. The jobs already deferred
+            // are completed by the reclaimer's destructor (unless the process is exiting).
             while (m_sessions.size()) {
-                cleanupSession(m_sessions.begin()->second);
+                cleanupSession(m_sessions.begin()->second, false);
                 m_sessions.erase(m_sessions.begin());
             }
         }
@@ -85,8 +302,22 @@ namespace {
             const std::string apiName(name);
             XrResult result = XR_SUCCESS;
 
+            // The functions of our extensions are only available when the app enabled them.
+            if ((!m_queuesExtensionEnabled &&
+                 (apiName == "xrRegisterD3D12QueueNOVENDOR" || apiName == "xrUnregisterD3D12QueueNOVENDOR")) ||
+                (!m_statisticsExtensionEnabled && apiName == "xrGetD3D12on11StatisticsNOVENDOR")) {
+                *function = nullptr;
+                return XR_ERROR_FUNCTION_UNSUPPORTED;
+            }
+
             if (apiName == "xrGetD3D12GraphicsRequirementsKHR") {
                 *function = reinterpret_cast<PFN_xrVoidFunction>(wrapper_xrGetD3D12GraphicsRequirementsKHR);
+            } else if (apiName == "xrRegisterD3D12QueueNOVENDOR") {
+                *function = reinterpret_cast<PFN_xrVoidFunction>(wrapper_xrRegisterD3D12QueueNOVENDOR);
+            } else if (apiName == "xrUnregisterD3D12QueueNOVENDOR") {
+                *function = reinterpret_cast<PFN_xrVoidFunction>(wrapper_xrUnregisterD3D12QueueNOVENDOR);
+            } else if (apiName == "xrGetD3D12on11StatisticsNOVENDOR") {
+                *function = reinterpret_cast<PFN_xrVoidFunction>(wrapper_xrGetD3D12on11StatisticsNOVENDOR);
             } else {
                 result = OpenXrApi::xrGetInstanceProcAddr(instance, name, function);
             }
@@ -97,6 +328,16 @@ namespace {
             // Needed to resolve the requested function pointers.
             OpenXrApi::xrCreateInstance(createInfo);
 
+            m_queuesExtensionEnabled = m_statisticsExtensionEnabled = false;
+            for (uint32_t i = 0; i < createInfo->enabledExtensionCount; i++) {
+                const std::string_view ext(createInfo->enabledExtensionNames[i]);
+                if (ext == XR_NOVENDOR_D3D12ON11_QUEUES_EXTENSION_NAME) {
+                    m_queuesExtensionEnabled = true;
+                } else if (ext == XR_NOVENDOR_D3D12ON11_STATISTICS_EXTENSION_NAME) {
+                    m_statisticsExtensionEnabled = true;
+                }
+            }
+
             // TODO: This should be auto-generated in the call above, but today our generator only looks at core spec.
             // We allow this call to fail, in case the app creates a bootstrap instance without requesting D3D11
             // support.
@@ -114,6 +355,25 @@ namespace {
                                                  XR_VERSION_PATCH(instanceProperties.runtimeVersion));
             Log("Application: %s\n", GetApplicationName().c_str());
             Log("Using OpenXR runtime: %s\n", runtimeName.c_str());
+            m_runtimeName = runtimeName;
+
+            // Load the settings for this application.
+            m_settings = settings::Load(GetApplicationName());
+            Log("Settings:\n");
+            settings::Dump(m_settings);
+
+            EnableDebugLog(m_settings.logLevel == settings::LogLevel::Verbose);
+            if (m_settings.capture && !capture::IsEnabled()) {
+                capture::Start(localAppData / (LayerName + ".capture"));
+            }
+
+            if (m_settings.workerThread && !m_workerPool) {
+                m_workerPool = std::make_unique<WorkerPool>(m_settings.poolSize);
+            }
+
+            if (!m_capabilityCache) {
+                m_capabilityCache = std::make_unique<CapabilityCache>(localAppData / (LayerName + ".caps"));
+            }
 
             return XR_SUCCESS;
         }
@@ -132,6 +392,162 @@ namespace {
             return result;
         }
 
+        XrResult xrRegisterD3D12QueueNOVENDOR(XrSession session, ID3D12CommandQueue* queue) {
+            if (!isSessionHandled(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+
+            auto& sessionState = m_sessions[session];
+            if (!queue || queue == sessionState.d3d12Queue.Get() ||
+                std::any_of(sessionState.additionalQueues.cbegin(),
+                            sessionState.additionalQueues.cend(),
+                            [&](const Session::AdditionalQueue& entry) { return entry.queue.Get() == queue; })) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+
+            Session::AdditionalQueue newQueue;
+            newQueue.queue = queue;
+            CHECK_HRCMD(sessionState.d3d12Device->CreateFence(
+                0,
+                sessionState.crossAdapter ? D3D12_FENCE_FLAG_SHARED | D3D12_FENCE_FLAG_SHARED_CROSS_ADAPTER
+                                          : D3D12_FENCE_FLAG_SHARED,
+                IID_PPV_ARGS(newQueue.d3d12Fence.ReleaseAndGetAddressOf())));
+            wil::unique_handle fenceHandle;
+            if (!sessionState.d3d11On12Device) {
+                CHECK_HRCMD(sessionState.d3d12Device->CreateSharedHandle(
+                    newQueue.d3d12Fence.Get(), nullptr, GENERIC_ALL, nullptr, fenceHandle.put()));
+                CHECK_HRCMD(sessionState.d3d11Device->OpenSharedFence(
+                    fenceHandle.get(), IID_PPV_ARGS(newQueue.d3d11Fence.ReleaseAndGetAddressOf())));
+            }
+            sessionState.additionalQueues.push_back(std::move(newQueue));
+
+            Log("Registered additional queue (%zu total)\n", sessionState.additionalQueues.size());
+
+            return XR_SUCCESS;
+        }
+
+        XrResult xrUnregisterD3D12QueueNOVENDOR(XrSession session, ID3D12CommandQueue* queue) {
+            if (!isSessionHandled(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+
+            auto& queues = m_sessions[session].additionalQueues;
+            const auto it = std::find_if(queues.begin(), queues.end(), [&](const Session::AdditionalQueue& entry) {
+                return entry.queue.Get() == queue;
+            });
+            if (it == queues.end()) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+            queues.erase(it);
+
+            return XR_SUCCESS;
+        }
+
+        XrResult xrGetD3D12on11StatisticsNOVENDOR(XrSession session, XrD3D12on11StatisticsNOVENDOR* statistics) {
+            if (!isSessionHandled(session)) {
+                return XR_ERROR_HANDLE_INVALID;
+            }
+            if (!statistics || statistics->type != XR_TYPE_D3D12ON11_STATISTICS_NOVENDOR) {
+                return XR_ERROR_VALIDATION_FAILURE;
+            }
+
+            const auto& sessionState = m_sessions[session];
+            const auto& stats = sessionState.stats;
+            statistics->frameCount = stats.frames;
+            statistics->copyCount = stats.copies;
+            statistics->bytesCopied = stats.bytesCopied;
+            statistics->cpuFenceWaitTime =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(stats.cpuWaitTime).count();
+            statistics->gpuFenceWaitTime = (XrDuration)(stats.gpuWaitTime * 1000);
+            statistics->cpuTime = stats.cpuTime.count();
+            statistics->intermediateMemoryBytes = sessionState.memory->getStatistics().allocatedBytes;
+
+            return XR_SUCCESS;
+        }
+
+        XrResult xrEnumerateInstanceExtensionProperties(const char* layerName,
+                                                        uint32_t propertyCapacityInput,
+                                                        uint32_t* propertyCountOutput,
+                                                        XrExtensionProperties* properties) override {
+            static const std::vector<std::pair<const char*, uint32_t>> layerExtensions = {
+                {XR_NOVENDOR_D3D12ON11_QUEUES_EXTENSION_NAME, XR_NOVENDOR_d3d12on11_queues_SPEC_VERSION},
+                {XR_NOVENDOR_D3D12ON11_STATISTICS_EXTENSION_NAME, XR_NOVENDOR_d3d12on11_statistics_SPEC_VERSION},
+            };
+
+            // Start with the runtime's extensions, unless the app is querying our layer.
+            std::vector<XrExtensionProperties> extensions;
+            if (!layerName || LayerName != layerName) {
+                uint32_t count = 0;
+                const XrResult result =
+                    OpenXrApi::xrEnumerateInstanceExtensionProperties(layerName, 0, &count, nullptr);
+                if (XR_FAILED(result)) {
+                    return result;
+                }
+                extensions.resize(count, {XR_TYPE_EXTENSION_PROPERTIES});
+                CHECK_XRCMD(OpenXrApi::xrEnumerateInstanceExtensionProperties(
+                    layerName, count, &count, extensions.data()));
+                extensions.resize(count);
+            }
+
+            // Then advertise ours, when enumerating all the extensions or those of our layer.
+            if (!layerName || LayerName == layerName) {
+                for (const auto& [extensionName, extensionVersion] : layerExtensions) {
+                    if (std::none_of(extensions.cbegin(), extensions.cend(), [&](const XrExtensionProperties& entry) {
+                            return !strcmp(entry.extensionName, extensionName);
+                        })) {
+                        XrExtensionProperties extension{XR_TYPE_EXTENSION_PROPERTIES};
+                        strncpy_s(extension.extensionName, extensionName, _TRUNCATE);
+                        extension.extensionVersion = extensionVersion;
+                        extensions.push_back(extension);
+                    }
+                }
+            }
+
+            *propertyCountOutput = (uint32_t)extensions.size();
+            if (propertyCapacityInput == 0) {
+                return XR_SUCCESS;
+            }
+            if (propertyCapacityInput < extensions.size()) {
+                return XR_ERROR_SIZE_INSUFFICIENT;
+            }
+            for (uint32_t i = 0; i < extensions.size(); i++) {
+                // Preserve the app's chain.
+                properties[i].extensionVersion = extensions[i].extensionVersion;
+                memcpy(properties[i].extensionName, extensions[i].extensionName, sizeof(extensions[i].extensionName));
+            }
+
+            return XR_SUCCESS;
+        }
+
+        XrResult xrPollEvent(XrInstance instance, XrEventDataBuffer* eventData) override {
+            const XrResult result = OpenXrApi::xrPollEvent(instance, eventData);
+            if (result == XR_SUCCESS && eventData->type == XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED) {
+                const XrEventDataSessionStateChanged* stateChanged =
+                    reinterpret_cast<const XrEventDataSessionStateChanged*>(eventData);
+                if (isSessionHandled(stateChanged->session)) {
+                    auto& sessionState = m_sessions[stateChanged->session];
+                    sessionState.state = stateChanged->state;
+
+                    // Let our resources be paged out while nothing is displayed, once the GPU is done with them.
+                    const bool isVisible = stateChanged->state == XR_SESSION_STATE_VISIBLE ||
+                                           stateChanged->state == XR_SESSION_STATE_FOCUSED;
+                    if (isVisible) {
+                        sessionState.memory->setResident(true);
+                    } else {
+                        evictWhenIdle(sessionState);
+                    }
+                    sessionState.memory->checkBudget();
+                }
+            }
+
+            // The app may stop submitting frames while the session is not visible, but it keeps polling the events.
+            for (auto& [xrSession, sessionState] : m_sessions) {
+                sessionState.memory->poll();
+            }
+
+            return result;
+        }
+
         XrResult xrGetSystem(XrInstance instance, const XrSystemGetInfo* getInfo, XrSystemId* systemId) override {
             const XrResult result = OpenXrApi::xrGetSystem(instance, getInfo, systemId);
             if (XR_SUCCEEDED(result) && getInfo->formFactor == XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY &&
@@ -193,10 +609,42 @@ namespace {
 
                                     // Log the adapter name to help debugging customer issues.
                                     Log("Using Direct3D 12 on adapter: %s\n", adapterDescription.c_str());
+
+                                    LARGE_INTEGER driverVersion{};
+                                    dxgiAdapter->CheckInterfaceSupport(__uuidof(IDXGIDevice), &driverVersion);
+                                    newSession.capabilitiesKey =
+                                        CapabilityCache::MakeKey(m_runtimeName, adapterLuid, driverVersion.QuadPart);
                                     break;
                                 }
                             }
 
+                            // With cross_adapter, the runtime may composite on another adapter than the one the app
+                            // renders on, in which case the interop device is created on the runtime's adapter.
+                            ComPtr<IDXGIAdapter1> runtimeAdapter = dxgiAdapter;
+                            bool isCrossAdapter = false;
+                            const bool useD3D11On12 = m_settings.backend == settings::Backend::D3D11On12;
+                            if (m_settings.crossAdapter && !useD3D11On12) {
+                                XrGraphicsRequirementsD3D11KHR requirements{XR_TYPE_GRAPHICS_REQUIREMENTS_D3D11_KHR};
+                                CHECK_XRCMD(
+                                    xrGetD3D11GraphicsRequirementsKHR(instance, createInfo->systemId, &requirements));
+                                isCrossAdapter = memcmp(&requirements.adapterLuid, &adapterLuid, sizeof(LUID));
+                                for (UINT adapterIndex = 0; isCrossAdapter; adapterIndex++) {
+                                    CHECK_HRCMD(dxgiFactory->EnumAdapters1(adapterIndex,
+                                                                           runtimeAdapter.ReleaseAndGetAddressOf()));
+
+                                    DXGI_ADAPTER_DESC1 adapterDesc;
+                                    CHECK_HRCMD(runtimeAdapter->GetDesc1(&adapterDesc));
+                                    if (!memcmp(&adapterDesc.AdapterLuid, &requirements.adapterLuid, sizeof(LUID))) {
+                                        Log("The runtime uses another adapter, transferring the images across "
+                                            "adapters\n");
+                                        break;
+                                    }
+                                }
+                            }
+                            const D3D12_FENCE_FLAGS fenceFlags =
+                                isCrossAdapter ? D3D12_FENCE_FLAG_SHARED | D3D12_FENCE_FLAG_SHARED_CROSS_ADAPTER
+                                               : D3D12_FENCE_FLAG_SHARED;
+
                             // Create the interop device that the runtime will be using.
                             ComPtr<ID3D11Device> device;
                             ComPtr<ID3D11DeviceContext> deviceContext;
@@ -205,16 +653,35 @@ namespace {
 #ifdef _DEBUG
                             flags |= D3D11_CREATE_DEVICE_DEBUG;
 #endif
-                            CHECK_HRCMD(D3D11CreateDevice(dxgiAdapter.Get(),
-                                                          D3D_DRIVER_TYPE_UNKNOWN,
-                                                          0,
-                                                          flags,
-                                                          &featureLevel,
-                                                          1,
-                                                          D3D11_SDK_VERSION,
-                                                          device.ReleaseAndGetAddressOf(),
-                                                          nullptr,
-                                                          deviceContext.ReleaseAndGetAddressOf()));
+                            if (useD3D11On12) {
+                                // The D3D11 device submits its work to the app's queue, so the runtime's work is
+                                // naturally ordered after the app's work.
+                                IUnknown* const queues[] = {newSession.d3d12Queue.Get()};
+                                CHECK_HRCMD(D3D11On12CreateDevice(newSession.d3d12Device.Get(),
+                                                                  flags,
+                                                                  &featureLevel,
+                                                                  1,
+                                                                  queues,
+                                                                  1,
+                                                                  0,
+                                                                  device.ReleaseAndGetAddressOf(),
+                                                                  deviceContext.ReleaseAndGetAddressOf(),
+                                                                  nullptr));
+                                CHECK_HRCMD(
+                                    device->QueryInterface(newSession.d3d11On12Device.ReleaseAndGetAddressOf()));
+                                Log("Using the Direct3D 11On12 backend\n");
+                            } else {
+                                CHECK_HRCMD(D3D11CreateDevice(runtimeAdapter.Get(),
+                                                              D3D_DRIVER_TYPE_UNKNOWN,
+                                                              0,
+                                                              flags,
+                                                              &featureLevel,
+                                                              1,
+                                                              D3D11_SDK_VERSION,
+                                                              device.ReleaseAndGetAddressOf(),
+                                                              nullptr,
+                                                              deviceContext.ReleaseAndGetAddressOf()));
+                            }
 
                             // Query the necessary flavors of device & device context, which will let us use fences.
                             CHECK_HRCMD(device->QueryInterface(newSession.d3d11Device.ReleaseAndGetAddressOf()));
@@ -224,14 +691,75 @@ namespace {
                             // We will use a shared fence to synchronize between the D3D12 queue and the D3D11
                             // context.
                             CHECK_HRCMD(newSession.d3d12Device->CreateFence(
-                                0,
-                                D3D12_FENCE_FLAG_SHARED,
-                                IID_PPV_ARGS(newSession.d3d12Fence.ReleaseAndGetAddressOf())));
+                                0, fenceFlags, IID_PPV_ARGS(newSession.d3d12Fence.ReleaseAndGetAddressOf())));
                             wil::unique_handle fenceHandle = nullptr;
                             CHECK_HRCMD(newSession.d3d12Device->CreateSharedHandle(
                                 newSession.d3d12Fence.Get(), nullptr, GENERIC_ALL, nullptr, fenceHandle.put()));
-                            newSession.d3d11Device->OpenSharedFence(
-                                fenceHandle.get(), IID_PPV_ARGS(newSession.d3d11Fence.ReleaseAndGetAddressOf()));
+                            *newSession.fenceEvent.put() = CreateEventEx(nullptr, L"Sync Fence", 0, EVENT_ALL_ACCESS);
+                            CHECK_HRCMD(newSession.d3d12Device->CreateFence(
+                                0, fenceFlags, IID_PPV_ARGS(newSession.d3d12ReleaseFence.ReleaseAndGetAddressOf())));
+
+                            // With D3D11On12, there is no other device to synchronize with.
+                            if (!useD3D11On12) {
+                                newSession.d3d11Device->OpenSharedFence(
+                                    fenceHandle.get(), IID_PPV_ARGS(newSession.d3d11Fence.ReleaseAndGetAddressOf()));
+
+                                CHECK_HRCMD(
+                                    newSession.d3d12Device->CreateSharedHandle(newSession.d3d12ReleaseFence.Get(),
+                                                                               nullptr,
+                                                                               GENERIC_ALL,
+                                                                               nullptr,
+                                                                               fenceHandle.put()));
+                                CHECK_HRCMD(newSession.d3d11Device->OpenSharedFence(
+                                    fenceHandle.get(),
+                                    IID_PPV_ARGS(newSession.d3d11ReleaseFence.ReleaseAndGetAddressOf())));
+                            }
+
+                            // The budget is only available on Windows 10 and above.
+                            ComPtr<IDXGIAdapter3> dxgiAdapter3;
+                            dxgiAdapter->QueryInterface(IID_PPV_ARGS(dxgiAdapter3.ReleaseAndGetAddressOf()));
+                            newSession.memory =
+                                std::make_unique<MemoryManager>(newSession.d3d12Device.Get(), dxgiAdapter3.Get());
+
+                            if (isCrossAdapter) {
+                                newSession.crossAdapter =
+                                    std::make_unique<CrossAdapterTransfer>(newSession.d3d12Device.Get(),
+                                                                           newSession.d3d12Queue.Get(),
+                                                                           runtimeAdapter.Get(),
+                                                                           newSession.d3d11Device.Get(),
+                                                                           newSession.d3d11Context.Get());
+                            }
+
+                            if (m_settings.gpuTimers) {
+                                newSession.gpuTimers = std::make_unique<GpuTimers>(newSession.d3d11Device.Get(),
+                                                                                   newSession.d3d11Context.Get());
+                            }
+
+                            if (m_settings.frameCapture) {
+                                const auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+                                    std::chrono::system_clock::now().time_since_epoch());
+                                newSession.frameCapture = std::make_unique<FrameCapture>(
+                                    newSession.d3d11Device.Get(),
+                                    newSession.d3d11Context.Get(),
+                                    localAppData / (LayerName + ".frames") / std::to_string(timestamp.count()),
+                                    m_settings.frameCaptureDepth);
+                            }
+
+                            if (m_settings.autoTune != settings::AutoTune::Off) {
+                                newSession.tuner = std::make_unique<StrategyTuner>(
+                                    Strategy{m_settings.syncMode, m_settings.copyTiming});
+                                if (!newSession.gpuTimers) {
+                                    Log("The GPU time of the strategies is not measured without gpu_timers\n");
+                                }
+                            }
+
+                            if (m_settings.stallWatchdog) {
+                                newSession.stallWatchdog =
+                                    std::make_unique<StallWatchdog>(newSession.d3d11Device.Get(),
+                                                                    newSession.d3d11Context.Get(),
+                                                                    newSession.d3d12Fence.Get(),
+                                                                    m_settings.stallWatchdog);
+                            }
                         }
 
                         // Fill out the struct that we are passing to the OpenXR runtime.
@@ -263,7 +791,7 @@ namespace {
                 if (XR_SUCCEEDED(result)) {
                     // On success, record the state.
                     newSession.xrSession = *session;
-                    m_sessions.insert_or_assign(*session, newSession);
+                    m_sessions.insert_or_assign(*session, std::move(newSession));
                 }
             }
             return result;
@@ -274,19 +802,47 @@ namespace {
             if (XR_SUCCEEDED(result) && isSessionHandled(session)) {
                 auto& sessionState = m_sessions[session];
 
-                cleanupSession(sessionState);
+                cleanupSession(sessionState, true);
                 m_sessions.erase(session);
             }
 
             return result;
         }
 
+        XrResult xrEnumerateSwapchainFormats(XrSession session,
+                                             uint32_t formatCapacityInput,
+                                             uint32_t* formatCountOutput,
+                                             int64_t* formats) override {
+            if (!isSessionHandled(session) || !canEmulateFormats(m_sessions[session])) {
+                return OpenXrApi::xrEnumerateSwapchainFormats(session, formatCapacityInput, formatCountOutput, formats);
+            }
+
+            // The emulated formats come last, so that the app prefers the runtime's formats.
+            const auto& runtimeFormats = getRuntimeFormats(m_sessions[session]);
+            const auto emulatedFormats = GetEmulatedFormats(runtimeFormats);
+            *formatCountOutput = (uint32_t)(runtimeFormats.size() + emulatedFormats.size());
+            if (formatCapacityInput == 0) {
+                return XR_SUCCESS;
+            }
+            if (formatCapacityInput < *formatCountOutput) {
+                return XR_ERROR_SIZE_INSUFFICIENT;
+            }
+
+            std::copy(runtimeFormats.cbegin(), runtimeFormats.cend(), formats);
+            std::copy(emulatedFormats.cbegin(), emulatedFormats.cend(), formats + runtimeFormats.size());
+
+            return XR_SUCCESS;
+        }
+
         XrResult xrCreateSwapchain(XrSession session,
                                    const XrSwapchainCreateInfo* createInfo,
                                    XrSwapchain* swapchain) override {
             Swapchain newSwapchain;
             bool handled = false;
 
+            // For an emulated format, the runtime creates textures of the closest format, that we render to.
+            XrSwapchainCreateInfo runtimeCreateInfo = *createInfo;
+
             if (isSessionHandled(session)) {
                 Log("Creating swapchain with dimensions=%ux%u, arraySize=%u, mipCount=%u, sampleCount=%u, format=%d, "
                     "usage=0x%x\n",
@@ -300,17 +856,50 @@ namespace {
 
                 newSwapchain.xrSession = session;
                 newSwapchain.createInfo = *createInfo;
+                newSwapchain.isStatic = createInfo->createFlags & XR_SWAPCHAIN_CREATE_STATIC_IMAGE_BIT;
+
+                auto& sessionState = m_sessions[session];
+                newSwapchain.capabilitiesKey = CapabilityCache::MakeKey(sessionState.capabilitiesKey, *createInfo);
+                newSwapchain.cachedCapabilities = m_capabilityCache->lookup(newSwapchain.capabilitiesKey);
+
+                // The conversion pass does not resolve multisampled textures.
+                if (canEmulateFormats(sessionState) && createInfo->sampleCount == 1) {
+                    const auto& runtimeFormats = getRuntimeFormats(sessionState);
+                    if (std::find(runtimeFormats.cbegin(), runtimeFormats.cend(), createInfo->format) ==
+                        runtimeFormats.cend()) {
+                        newSwapchain.runtimeFormat =
+                            FindEmulationFormat((DXGI_FORMAT)createInfo->format, runtimeFormats);
+                    }
+                }
+                if (newSwapchain.runtimeFormat != DXGI_FORMAT_UNKNOWN) {
+                    Log("Emulating format %d with format %d\n", createInfo->format, newSwapchain.runtimeFormat);
+                    runtimeCreateInfo.format = newSwapchain.runtimeFormat;
+                    runtimeCreateInfo.usageFlags |= XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
+                }
+
+                // Static images are acquired only once, there is nothing to decouple. The ring images are copied, not
+                // converted. The intermediate textures created ahead of time would not have the app's format.
+                const bool isEmulated = newSwapchain.runtimeFormat != DXGI_FORMAT_UNKNOWN;
+                if (m_settings.imageRing && !(createInfo->createFlags & XR_SWAPCHAIN_CREATE_STATIC_IMAGE_BIT) &&
+                    !sessionState.crossAdapter && !sessionState.d3d11On12Device && !isEmulated) {
+                    newSwapchain.ringDepth = std::clamp(m_settings.imageRing, 2u, 8u);
+                } else if (!isEmulated) {
+                    precreateImages(sessionState, newSwapchain);
+                }
 
                 // The rest will be filled in by xrEnumerateSwapchainImages().
 
                 handled = true;
             }
 
-            const XrResult result = OpenXrApi::xrCreateSwapchain(session, createInfo, swapchain);
+            const XrResult result = OpenXrApi::xrCreateSwapchain(session, &runtimeCreateInfo, swapchain);
             if (XR_SUCCEEDED(result) && handled) {
                 // On success, record the state.
                 newSwapchain.xrSwapchain = *swapchain;
-                m_swapchains.insert_or_assign(*swapchain, newSwapchain);
+                m_swapchains.insert_or_assign(*swapchain, std::move(newSwapchain));
+
+                auto& sessionState = m_sessions[session];
+                sessionState.needsTuning = sessionState.tuner != nullptr;
             }
 
             return result;
@@ -319,6 +908,17 @@ namespace {
         XrResult xrDestroySwapchain(XrSwapchain swapchain) override {
             const XrResult result = OpenXrApi::xrDestroySwapchain(swapchain);
             if (XR_SUCCEEDED(result) && isSwapchainHandled(swapchain)) {
+                auto& swapchainState = m_swapchains[swapchain];
+                auto& sessionState = m_sessions[swapchainState.xrSession];
+                logSwapchainStatistics(swapchainState);
+
+                // The GPU might still use the textures. They are released by a later xrEndFrame(), once the next
+                // frame's fence signal is completed.
+                RetiredSwapchain retired;
+                retired.fenceValue = sessionState.fenceValue + 1;
+                retired.copyFenceValue = sessionState.copyFenceValue;
+                retired.swapchain = std::move(swapchainState);
+                m_retiredSwapchains.push_back(std::move(retired));
                 m_swapchains.erase(swapchain);
             }
 
@@ -329,10 +929,47 @@ namespace {
                                             uint32_t imageCapacityInput,
                                             uint32_t* imageCountOutput,
                                             XrSwapchainImageBaseHeader* images) override {
+            if (isSwapchainHandled(swapchain) && m_swapchains[swapchain].ringDepth) {
+                auto& swapchainState = m_swapchains[swapchain];
+                *imageCountOutput = swapchainState.ringDepth;
+                if (imageCapacityInput == 0) {
+                    return XR_SUCCESS;
+                }
+                if (imageCapacityInput < swapchainState.ringDepth) {
+                    return XR_ERROR_SIZE_INSUFFICIENT;
+                }
+
+                if (swapchainState.d3d12Textures.empty()) {
+                    createImageRing(m_sessions[swapchainState.xrSession], swapchainState);
+                }
+                XrSwapchainImageD3D12KHR* d3d12Images = reinterpret_cast<XrSwapchainImageD3D12KHR*>(images);
+                for (uint32_t i = 0; i < swapchainState.ringDepth; i++) {
+                    d3d12Images[i].texture = swapchainState.d3d12Textures[i].Get();
+                }
+
+                return XR_SUCCESS;
+            }
+
             if (!isSwapchainHandled(swapchain) || imageCapacityInput == 0) {
                 return OpenXrApi::xrEnumerateSwapchainImages(swapchain, imageCapacityInput, imageCountOutput, images);
             }
 
+            // The app may enumerate the images several times: return the images created the first time.
+            if (!m_swapchains[swapchain].d3d11Textures.empty()) {
+                const auto& swapchainState = m_swapchains[swapchain];
+                *imageCountOutput = (uint32_t)swapchainState.d3d12Textures.size();
+                if (imageCapacityInput < *imageCountOutput) {
+                    return XR_ERROR_SIZE_INSUFFICIENT;
+                }
+
+                XrSwapchainImageD3D12KHR* d3d12Images = reinterpret_cast<XrSwapchainImageD3D12KHR*>(images);
+                for (uint32_t i = 0; i < *imageCountOutput; i++) {
+                    d3d12Images[i].texture = swapchainState.d3d12Textures[i].Get();
+                }
+
+                return XR_SUCCESS;
+            }
+
             // Enumerate the D3D11 swapchain images.
             std::vector<XrSwapchainImageD3D11KHR> d3d11Images(imageCapacityInput, {XR_TYPE_SWAPCHAIN_IMAGE_D3D11_KHR});
             const XrResult result = OpenXrApi::xrEnumerateSwapchainImages(
@@ -344,69 +981,219 @@ namespace {
                 auto& swapchainState = m_swapchains[swapchain];
                 auto& sessionState = m_sessions[swapchainState.xrSession];
 
+                const auto startTime = std::chrono::steady_clock::now();
+                const uint32_t imageCount = *imageCountOutput;
+
                 D3D11_TEXTURE2D_DESC desc;
                 d3d11Images[0].texture->GetDesc(&desc);
 
-                const bool isShareable = (desc.MiscFlags & D3D11_RESOURCE_MISC_SHARED);
+                const bool isRuntimeShareable = (desc.MiscFlags & D3D11_RESOURCE_MISC_SHARED);
                 const bool isNtHandle = (desc.MiscFlags & D3D11_RESOURCE_MISC_SHARED_NTHANDLE);
 
-                // Export each D3D11 texture to D3D12.
-                XrSwapchainImageD3D12KHR* d3d12Images = reinterpret_cast<XrSwapchainImageD3D12KHR*>(images);
-                for (uint32_t i = 0; i < *imageCountOutput; i++) {
-                    // Dump the runtime texture descriptor.
-                    if (i == 0) {
-                        Log("Swapchain image descriptor:\n");
-                        Log("  w=%u h=%u arraySize=%u format=%u\n",
-                            desc.Width,
-                            desc.Height,
-                            desc.ArraySize,
-                            desc.Format);
-                        Log("  mipCount=%u sampleCount=%u\n", desc.MipLevels, desc.SampleDesc.Count);
-                        Log("  usage=0x%x bindFlags=0x%x cpuFlags=0x%x misc=0x%x\n",
-                            desc.Usage,
-                            desc.BindFlags,
-                            desc.CPUAccessFlags,
-                            desc.MiscFlags);
-
-                        Log("Textures are %s\n", isShareable ? "shareable" : "NOT shareable");
+                // Dump the runtime texture descriptor.
+                Log("Swapchain image descriptor:\n");
+                Log("  w=%u h=%u arraySize=%u format=%u\n", desc.Width, desc.Height, desc.ArraySize, desc.Format);
+                Log("  mipCount=%u sampleCount=%u\n", desc.MipLevels, desc.SampleDesc.Count);
+                Log("  usage=0x%x bindFlags=0x%x cpuFlags=0x%x misc=0x%x\n",
+                    desc.Usage,
+                    desc.BindFlags,
+                    desc.CPUAccessFlags,
+                    desc.MiscFlags);
+                Log("Textures are %s\n", isRuntimeShareable ? "shareable" : "NOT shareable");
+
+                if (sessionState.d3d11On12Device) {
+                    unwrapImages(sessionState, swapchainState, d3d11Images, imageCount, images);
+                    return result;
+                }
+
+                // Textures are transferred across adapters through buffers, which cannot hold multisampled textures.
+                if (sessionState.crossAdapter && desc.SampleDesc.Count > 1) {
+                    Log("Multisampled swapchains cannot be transferred across adapters\n");
+                    return XR_ERROR_RUNTIME_FAILURE;
+                }
+
+                // An emulated format is converted from an intermediate texture of the app's format, like a texture
+                // that is not shareable is copied.
+                const bool isEmulated = swapchainState.runtimeFormat != DXGI_FORMAT_UNKNOWN;
+                const bool isShareable = isRuntimeShareable && !isEmulated;
+                D3D11_TEXTURE2D_DESC intermediateDesc = desc;
+                if (isEmulated) {
+                    intermediateDesc.Format = (DXGI_FORMAT)swapchainState.createInfo.format;
+                    intermediateDesc.BindFlags |= D3D11_BIND_SHADER_RESOURCE;
+                }
+
+                // When requested, try to perform the copies on a D3D12 copy queue. This requires importing the runtime
+                // textures into D3D12, which the runtime or the driver may not allow. A static image is copied only
+                // once, on the Direct3D 11 context, so that the runtime reads it without any further synchronization.
+                const auto& cachedCapabilities = swapchainState.cachedCapabilities;
+                const bool tryCopyQueue = !isShareable && !swapchainState.isStatic && !sessionState.crossAdapter &&
+                                          !isEmulated &&
+                                          m_settings.copyStrategy == settings::CopyStrategy::D3D12CopyQueue;
+                bool useCopyQueue = false;
+                if (tryCopyQueue && cachedCapabilities && cachedCapabilities->importTested &&
+                    !cachedCapabilities->importable) {
+                    Log("Textures cannot be imported (cached), copying on Direct3D 11 instead\n");
+                } else if (tryCopyQueue) {
+                    swapchainState.d3d12RuntimeTextures.resize(imageCount);
+                    forEachImage(imageCount, [&](uint32_t i) {
+                        swapchainState.d3d12RuntimeTextures[i] = tryImportTexture(sessionState, d3d11Images[i].texture);
+                    });
+                    useCopyQueue = std::all_of(
+                        swapchainState.d3d12RuntimeTextures.cbegin(),
+                        swapchainState.d3d12RuntimeTextures.cend(),
+                        [](const ComPtr<ID3D12Resource>& texture) { return texture != nullptr; });
+
+                    if (useCopyQueue) {
+                        Log("Copying on a Direct3D 12 copy queue\n");
+                        initializeCopyQueue(sessionState);
+                        CHECK_HRCMD(sessionState.d3d12Device->CreateCommandAllocator(
+                            D3D12_COMMAND_LIST_TYPE_DIRECT,
+                            IID_PPV_ARGS(swapchainState.directCommandAllocator.ReleaseAndGetAddressOf())));
+                        CHECK_HRCMD(sessionState.d3d12Device->CreateCommandAllocator(
+                            D3D12_COMMAND_LIST_TYPE_COPY,
+                            IID_PPV_ARGS(swapchainState.copyCommandAllocator.ReleaseAndGetAddressOf())));
+                    } else {
+                        Log("Textures cannot be imported, copying on Direct3D 11 instead\n");
+                        swapchainState.d3d12RuntimeTextures.clear();
+                    }
+                }
+
+                // The intermediate textures created ahead of time are only usable if they match the runtime textures.
+                const bool usePrecreatedImages = swapchainState.hasPrecreatedImages && !isShareable && !useCopyQueue &&
+                                                 cachedCapabilities->imageCount == imageCount &&
+                                                 !memcmp(&cachedCapabilities->desc, &desc, sizeof(desc));
+                if (swapchainState.hasPrecreatedImages && !usePrecreatedImages) {
+                    Log("Cached capabilities are outdated\n");
+                    swapchainState.intermediateTextures.clear();
+                    swapchainState.d3d12Textures.clear();
+                }
+
+                swapchainState.d3d12Textures.resize(imageCount);
+                swapchainState.d3d11Textures.resize(imageCount);
+                if (useCopyQueue && sessionState.heapAllocator) {
+                    swapchainState.placedAllocations.resize(imageCount);
+                }
+                if ((!isShareable && !useCopyQueue) || sessionState.crossAdapter) {
+                    swapchainState.intermediateTextures.resize(imageCount);
+                }
+                if (sessionState.crossAdapter) {
+                    swapchainState.crossAdapterTextures.resize(imageCount);
+                }
+
+                // Export each D3D11 texture to D3D12. The devices are free-threaded, so the images are created and
+                // imported in parallel.
+                forEachImage(imageCount, [&](uint32_t i) {
+                    swapchainState.d3d11Textures[i] = d3d11Images[i].texture;
+
+                    // Across adapters, the app renders to a texture on its adapter, which is transferred into an
+                    // intermediate texture on the runtime's adapter.
+                    if (sessionState.crossAdapter) {
+                        swapchainState.d3d12Textures[i] =
+                            createD3D12IntermediateTexture(sessionState, swapchainState, desc, nullptr);
+                        swapchainState.intermediateTextures[i] = createD3D11IntermediateTexture(sessionState, desc);
+                        swapchainState.crossAdapterTextures[i] =
+                            sessionState.crossAdapter->importTexture(swapchainState.intermediateTextures[i].Get());
+                        return;
                     }
 
-                    ID3D11Texture2D* d3d11Texture = d3d11Images[i].texture;
+                    // The intermediate texture for the copy queue lives only on the D3D12 device.
+                    if (useCopyQueue) {
+                        swapchainState.d3d12Textures[i] = createD3D12IntermediateTexture(
+                            sessionState,
+                            swapchainState,
+                            desc,
+                            sessionState.heapAllocator ? &swapchainState.placedAllocations[i] : nullptr);
+                        return;
+                    }
 
                     // If the runtime does not make the texture shareable, we must use an intermediate texture.
-                    ComPtr<ID3D11Texture2D> d3d11IntermediateTexture;
                     if (!isShareable) {
-                        D3D11_TEXTURE2D_DESC shareableDesc = desc;
-                        shareableDesc.MiscFlags |= D3D11_RESOURCE_MISC_SHARED;
-                        CHECK_HRCMD(sessionState.d3d11Device->CreateTexture2D(
-                            &shareableDesc, nullptr, d3d11IntermediateTexture.ReleaseAndGetAddressOf()));
+                        // Use the shareable texture for the application.
+                        if (!usePrecreatedImages) {
+                            swapchainState.intermediateTextures[i] =
+                                createD3D11IntermediateTexture(sessionState, intermediateDesc);
+                            swapchainState.d3d12Textures[i] = importTexture(
+                                sessionState, swapchainState.intermediateTextures[i].Get(), isNtHandle);
+                        }
+                    } else {
+                        swapchainState.d3d12Textures[i] =
+                            importTexture(sessionState, d3d11Images[i].texture, isNtHandle);
+                    }
 
-                        // Save the original texture (from the runtime)...
-                        swapchainState.d3d11Textures.push_back(d3d11Texture);
+                    // TODO: Do we need explicit barriers upon xrAcquireSwapchainImage()/xrReleaseSwapchainImage()?
+                });
 
-                        // ...and use the shareable texture for the application.
-                        d3d11Texture = d3d11IntermediateTexture.Get();
-                        swapchainState.intermediateTextures.push_back(d3d11Texture);
+                // The rest is not thread-safe (the command allocators and the memory accounting). The swapchain's
+                // images are accounted for exactly once, whatever was tracked for it before.
+                sessionState.memory->release((uint64_t)swapchain);
+                XrSwapchainImageD3D12KHR* d3d12Images = reinterpret_cast<XrSwapchainImageD3D12KHR*>(images);
+                for (uint32_t i = 0; i < imageCount; i++) {
+                    ID3D12Resource* const d3d12Texture = swapchainState.d3d12Textures[i].Get();
+                    d3d12Images[i].texture = d3d12Texture;
+
+                    if (sessionState.crossAdapter) {
+                        sessionState.memory->trackAllocation((uint64_t)swapchain, d3d12Texture);
+                    } else if (useCopyQueue) {
+                        if (swapchainState.placedAllocations.empty() || !swapchainState.placedAllocations[i].heap) {
+                            sessionState.memory->trackAllocation((uint64_t)swapchain, d3d12Texture);
+                        }
+                        sessionState.memory->trackImport((uint64_t)swapchain,
+                                                         swapchainState.d3d12RuntimeTextures[i].Get());
+                        prepareCopyCommands(sessionState, swapchainState, i);
+                    } else if (!isShareable) {
+                        sessionState.memory->trackAllocation(
+                            (uint64_t)swapchain, swapchainState.intermediateTextures[i].Get(), d3d12Texture);
+                    } else {
+                        sessionState.memory->trackImport((uint64_t)swapchain, d3d12Texture);
                     }
+                }
 
-                    // Create an imported texture on the D3D12 device.
-                    wil::unique_handle textureHandle;
-                    ComPtr<IDXGIResource1> dxgiResource;
-                    CHECK_HRCMD(d3d11Texture->QueryInterface(IID_PPV_ARGS(dxgiResource.ReleaseAndGetAddressOf())));
-                    if (isNtHandle) {
-                        CHECK_HRCMD(
-                            dxgiResource->CreateSharedHandle(nullptr, GENERIC_ALL, nullptr, textureHandle.put()));
-                    } else {
-                        CHECK_HRCMD(dxgiResource->GetSharedHandle(textureHandle.put()));
+                if (!swapchainState.placedAllocations.empty()) {
+                    // The heaps belong to the session, not to the swapchain.
+                    for (const auto& heap : sessionState.heapAllocator->getHeaps()) {
+                        sessionState.memory->trackHeap(0, heap.Get());
                     }
-                    ComPtr<ID3D12Resource> d3d12Resource;
-                    CHECK_HRCMD(sessionState.d3d12Device->OpenSharedHandle(
-                        textureHandle.get(), IID_PPV_ARGS(d3d12Resource.ReleaseAndGetAddressOf())));
+                    initializePlacedTextures(sessionState, swapchainState);
+                }
 
-                    swapchainState.d3d12Textures.push_back(d3d12Resource);
-                    d3d12Images[i].texture = d3d12Resource.Get();
+                // Remember the capabilities for the next sessions.
+                Capabilities capabilities{desc, imageCount, false, false};
+                if (tryCopyQueue) {
+                    capabilities.importTested = true;
+                    capabilities.importable = useCopyQueue;
+                } else if (cachedCapabilities) {
+                    capabilities.importTested = cachedCapabilities->importTested;
+                    capabilities.importable = cachedCapabilities->importable;
+                }
+                m_capabilityCache->store(swapchainState.capabilitiesKey, capabilities);
+
+                const auto duration =
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+                sessionState.stats.swapchainImportTime += duration;
+                Log("Imported %u images in %.1f ms (%u workers%s)\n",
+                    imageCount,
+                    duration,
+                    m_workerPool ? m_workerPool->getSize() : 0,
+                    usePrecreatedImages ? ", created ahead of time" : "");
+
+                if (!isShareable || sessionState.crossAdapter) {
+                    const auto resourceDesc = swapchainState.d3d12Textures[0]->GetDesc();
+                    swapchainState.bytesPerCopy =
+                        sessionState.d3d12Device->GetResourceAllocationInfo(0, 1, &resourceDesc).SizeInBytes;
+                }
 
-                    // TODO: Do we need explicit barriers upon xrAcquireSwapchainImage()/xrReleaseSwapchainImage()?
+                // Plan the conversions or the copies from the intermediate textures.
+                if (isEmulated) {
+                    swapchainState.formatConverter = std::make_unique<FormatConverter>(
+                        sessionState.d3d11Device.Get(), swapchainState.createInfo, swapchainState.runtimeFormat);
+                    for (uint32_t i = 0; i < imageCount; i++) {
+                        swapchainState.formatConverter->addImage(swapchainState.d3d11Textures[i].Get(),
+                                                                 swapchainState.intermediateTextures[i].Get());
+                    }
+                } else if (!swapchainState.intermediateTextures.empty()) {
+                    swapchainState.intermediateTextures[0]->GetDesc(&intermediateDesc);
+                    swapchainState.copyEngine =
+                        std::make_unique<D3D11CopyEngine>(swapchainState.createInfo, desc, intermediateDesc);
                 }
             }
 
@@ -416,90 +1203,1356 @@ namespace {
         XrResult xrAcquireSwapchainImage(XrSwapchain swapchain,
                                          const XrSwapchainImageAcquireInfo* acquireInfo,
                                          uint32_t* index) override {
+            if (isSwapchainHandled(swapchain) && m_swapchains[swapchain].ringDepth) {
+                auto& swapchainState = m_swapchains[swapchain];
+                auto& sessionState = m_sessions[swapchainState.xrSession];
+
+                if (swapchainState.d3d12Textures.empty()) {
+                    createImageRing(sessionState, swapchainState);
+                }
+
+                // The runtime is not involved, the ring images are handed out in order.
+                *index = swapchainState.nextRingIndex;
+                swapchainState.nextRingIndex = (swapchainState.nextRingIndex + 1) % swapchainState.ringDepth;
+                swapchainState.acquiredIndex = *index;
+
+                sessionState.memory->ensureResident();
+
+                return XR_SUCCESS;
+            }
+
+            // The runtime image with a deferred copy must be released before the next one is acquired.
+            if (isSwapchainHandled(swapchain) && m_swapchains[swapchain].deferredCopyIndex) {
+                auto& swapchainState = m_swapchains[swapchain];
+                auto& sessionState = m_sessions[swapchainState.xrSession];
+
+                if (isSessionIdle(sessionState)) {
+                    // Nothing was displayed, the runtime keeps the previous content of its image.
+                    swapchainState.stats.droppedCopies++;
+                } else {
+                    const auto startTime = std::chrono::steady_clock::now();
+                    copyImage(sessionState, swapchainState, swapchainState.deferredCopyIndex.value());
+                    swapchainState.stats.deferredCopies++;
+                    sessionState.stats.cpuTime += std::chrono::steady_clock::now() - startTime;
+                }
+                swapchainState.deferredCopyIndex.reset();
+
+                XrSwapchainImageReleaseInfo releaseInfo{XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
+                CHECK_XRCMD(OpenXrApi::xrReleaseSwapchainImage(swapchain, &releaseInfo));
+            }
+
             const XrResult result = OpenXrApi::xrAcquireSwapchainImage(swapchain, acquireInfo, index);
             if (XR_SUCCEEDED(result) && isSwapchainHandled(swapchain)) {
                 auto& swapchainState = m_swapchains[swapchain];
+                auto& sessionState = m_sessions[swapchainState.xrSession];
 
                 swapchainState.acquiredIndex = *index;
+
+                // The app may render before the runtime tells us the session is visible again.
+                sessionState.memory->ensureResident();
+
+                if (!swapchainState.unwrapCommands.empty()) {
+                    // The runtime's pending work on the texture is submitted to the app's queue first.
+                    ComPtr<ID3D12Resource> resource;
+                    CHECK_HRCMD(sessionState.d3d11On12Device->UnwrapUnderlyingResource(
+                        swapchainState.d3d11Textures[*index].Get(),
+                        sessionState.d3d12Queue.Get(),
+                        IID_PPV_ARGS(resource.ReleaseAndGetAddressOf())));
+                    ID3D12CommandList* const lists[] = {swapchainState.unwrapCommands[*index].toAppState.Get()};
+                    sessionState.d3d12Queue->ExecuteCommandLists(1, lists);
+                }
+
+                if (!swapchainState.copyCommands.empty()) {
+                    auto& commands = swapchainState.copyCommands[*index];
+                    if (commands.pendingCopyFenceValue) {
+                        // Return the intermediate texture to the state expected by the app once our copy is done.
+                        CHECK_HRCMD(sessionState.d3d12Queue->Wait(sessionState.d3d12CopyFence.Get(),
+                                                                  commands.pendingCopyFenceValue));
+                        ID3D12CommandList* const lists[] = {commands.toAppState.Get()};
+                        sessionState.d3d12Queue->ExecuteCommandLists(1, lists);
+                        commands.pendingCopyFenceValue = 0;
+                    }
+                }
             }
 
             return result;
         }
 
+        XrResult xrWaitSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageWaitInfo* waitInfo) override {
+            if (isSwapchainHandled(swapchain) && m_swapchains[swapchain].ringDepth) {
+                auto& swapchainState = m_swapchains[swapchain];
+                auto& sessionState = m_sessions[swapchainState.xrSession];
+
+                // The app's rendering must not start before our last copy from the image. With a deep enough ring,
+                // the copy is long done and the wait is free.
+                const UINT64 fenceValue = swapchainState.ringFenceValues[swapchainState.acquiredIndex];
+                if (fenceValue > sessionState.d3d12RingFence->GetCompletedValue()) {
+                    CHECK_HRCMD(sessionState.d3d12Queue->Wait(sessionState.d3d12RingFence.Get(), fenceValue));
+                }
+
+                return XR_SUCCESS;
+            }
+
+            return OpenXrApi::xrWaitSwapchainImage(swapchain, waitInfo);
+        }
+
         XrResult xrReleaseSwapchainImage(XrSwapchain swapchain,
                                          const XrSwapchainImageReleaseInfo* releaseInfo) override {
-            if (isSwapchainHandled(swapchain)) {
+            if (isSwapchainHandled(swapchain) && m_swapchains[swapchain].ringDepth) {
+                auto& swapchainState = m_swapchains[swapchain];
+
+                // The copy is done upon xrEndFrame(), only for the latest image.
+                swapchainState.ringReleasedIndex = swapchainState.acquiredIndex;
+
+                return XR_SUCCESS;
+            }
+
+            if (isSwapchainHandled(swapchain) && !m_swapchains[swapchain].unwrapCommands.empty()) {
+                auto& swapchainState = m_swapchains[swapchain];
+                auto& sessionState = m_sessions[swapchainState.xrSession];
+
+                // The runtime's work is submitted to the app's queue, after the app's work on that queue.
+                for (const auto& additionalQueue : signalAdditionalQueues(sessionState)) {
+                    CHECK_HRCMD(
+                        sessionState.d3d12Queue->Wait(additionalQueue.d3d12Fence.Get(), additionalQueue.fenceValue));
+                }
+                const uint32_t index = swapchainState.acquiredIndex;
+                ID3D12CommandList* const lists[] = {swapchainState.unwrapCommands[index].toCommonState.Get()};
+                sessionState.d3d12Queue->ExecuteCommandLists(1, lists);
+                CHECK_HRCMD(sessionState.d3d11On12Device->ReturnUnderlyingResource(
+                    swapchainState.d3d11Textures[index].Get(), 0, nullptr, nullptr));
+                swapchainState.releasedIndex = index;
+            } else if (isSwapchainHandled(swapchain)) {
                 auto& swapchainState = m_swapchains[swapchain];
                 auto& sessionState = m_sessions[swapchainState.xrSession];
+                const auto startTime = std::chrono::steady_clock::now();
 
-                if (!swapchainState.intermediateTextures.empty()) {
-                    // Copy from the intermediate texture if needed. We copy all slices.
-                    for (uint32_t i = 0; i < swapchainState.createInfo.arraySize; i++) {
-                        sessionState.d3d11Context->CopySubresourceRegion(
-                            swapchainState.d3d11Textures[swapchainState.acquiredIndex].Get(),
-                            i,
-                            0,
-                            0,
-                            0,
-                            swapchainState.intermediateTextures[swapchainState.acquiredIndex].Get(),
-                            i,
-                            nullptr);
+                swapchainState.releasedIndex = swapchainState.acquiredIndex;
+
+                const bool needCopy =
+                    !swapchainState.copyCommands.empty() || !swapchainState.intermediateTextures.empty();
+                if (swapchainState.isStatic) {
+                    // There will be no other release, copy right away even if nothing is displayed. Without a copy, the
+                    // runtime must still not read the texture before the app's rendering is complete.
+                    if (needCopy) {
+                        copyImage(sessionState, swapchainState, swapchainState.acquiredIndex);
+                    } else {
+                        CHECK_HRCMD(sessionState.d3d12Queue->Signal(sessionState.d3d12ReleaseFence.Get(),
+                                                                    ++sessionState.releaseFenceValue));
+                        CHECK_HRCMD(sessionState.d3d11Context->Wait(sessionState.d3d11ReleaseFence.Get(),
+                                                                    sessionState.releaseFenceValue));
                     }
+                    swapchainState.isStaticImageCopied = true;
+                } else if (needCopy) {
+                    if (isSessionIdle(sessionState) ||
+                        getStrategy(sessionState).copyTiming == settings::CopyTiming::Deferred) {
+                        // Nothing will be displayed, or the copy is batched upon xrEndFrame(): copy only if the image
+                        // is submitted. The runtime image is released after the copy.
+                        swapchainState.deferredCopyIndex = swapchainState.acquiredIndex;
+                        sessionState.stats.cpuTime += std::chrono::steady_clock::now() - startTime;
+                        return XR_SUCCESS;
+                    }
+                    copyImage(sessionState, swapchainState, swapchainState.acquiredIndex);
                 }
+
+                sessionState.stats.cpuTime += std::chrono::steady_clock::now() - startTime;
             }
 
             return OpenXrApi::xrReleaseSwapchainImage(swapchain, releaseInfo);
         }
 
+        XrResult xrWaitFrame(XrSession session,
+                             const XrFrameWaitInfo* frameWaitInfo,
+                             XrFrameState* frameState) override {
+            const XrResult result = OpenXrApi::xrWaitFrame(session, frameWaitInfo, frameState);
+            if (XR_SUCCEEDED(result) && isSessionHandled(session)) {
+                auto& sessionState = m_sessions[session];
+
+                sessionState.shouldRender = frameState->shouldRender;
+                if (sessionState.stallWatchdog) {
+                    sessionState.stallWatchdog->waitFrame(*frameState);
+                }
+            }
+
+            return result;
+        }
+
         XrResult xrEndFrame(XrSession session, const XrFrameEndInfo* frameEndInfo) override {
+            XrFrameEndInfo chainFrameEndInfo = *frameEndInfo;
+            std::vector<const XrCompositionLayerBaseHeader*> chainLayers;
             if (isSessionHandled(session)) {
                 auto& sessionState = m_sessions[session];
+                const auto startTime = std::chrono::steady_clock::now();
+
+                releaseRetiredSwapchains(sessionState);
+                sessionState.memory->poll();
+
+                // When nothing is displayed, there is no need to synchronize. The next frame that submits layers
+                // will synchronize all the work queued until then.
+                bool isSynchronized = false;
+                std::vector<XrSwapchain> copiedSwapchains;
+                std::chrono::nanoseconds runtimeTime{0};
+                if (frameEndInfo->layerCount == 0 || isSessionIdle(sessionState)) {
+                    sessionState.stats.idleFrames++;
+                } else if (isStaticFrame(frameEndInfo)) {
+                    // The copies were synchronized when the static images were released.
+                    sessionState.stats.staticFrames++;
+                } else {
+                    if (sessionState.needsTuning) {
+                        sessionState.tuner->restart(getTuningCandidates(sessionState));
+                        sessionState.needsTuning = false;
+                    }
+
+                    copiedSwapchains = flushDeferredCopies(sessionState, frameEndInfo);
+                    runtimeTime = copyImageRings(sessionState);
+                    synchronizeFrame(sessionState);
+                    isSynchronized = true;
+                    if (sessionState.stallWatchdog) {
+                        sessionState.stallWatchdog->endFrame(sessionState.fenceValue);
+                    }
+
+                    if (sessionState.frameCapture && sessionState.stats.frames % m_settings.frameCapture == 0) {
+                        captureFrame(sessionState, frameEndInfo);
+                    }
+                }
+
+                if (sessionState.frameCapture) {
+                    sessionState.frameCapture->poll();
+                }
+
+                if (checkImageRingLayers(sessionState, frameEndInfo, isSynchronized, chainLayers)) {
+                    chainFrameEndInfo.layerCount = (uint32_t)chainLayers.size();
+                    chainFrameEndInfo.layers = chainLayers.data();
+                }
 
-                // Serializes the app work between D3D12 and D3D11.
-                CHECK_HRCMD(sessionState.d3d12Queue->Signal(sessionState.d3d12Fence.Get(), ++sessionState.fenceValue));
-                CHECK_HRCMD(sessionState.d3d11Context->Wait(sessionState.d3d11Fence.Get(), sessionState.fenceValue));
+                // The calls to the runtime are not accounted for.
+                sessionState.stats.cpuTime += std::chrono::steady_clock::now() - startTime - runtimeTime;
+                if (sessionState.tuner) {
+                    sessionState.tuner->endFrame(isSynchronized,
+                                                 sessionState.stats.cpuTime,
+                                                 sessionState.stats.gpuWaitTime + sessionState.stats.gpuCopyTime);
+                }
+
+                // The runtime images are released once their deferred copies are queued.
+                for (const XrSwapchain swapchain : copiedSwapchains) {
+                    XrSwapchainImageReleaseInfo releaseInfo{XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
+                    CHECK_XRCMD(OpenXrApi::xrReleaseSwapchainImage(swapchain, &releaseInfo));
+                }
             }
 
-            return OpenXrApi::xrEndFrame(session, frameEndInfo);
+            return OpenXrApi::xrEndFrame(session, &chainFrameEndInfo);
         }
 
       private:
-        void cleanupSession(Session& sessionState) {
-            // Wait for all the queued work to complete.
-            wil::unique_handle eventHandle;
-            sessionState.d3d12Queue->Signal(sessionState.d3d12Fence.Get(), ++sessionState.fenceValue);
-            *eventHandle.put() = CreateEventEx(nullptr, L"Flush Fence", 0, EVENT_ALL_ACCESS);
-            CHECK_HRCMD(sessionState.d3d12Fence->SetEventOnCompletion(sessionState.fenceValue, eventHandle.get()));
-            WaitForSingleObject(eventHandle.get(), INFINITE);
-            ResetEvent(eventHandle.get());
-            sessionState.d3d11Context->Flush1(D3D11_CONTEXT_TYPE_ALL, eventHandle.get());
-            WaitForSingleObject(eventHandle.get(), INFINITE);
-
-            for (auto it = m_swapchains.begin(); it != m_swapchains.end();) {
-                auto& swapchainState = it->second;
-                if (swapchainState.xrSession == sessionState.xrSession) {
-                    it = m_swapchains.erase(it);
-                } else {
-                    it++;
+        // Run the function for each image, on the worker pool if enabled.
+        void forEachImage(uint32_t imageCount, const std::function<void(uint32_t)>& function) {
+            if (m_workerPool && imageCount > 1) {
+                m_workerPool->parallelFor(imageCount, [&](size_t i) { function((uint32_t)i); });
+            } else {
+                for (uint32_t i = 0; i < imageCount; i++) {
+                    function(i);
                 }
             }
         }
 
-        bool isSystemHandled(XrSystemId systemId) const {
-            return systemId == m_systemId;
-        }
+        // Create a shareable copy of a runtime texture.
+        ComPtr<ID3D11Texture2D> createD3D11IntermediateTexture(Session& sessionState,
+                                                               const D3D11_TEXTURE2D_DESC& desc) {
+            D3D11_TEXTURE2D_DESC shareableDesc = desc;
+            shareableDesc.MiscFlags |= D3D11_RESOURCE_MISC_SHARED;
 
-        bool isSessionHandled(XrSession session) const {
-            return m_sessions.find(session) != m_sessions.cend();
-        }
+            ComPtr<ID3D11Texture2D> texture;
+            CHECK_HRCMD(
+                sessionState.d3d11Device->CreateTexture2D(&shareableDesc, nullptr, texture.ReleaseAndGetAddressOf()));
 
-        bool isSwapchainHandled(XrSwapchain swapchain) const {
-            return m_swapchains.find(swapchain) != m_swapchains.cend();
+            return texture;
         }
 
-        // TODO: This should be auto-generated in the dispatch layer.
-        static XrResult wrapper_xrGetD3D12GraphicsRequirementsKHR(
-            XrInstance instance, XrSystemId systemId, XrGraphicsRequirementsD3D12KHR* graphicsRequirements) {
+        // Create an imported texture on the D3D12 device.
+        ComPtr<ID3D12Resource> importTexture(Session& sessionState, ID3D11Texture2D* texture, bool isNtHandle) {
+            wil::unique_handle textureHandle;
+            ComPtr<IDXGIResource1> dxgiResource;
+            CHECK_HRCMD(texture->QueryInterface(IID_PPV_ARGS(dxgiResource.ReleaseAndGetAddressOf())));
+            if (isNtHandle) {
+                CHECK_HRCMD(dxgiResource->CreateSharedHandle(nullptr, GENERIC_ALL, nullptr, textureHandle.put()));
+            } else {
+                CHECK_HRCMD(dxgiResource->GetSharedHandle(textureHandle.put()));
+            }
+
+            ComPtr<ID3D12Resource> d3d12Resource;
+            CHECK_HRCMD(sessionState.d3d12Device->OpenSharedHandle(
+                textureHandle.get(), IID_PPV_ARGS(d3d12Resource.ReleaseAndGetAddressOf())));
+
+            return d3d12Resource;
+        }
+
+        // When a previous session found that the runtime textures are not shareable, create the intermediate textures
+        // upon xrCreateSwapchain(), before the runtime creates its textures.
+        void precreateImages(Session& sessionState, Swapchain& swapchainState) {
+            const auto& cachedCapabilities = swapchainState.cachedCapabilities;
+            if (!cachedCapabilities || (cachedCapabilities->desc.MiscFlags & D3D11_RESOURCE_MISC_SHARED) ||
+                sessionState.crossAdapter || sessionState.d3d11On12Device) {
+                return;
+            }
+            if (m_settings.copyStrategy == settings::CopyStrategy::D3D12CopyQueue &&
+                (!cachedCapabilities->importTested || cachedCapabilities->importable)) {
+                return;
+            }
+
+            const uint32_t imageCount = cachedCapabilities->imageCount;
+            const bool isNtHandle = cachedCapabilities->desc.MiscFlags & D3D11_RESOURCE_MISC_SHARED_NTHANDLE;
+            swapchainState.intermediateTextures.resize(imageCount);
+            swapchainState.d3d12Textures.resize(imageCount);
+            forEachImage(imageCount, [&](uint32_t i) {
+                swapchainState.intermediateTextures[i] =
+                    createD3D11IntermediateTexture(sessionState, cachedCapabilities->desc);
+                swapchainState.d3d12Textures[i] =
+                    importTexture(sessionState, swapchainState.intermediateTextures[i].Get(), isNtHandle);
+            });
+            swapchainState.hasPrecreatedImages = true;
+        }
+
+        // The strategies picked by the tuner, or those from the settings.
+        Strategy getStrategy(const Session& sessionState) const {
+            return sessionState.tuner ? sessionState.tuner->getStrategy()
+                                      : Strategy{m_settings.syncMode, m_settings.copyTiming};
+        }
+
+        // The strategies worth evaluating for the session. The sync modes that rely on the app synchronizing
+        // externally are never tried, and the copy timing only matters for the swapchains copied upon release.
+        std::vector<Strategy> getTuningCandidates(const Session& sessionState) const {
+            const auto autoTune = m_settings.autoTune;
+
+            std::vector<settings::SyncMode> syncModes{m_settings.syncMode};
+            if ((autoTune == settings::AutoTune::Sync || autoTune == settings::AutoTune::All) &&
+                !sessionState.d3d11On12Device &&
+                (m_settings.syncMode == settings::SyncMode::GpuWait ||
+                 m_settings.syncMode == settings::SyncMode::CpuWait)) {
+                syncModes = {settings::SyncMode::GpuWait, settings::SyncMode::CpuWait};
+            }
+
+            std::vector<settings::CopyTiming> copyTimings{m_settings.copyTiming};
+            const bool hasCopies =
+                std::any_of(m_swapchains.cbegin(), m_swapchains.cend(), [&](const auto& entry) {
+                    const Swapchain& swapchainState = entry.second;
+                    return swapchainState.xrSession == sessionState.xrSession && !swapchainState.isStatic &&
+                           !swapchainState.ringDepth &&
+                           (!swapchainState.intermediateTextures.empty() || !swapchainState.copyCommands.empty());
+                });
+            if ((autoTune == settings::AutoTune::Copy || autoTune == settings::AutoTune::All) && hasCopies) {
+                copyTimings = {settings::CopyTiming::Eager, settings::CopyTiming::Deferred};
+            }
+
+            std::vector<Strategy> candidates;
+            for (const auto syncMode : syncModes) {
+                for (const auto copyTiming : copyTimings) {
+                    candidates.push_back({syncMode, copyTiming});
+                }
+            }
+
+            return candidates;
+        }
+
+        // The formats are emulated with an intermediate texture on the runtime's Direct3D 11 device, which the app
+        // cannot render to with the D3D11On12 backend or across adapters.
+        bool canEmulateFormats(const Session& sessionState) const {
+            return m_settings.formatEmulation && !sessionState.crossAdapter && !sessionState.d3d11On12Device;
+        }
+
+        // The runtime's formats are queried once per session.
+        const std::vector<int64_t>& getRuntimeFormats(Session& sessionState) {
+            if (sessionState.runtimeFormats.empty()) {
+                uint32_t formatCount = 0;
+                CHECK_XRCMD(OpenXrApi::xrEnumerateSwapchainFormats(sessionState.xrSession, 0, &formatCount, nullptr));
+                sessionState.runtimeFormats.resize(formatCount);
+                CHECK_XRCMD(OpenXrApi::xrEnumerateSwapchainFormats(
+                    sessionState.xrSession, formatCount, &formatCount, sessionState.runtimeFormats.data()));
+            }
+
+            return sessionState.runtimeFormats;
+        }
+
+        // With the D3D11On12 backend, retrieve the resources underlying the runtime textures. They are handed to the
+        // app as is, without any sharing.
+        void unwrapImages(Session& sessionState,
+                          Swapchain& swapchainState,
+                          const std::vector<XrSwapchainImageD3D11KHR>& d3d11Images,
+                          uint32_t imageCount,
+                          XrSwapchainImageBaseHeader* images) {
+            CHECK_HRCMD(sessionState.d3d12Device->CreateCommandAllocator(
+                D3D12_COMMAND_LIST_TYPE_DIRECT,
+                IID_PPV_ARGS(swapchainState.directCommandAllocator.ReleaseAndGetAddressOf())));
+
+            XrSwapchainImageD3D12KHR* d3d12Images = reinterpret_cast<XrSwapchainImageD3D12KHR*>(images);
+            swapchainState.d3d11Textures.resize(imageCount);
+            swapchainState.d3d12Textures.resize(imageCount);
+            for (uint32_t i = 0; i < imageCount; i++) {
+                swapchainState.d3d11Textures[i] = d3d11Images[i].texture;
+                CHECK_HRCMD(sessionState.d3d11On12Device->UnwrapUnderlyingResource(
+                    d3d11Images[i].texture,
+                    sessionState.d3d12Queue.Get(),
+                    IID_PPV_ARGS(swapchainState.d3d12Textures[i].ReleaseAndGetAddressOf())));
+                CHECK_HRCMD(sessionState.d3d11On12Device->ReturnUnderlyingResource(
+                    d3d11Images[i].texture, 0, nullptr, nullptr));
+
+                Swapchain::CopyCommands commands;
+                recordTransitions(sessionState, swapchainState, swapchainState.d3d12Textures[i].Get(), commands);
+                swapchainState.unwrapCommands.push_back(std::move(commands));
+
+                sessionState.memory->trackImport((uint64_t)swapchainState.xrSwapchain,
+                                                 swapchainState.d3d12Textures[i].Get());
+                d3d12Images[i].texture = swapchainState.d3d12Textures[i].Get();
+            }
+
+            Log("Unwrapped %u images\n", imageCount);
+        }
+
+        // Whether the frame being rendered will not be displayed.
+        static bool isSessionIdle(const Session& sessionState) {
+            const bool isVisible = sessionState.state == XR_SESSION_STATE_UNKNOWN ||
+                                   sessionState.state == XR_SESSION_STATE_VISIBLE ||
+                                   sessionState.state == XR_SESSION_STATE_FOCUSED;
+            return !sessionState.shouldRender || !isVisible;
+        }
+
+        // Whether the frame only submits static images that were already copied. Projection layers are rendered every
+        // frame and always need synchronization.
+        bool isStaticFrame(const XrFrameEndInfo* frameEndInfo) const {
+            // A swapchain we do not know about (not handled by the layer, or invalid) cannot skip the synchronization.
+            const auto isStaticImage = [&](XrSwapchain swapchain) {
+                const auto it = m_swapchains.find(swapchain);
+                return it != m_swapchains.cend() && it->second.isStaticImageCopied;
+            };
+
+            for (uint32_t i = 0; i < frameEndInfo->layerCount; i++) {
+                const XrCompositionLayerBaseHeader* layer = frameEndInfo->layers[i];
+                XrSwapchain swapchain;
+                switch (layer->type) {
+                case XR_TYPE_COMPOSITION_LAYER_QUAD:
+                    swapchain = reinterpret_cast<const XrCompositionLayerQuad*>(layer)->subImage.swapchain;
+                    break;
+                case XR_TYPE_COMPOSITION_LAYER_CYLINDER_KHR:
+                    swapchain = reinterpret_cast<const XrCompositionLayerCylinderKHR*>(layer)->subImage.swapchain;
+                    break;
+                case XR_TYPE_COMPOSITION_LAYER_EQUIRECT2_KHR:
+                    swapchain = reinterpret_cast<const XrCompositionLayerEquirect2KHR*>(layer)->subImage.swapchain;
+                    break;
+                case XR_TYPE_COMPOSITION_LAYER_CUBE_KHR:
+                    swapchain = reinterpret_cast<const XrCompositionLayerCubeKHR*>(layer)->swapchain;
+                    break;
+                default:
+                    return false;
+                }
+                if (!isStaticImage(swapchain)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // Copy an image released by the app into the runtime's texture (with the same index, unless using the image
+        // ring).
+        void copyImage(Session& sessionState,
+                       Swapchain& swapchainState,
+                       uint32_t index,
+                       std::optional<uint32_t> runtimeIndex = {}) {
+            if (!swapchainState.copyCommands.empty()) {
+                copyOnCopyQueue(sessionState, swapchainState, index);
+                return;
+            }
+
+            const uint64_t timerKey = (uint64_t)swapchainState.xrSwapchain;
+            if (sessionState.gpuTimers) {
+                sessionState.gpuTimers->begin(timerKey);
+            }
+
+            if (sessionState.crossAdapter) {
+                // The transfer is queued after the app's rendering, on the app's queue.
+                for (const auto& additionalQueue : signalAdditionalQueues(sessionState)) {
+                    CHECK_HRCMD(
+                        sessionState.d3d12Queue->Wait(additionalQueue.d3d12Fence.Get(), additionalQueue.fenceValue));
+                }
+                sessionState.crossAdapter->transfer(swapchainState.d3d12Textures[index].Get(),
+                                                    getAppResourceState(swapchainState.createInfo),
+                                                    swapchainState.crossAdapterTextures[index].Get());
+            } else {
+                // The app's rendering to the intermediate texture must be complete before we copy it.
+                CHECK_HRCMD(sessionState.d3d12Queue->Signal(sessionState.d3d12ReleaseFence.Get(),
+                                                            ++sessionState.releaseFenceValue));
+                CHECK_HRCMD(sessionState.d3d11Context->Wait(sessionState.d3d11ReleaseFence.Get(),
+                                                            sessionState.releaseFenceValue));
+                for (const auto& additionalQueue : signalAdditionalQueues(sessionState)) {
+                    CHECK_HRCMD(
+                        sessionState.d3d11Context->Wait(additionalQueue.d3d11Fence.Get(), additionalQueue.fenceValue));
+                }
+            }
+
+            // Copy (or convert) from the intermediate texture.
+            if (swapchainState.formatConverter) {
+                swapchainState.formatConverter->convert(sessionState.d3d11Context.Get(), index);
+            } else {
+                swapchainState.copyEngine->copy(sessionState.d3d11Context.Get(),
+                                                swapchainState.d3d11Textures[runtimeIndex.value_or(index)].Get(),
+                                                swapchainState.intermediateTextures[index].Get());
+            }
+            swapchainState.stats.copies++;
+            sessionState.stats.copies++;
+            sessionState.stats.bytesCopied += swapchainState.bytesPerCopy;
+
+            if (sessionState.gpuTimers) {
+                sessionState.gpuTimers->end(timerKey);
+            }
+        }
+
+        // Perform the deferred copies (skipped while the session was idle, or batched upon xrEndFrame()) for the
+        // swapchains submitted with the frame. Returns the swapchains whose runtime image must now be released to the
+        // runtime. The copies for the other swapchains are made when the app acquires their next image.
+        std::vector<XrSwapchain> flushDeferredCopies(Session& sessionState, const XrFrameEndInfo* frameEndInfo) {
+            std::vector<XrSwapchain> copiedSwapchains;
+            for (const XrSwapchain xrSwapchain : getSubmittedSwapchains(frameEndInfo)) {
+                const auto it = m_swapchains.find(xrSwapchain);
+                if (it == m_swapchains.end() || !it->second.deferredCopyIndex) {
+                    continue;
+                }
+
+                auto& swapchainState = it->second;
+                copyImage(sessionState, swapchainState, swapchainState.deferredCopyIndex.value());
+                swapchainState.deferredCopyIndex.reset();
+                swapchainState.stats.deferredCopies++;
+                copiedSwapchains.push_back(xrSwapchain);
+            }
+            return copiedSwapchains;
+        }
+
+        // The swapchains referenced by the layers of the frame (each only once).
+        static std::vector<XrSwapchain> getSubmittedSwapchains(const XrFrameEndInfo* frameEndInfo) {
+            std::vector<XrSwapchain> swapchains;
+            for (uint32_t i = 0; i < frameEndInfo->layerCount; i++) {
+                for (const XrSwapchain swapchain : getLayerSwapchains(frameEndInfo->layers[i])) {
+                    if (std::find(swapchains.cbegin(), swapchains.cend(), swapchain) == swapchains.cend()) {
+                        swapchains.push_back(swapchain);
+                    }
+                }
+            }
+            return swapchains;
+        }
+
+        // The swapchains referenced by a layer, including the depth swapchains chained to the projection views.
+        static std::vector<XrSwapchain> getLayerSwapchains(const XrCompositionLayerBaseHeader* layer) {
+            std::vector<XrSwapchain> swapchains;
+            switch (layer->type) {
+            case XR_TYPE_COMPOSITION_LAYER_PROJECTION: {
+                const auto projection = reinterpret_cast<const XrCompositionLayerProjection*>(layer);
+                for (uint32_t view = 0; view < projection->viewCount; view++) {
+                    swapchains.push_back(projection->views[view].subImage.swapchain);
+                    auto entry = reinterpret_cast<const XrBaseInStructure*>(projection->views[view].next);
+                    while (entry) {
+                        if (entry->type == XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR) {
+                            swapchains.push_back(
+                                reinterpret_cast<const XrCompositionLayerDepthInfoKHR*>(entry)->subImage.swapchain);
+                        }
+                        entry = entry->next;
+                    }
+                }
+                break;
+            }
+            case XR_TYPE_COMPOSITION_LAYER_QUAD:
+                swapchains.push_back(reinterpret_cast<const XrCompositionLayerQuad*>(layer)->subImage.swapchain);
+                break;
+            case XR_TYPE_COMPOSITION_LAYER_CYLINDER_KHR:
+                swapchains.push_back(reinterpret_cast<const XrCompositionLayerCylinderKHR*>(layer)->subImage.swapchain);
+                break;
+            case XR_TYPE_COMPOSITION_LAYER_EQUIRECT2_KHR:
+                swapchains.push_back(
+                    reinterpret_cast<const XrCompositionLayerEquirect2KHR*>(layer)->subImage.swapchain);
+                break;
+            case XR_TYPE_COMPOSITION_LAYER_CUBE_KHR:
+                swapchains.push_back(reinterpret_cast<const XrCompositionLayerCubeKHR*>(layer)->swapchain);
+                break;
+            default:
+                break;
+            }
+            return swapchains;
+        }
+
+        // Check the layers referencing the swapchains using the image ring, whose copy into a runtime image may have
+        // timed out. The layers referencing a swapchain that the runtime never had an image released for are removed
+        // (the runtime would reject the frame), into the layers to submit instead. Returns whether layers were
+        // removed.
+        bool checkImageRingLayers(Session& sessionState,
+                                  const XrFrameEndInfo* frameEndInfo,
+                                  bool isSynchronized,
+                                  std::vector<const XrCompositionLayerBaseHeader*>& layers) {
+            bool removed = false;
+            std::vector<XrSwapchain> staleSwapchains;
+            for (uint32_t i = 0; i < frameEndInfo->layerCount; i++) {
+                bool keep = true;
+                for (const XrSwapchain swapchain : getLayerSwapchains(frameEndInfo->layers[i])) {
+                    const auto it = m_swapchains.find(swapchain);
+                    if (it == m_swapchains.end() || !it->second.ringDepth) {
+                        continue;
+                    }
+
+                    const auto& swapchainState = it->second;
+                    if (!swapchainState.releasedIndex) {
+                        keep = false;
+                    } else if (isSynchronized && swapchainState.ringReleasedIndex &&
+                               std::find(staleSwapchains.cbegin(), staleSwapchains.cend(), swapchain) ==
+                                   staleSwapchains.cend()) {
+                        // The copy of the latest image timed out.
+                        staleSwapchains.push_back(swapchain);
+                        sessionState.stats.staleRingSubmissions++;
+                    }
+                }
+
+                if (keep) {
+                    layers.push_back(frameEndInfo->layers[i]);
+                } else {
+                    sessionState.stats.removedRingLayers++;
+                    removed = true;
+                }
+            }
+
+            if (removed) {
+                DebugLog("Removed %zu layers without a runtime image\n", frameEndInfo->layerCount - layers.size());
+            }
+            return removed;
+        }
+
+        // Create the ring images exposed to the app, and get the runtime images they are copied to.
+        void createImageRing(Session& sessionState, Swapchain& swapchainState) {
+            const XrSwapchain swapchain = swapchainState.xrSwapchain;
+            const auto startTime = std::chrono::steady_clock::now();
+
+            uint32_t imageCount = 0;
+            CHECK_XRCMD(OpenXrApi::xrEnumerateSwapchainImages(swapchain, 0, &imageCount, nullptr));
+            std::vector<XrSwapchainImageD3D11KHR> d3d11Images(imageCount, {XR_TYPE_SWAPCHAIN_IMAGE_D3D11_KHR});
+            CHECK_XRCMD(OpenXrApi::xrEnumerateSwapchainImages(
+                swapchain,
+                imageCount,
+                &imageCount,
+                reinterpret_cast<XrSwapchainImageBaseHeader*>(d3d11Images.data())));
+            for (const auto& image : d3d11Images) {
+                swapchainState.d3d11Textures.push_back(image.texture);
+            }
+
+            D3D11_TEXTURE2D_DESC desc;
+            d3d11Images[0].texture->GetDesc(&desc);
+
+            if (!sessionState.d3d12RingFence) {
+                CHECK_HRCMD(sessionState.d3d11Device->CreateFence(
+                    0, D3D11_FENCE_FLAG_SHARED, IID_PPV_ARGS(sessionState.d3d11RingFence.ReleaseAndGetAddressOf())));
+                wil::unique_handle fenceHandle;
+                CHECK_HRCMD(
+                    sessionState.d3d11RingFence->CreateSharedHandle(nullptr, GENERIC_ALL, nullptr, fenceHandle.put()));
+                CHECK_HRCMD(sessionState.d3d12Device->OpenSharedHandle(
+                    fenceHandle.get(), IID_PPV_ARGS(sessionState.d3d12RingFence.ReleaseAndGetAddressOf())));
+            }
+
+            // The ring images are always copied, whether the runtime textures are shareable or not. They are shared
+            // like the runtime textures, but never with a keyed mutex, which the app would not acquire.
+            D3D11_TEXTURE2D_DESC ringDesc = desc;
+            ringDesc.MiscFlags &= ~D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX;
+            const bool isNtHandle = ringDesc.MiscFlags & D3D11_RESOURCE_MISC_SHARED_NTHANDLE;
+            const uint32_t ringDepth = swapchainState.ringDepth;
+            swapchainState.intermediateTextures.resize(ringDepth);
+            swapchainState.d3d12Textures.resize(ringDepth);
+            swapchainState.ringFenceValues.resize(ringDepth, 0);
+            forEachImage(ringDepth, [&](uint32_t i) {
+                swapchainState.intermediateTextures[i] = createD3D11IntermediateTexture(sessionState, ringDesc);
+                swapchainState.d3d12Textures[i] =
+                    importTexture(sessionState, swapchainState.intermediateTextures[i].Get(), isNtHandle);
+            });
+            for (uint32_t i = 0; i < ringDepth; i++) {
+                sessionState.memory->trackAllocation((uint64_t)swapchain,
+                                                     swapchainState.intermediateTextures[i].Get(),
+                                                     swapchainState.d3d12Textures[i].Get());
+            }
+
+            const auto resourceDesc = swapchainState.d3d12Textures[0]->GetDesc();
+            swapchainState.bytesPerCopy =
+                sessionState.d3d12Device->GetResourceAllocationInfo(0, 1, &resourceDesc).SizeInBytes;
+
+            D3D11_TEXTURE2D_DESC intermediateDesc;
+            swapchainState.intermediateTextures[0]->GetDesc(&intermediateDesc);
+            swapchainState.copyEngine =
+                std::make_unique<D3D11CopyEngine>(swapchainState.createInfo, desc, intermediateDesc);
+
+            const auto duration =
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+            sessionState.stats.swapchainImportTime += duration;
+            Log("Created a ring of %u images for %u runtime images in %.1f ms\n", ringDepth, imageCount, duration);
+        }
+
+        // Copy the latest image released by the app into a runtime image, for each swapchain using the image ring.
+        // Returns the time spent in the calls to the runtime.
+        std::chrono::nanoseconds copyImageRings(Session& sessionState) {
+            std::chrono::nanoseconds runtimeTime{0};
+            bool copied = false;
+            for (auto& [xrSwapchain, swapchainState] : m_swapchains) {
+                if (swapchainState.xrSession != sessionState.xrSession || !swapchainState.ringReleasedIndex) {
+                    continue;
+                }
+
+                // The app's thread must not block on a runtime that holds its images: after the sync timeout, the
+                // copy is attempted again upon the next frame (the runtime keeps displaying the previous image).
+                const auto runtimeStartTime = std::chrono::steady_clock::now();
+                if (!swapchainState.ringRuntimeIndex) {
+                    uint32_t acquiredIndex;
+                    XrSwapchainImageAcquireInfo acquireInfo{XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
+                    CHECK_XRCMD(OpenXrApi::xrAcquireSwapchainImage(xrSwapchain, &acquireInfo, &acquiredIndex));
+                    swapchainState.ringRuntimeIndex = acquiredIndex;
+                }
+                XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+                waitInfo.timeout = (XrDuration)m_settings.syncTimeout * 1'000'000;
+                const XrResult waitResult = OpenXrApi::xrWaitSwapchainImage(xrSwapchain, &waitInfo);
+                runtimeTime += std::chrono::steady_clock::now() - runtimeStartTime;
+                CHECK_XRCMD(waitResult);
+                if (waitResult == XR_TIMEOUT_EXPIRED) {
+                    DebugLog("Timed out waiting for a runtime image, copying upon the next frame\n");
+                    continue;
+                }
+                const uint32_t runtimeIndex = swapchainState.ringRuntimeIndex.value();
+                swapchainState.ringRuntimeIndex.reset();
+
+                const uint32_t index = swapchainState.ringReleasedIndex.value();
+                copyImage(sessionState, swapchainState, index, runtimeIndex);
+                CHECK_HRCMD(sessionState.d3d11Context->Signal(sessionState.d3d11RingFence.Get(),
+                                                              ++sessionState.ringFenceValue));
+                swapchainState.ringFenceValues[index] = sessionState.ringFenceValue;
+                swapchainState.ringReleasedIndex.reset();
+                swapchainState.releasedIndex = runtimeIndex;
+
+                const auto releaseStartTime = std::chrono::steady_clock::now();
+                XrSwapchainImageReleaseInfo releaseInfo{XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
+                CHECK_XRCMD(OpenXrApi::xrReleaseSwapchainImage(xrSwapchain, &releaseInfo));
+                runtimeTime += std::chrono::steady_clock::now() - releaseStartTime;
+                copied = true;
+            }
+
+            // The app's queue may wait for the ring fence before the runtime submits its work.
+            if (copied) {
+                sessionState.d3d11Context->Flush();
+            }
+
+            return runtimeTime;
+        }
+
+        // Serializes the app work between D3D12 and D3D11 according to the selected sync mode.
+        void synchronizeFrame(Session& sessionState) {
+            const auto now = std::chrono::steady_clock::now();
+            if (!sessionState.stats.frames) {
+                sessionState.stats.firstFrameTime = now;
+            }
+            sessionState.stats.lastFrameTime = now;
+            sessionState.stats.frames++;
+
+            const UINT64 fenceValue = ++sessionState.fenceValue;
+            CHECK_HRCMD(sessionState.d3d12Queue->Signal(sessionState.d3d12Fence.Get(), fenceValue));
+            sessionState.stats.framesInFlight += fenceValue - sessionState.d3d12Fence->GetCompletedValue();
+
+            // Bound the number of frames the app can queue ahead of the GPU.
+            const UINT64 framesInFlight = m_settings.framesInFlight;
+            if (framesInFlight && fenceValue > framesInFlight) {
+                waitForFenceOnCpu(sessionState, fenceValue - framesInFlight);
+            }
+
+            // With D3D11On12, the runtime's work is queued after the app's work on the same queue.
+            if (sessionState.d3d11On12Device) {
+                return;
+            }
+
+            // The runtime must not read its textures before our copies are complete.
+            if (sessionState.copyQueue) {
+                CHECK_HRCMD(
+                    sessionState.d3d11Context->Wait(sessionState.d3d11CopyFence.Get(), sessionState.copyFenceValue));
+            }
+
+            if (sessionState.gpuTimers) {
+                sessionState.gpuTimers->begin(0);
+            }
+
+            // The additional queues are always waited on the GPU, unless the app synchronizes externally.
+            const settings::SyncMode syncMode = getStrategy(sessionState).syncMode;
+            if (syncMode == settings::SyncMode::GpuWait || syncMode == settings::SyncMode::CpuWait) {
+                for (const auto& additionalQueue : signalAdditionalQueues(sessionState)) {
+                    CHECK_HRCMD(
+                        sessionState.d3d11Context->Wait(additionalQueue.d3d11Fence.Get(), additionalQueue.fenceValue));
+                }
+            }
+
+            switch (syncMode) {
+            case settings::SyncMode::GpuWait:
+                CHECK_HRCMD(sessionState.d3d11Context->Wait(sessionState.d3d11Fence.Get(), fenceValue));
+                break;
+
+            case settings::SyncMode::CpuWait:
+                if (!waitForFenceOnCpu(sessionState, fenceValue)) {
+                    // Do not let the runtime read incomplete images.
+                    CHECK_HRCMD(sessionState.d3d11Context->Wait(sessionState.d3d11Fence.Get(), fenceValue));
+                }
+                break;
+
+            case settings::SyncMode::Deferred: {
+                const UINT64 lag = (std::max)(m_settings.framesInFlight, 1u) - 1;
+                if (fenceValue > lag) {
+                    CHECK_HRCMD(sessionState.d3d11Context->Wait(sessionState.d3d11Fence.Get(), fenceValue - lag));
+                }
+                break;
+            }
+
+            case settings::SyncMode::None:
+                break;
+            }
+
+            if (sessionState.gpuTimers) {
+                sessionState.gpuTimers->end(0);
+                sessionState.gpuTimers->endFrame();
+
+                // Accumulate the results from the previous frames.
+                sessionState.gpuTimers->poll([&](uint64_t key, double duration) {
+                    if (!key) {
+                        sessionState.stats.gpuWaitTime += duration;
+                        sessionState.stats.gpuWaitSamples++;
+                    } else {
+                        const auto it = m_swapchains.find((XrSwapchain)key);
+                        if (it != m_swapchains.end()) {
+                            it->second.stats.gpuCopyTime += duration;
+                            it->second.stats.gpuCopySamples++;
+                        }
+                        sessionState.stats.gpuCopyTime += duration;
+                    }
+                });
+            }
+        }
+
+        // Queue the readback of the images submitted with the projection and quad layers. The copies are queued after
+        // the synchronization, like the runtime's reads.
+        void captureFrame(Session& sessionState, const XrFrameEndInfo* frameEndInfo) {
+            const auto captureImage = [&](const XrSwapchainSubImage& subImage, uint32_t layer, uint32_t view) {
+                const auto it = m_swapchains.find(subImage.swapchain);
+                if (it == m_swapchains.end() || !it->second.releasedIndex) {
+                    return;
+                }
+
+                const auto& swapchainState = it->second;
+                sessionState.frameCapture->capture(
+                    sessionState.stats.frames,
+                    swapchainState.d3d11Textures[swapchainState.releasedIndex.value()].Get(),
+                    subImage.imageArrayIndex,
+                    fmt::format("{},{},{},{},{}",
+                                (uint64_t)subImage.swapchain,
+                                layer,
+                                view,
+                                subImage.imageArrayIndex,
+                                frameEndInfo->displayTime));
+            };
+
+            for (uint32_t i = 0; i < frameEndInfo->layerCount; i++) {
+                const XrCompositionLayerBaseHeader* layer = frameEndInfo->layers[i];
+                if (layer->type == XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
+                    const auto projection = reinterpret_cast<const XrCompositionLayerProjection*>(layer);
+                    for (uint32_t view = 0; view < projection->viewCount; view++) {
+                        captureImage(projection->views[view].subImage, i, view);
+                    }
+                } else if (layer->type == XR_TYPE_COMPOSITION_LAYER_QUAD) {
+                    captureImage(reinterpret_cast<const XrCompositionLayerQuad*>(layer)->subImage, i, 0);
+                }
+            }
+        }
+
+        // Signal the fence of each additional app queue. The caller must then wait for the new fence values.
+        const std::vector<Session::AdditionalQueue>& signalAdditionalQueues(Session& sessionState) {
+            for (auto& additionalQueue : sessionState.additionalQueues) {
+                CHECK_HRCMD(
+                    additionalQueue.queue->Signal(additionalQueue.d3d12Fence.Get(), ++additionalQueue.fenceValue));
+            }
+            return sessionState.additionalQueues;
+        }
+
+        // Wait on the CPU for the D3D12 fence to reach the value, with the sync timeout. Returns false on timeout.
+        bool waitForFenceOnCpu(Session& sessionState, UINT64 value) {
+            if (sessionState.d3d12Fence->GetCompletedValue() >= value) {
+                return true;
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            const auto deadline = start + std::chrono::milliseconds(m_settings.syncTimeout);
+            CHECK_HRCMD(sessionState.d3d12Fence->SetEventOnCompletion(value, sessionState.fenceEvent.get()));
+
+            // The event might have been signaled by a previous wait that timed out, therefore we must re-check the
+            // fence value.
+            bool completed;
+            while (!(completed = sessionState.d3d12Fence->GetCompletedValue() >= value)) {
+                const auto now = std::chrono::steady_clock::now();
+                if (now >= deadline ||
+                    WaitForSingleObject(
+                        sessionState.fenceEvent.get(),
+                        (DWORD)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1) ==
+                        WAIT_TIMEOUT) {
+                    completed = sessionState.d3d12Fence->GetCompletedValue() >= value;
+                    break;
+                }
+            }
+
+            sessionState.stats.cpuWaitTime +=
+                std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+            if (!completed) {
+                sessionState.stats.cpuWaitTimeouts++;
+            }
+
+            return completed;
+        }
+
+        // Create the copy queue and its fences upon first use.
+        void initializeCopyQueue(Session& sessionState) {
+            if (sessionState.copyQueue) {
+                return;
+            }
+
+            D3D12_COMMAND_QUEUE_DESC queueDesc{};
+            queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+            CHECK_HRCMD(sessionState.d3d12Device->CreateCommandQueue(
+                &queueDesc, IID_PPV_ARGS(sessionState.copyQueue.ReleaseAndGetAddressOf())));
+
+            {
+                CHECK_HRCMD(sessionState.d3d11Device->CreateFence(
+                    0,
+                    D3D11_FENCE_FLAG_SHARED,
+                    IID_PPV_ARGS(sessionState.d3d11RuntimeFence.ReleaseAndGetAddressOf())));
+                wil::unique_handle fenceHandle;
+                CHECK_HRCMD(sessionState.d3d11RuntimeFence->CreateSharedHandle(
+                    nullptr, GENERIC_ALL, nullptr, fenceHandle.put()));
+                CHECK_HRCMD(sessionState.d3d12Device->OpenSharedHandle(
+                    fenceHandle.get(), IID_PPV_ARGS(sessionState.d3d12RuntimeFence.ReleaseAndGetAddressOf())));
+            }
+
+            {
+                CHECK_HRCMD(sessionState.d3d12Device->CreateFence(
+                    0, D3D12_FENCE_FLAG_SHARED, IID_PPV_ARGS(sessionState.d3d12CopyFence.ReleaseAndGetAddressOf())));
+                wil::unique_handle fenceHandle;
+                CHECK_HRCMD(sessionState.d3d12Device->CreateSharedHandle(
+                    sessionState.d3d12CopyFence.Get(), nullptr, GENERIC_ALL, nullptr, fenceHandle.put()));
+                CHECK_HRCMD(sessionState.d3d11Device->OpenSharedFence(
+                    fenceHandle.get(), IID_PPV_ARGS(sessionState.d3d11CopyFence.ReleaseAndGetAddressOf())));
+            }
+
+            if (m_settings.placedResources) {
+                // The intermediate textures are always render targets or depth buffers.
+                sessionState.heapAllocator = std::make_unique<HeapAllocator>(
+                    sessionState.d3d12Device.Get(), D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES, 256ull << 20);
+            }
+        }
+
+        // Attempt to open a D3D11 texture on the D3D12 device, even though it was not created as shareable.
+        ComPtr<ID3D12Resource> tryImportTexture(Session& sessionState, ID3D11Texture2D* texture) {
+            ComPtr<IDXGIResource1> dxgiResource;
+            if (FAILED(texture->QueryInterface(IID_PPV_ARGS(dxgiResource.ReleaseAndGetAddressOf())))) {
+                return nullptr;
+            }
+
+            ComPtr<ID3D12Resource> d3d12Resource;
+
+            // KMT handles must not be closed.
+            HANDLE kmtHandle = nullptr;
+            if (SUCCEEDED(dxgiResource->GetSharedHandle(&kmtHandle)) && kmtHandle &&
+                SUCCEEDED(sessionState.d3d12Device->OpenSharedHandle(
+                    kmtHandle, IID_PPV_ARGS(d3d12Resource.ReleaseAndGetAddressOf())))) {
+                return d3d12Resource;
+            }
+
+            wil::unique_handle ntHandle;
+            if (SUCCEEDED(dxgiResource->CreateSharedHandle(nullptr, GENERIC_ALL, nullptr, ntHandle.put())) &&
+                SUCCEEDED(sessionState.d3d12Device->OpenSharedHandle(
+                    ntHandle.get(), IID_PPV_ARGS(d3d12Resource.ReleaseAndGetAddressOf())))) {
+                return d3d12Resource;
+            }
+
+            return nullptr;
+        }
+
+        // The state the app leaves the swapchain images in upon xrReleaseSwapchainImage().
+        static D3D12_RESOURCE_STATES getAppResourceState(const XrSwapchainCreateInfo& createInfo) {
+            return (createInfo.usageFlags & XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
+                       ? D3D12_RESOURCE_STATE_DEPTH_WRITE
+                       : D3D12_RESOURCE_STATE_RENDER_TARGET;
+        }
+
+        // Create an intermediate texture for the copy queue. When a placement is given, the texture is placed in one of
+        // the session's heaps if possible.
+        ComPtr<ID3D12Resource> createD3D12IntermediateTexture(Session& sessionState,
+                                                              const Swapchain& swapchainState,
+                                                              const D3D11_TEXTURE2D_DESC& desc,
+                                                              HeapAllocator::Allocation* placement) {
+            D3D12_RESOURCE_DESC resourceDesc{};
+            resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+            resourceDesc.Width = desc.Width;
+            resourceDesc.Height = desc.Height;
+            resourceDesc.DepthOrArraySize = desc.ArraySize;
+            resourceDesc.MipLevels = desc.MipLevels;
+            resourceDesc.Format = desc.Format;
+            resourceDesc.SampleDesc = desc.SampleDesc;
+            if (desc.BindFlags & D3D11_BIND_RENDER_TARGET) {
+                resourceDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+            }
+            if (desc.BindFlags & D3D11_BIND_DEPTH_STENCIL) {
+                resourceDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+            }
+            if (desc.BindFlags & D3D11_BIND_UNORDERED_ACCESS) {
+                resourceDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+            }
+
+            ComPtr<ID3D12Resource> texture;
+            if (placement && (resourceDesc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET |
+                                                    D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))) {
+                const auto allocationInfo = sessionState.d3d12Device->GetResourceAllocationInfo(0, 1, &resourceDesc);
+                *placement = sessionState.heapAllocator->allocate(allocationInfo,
+                                                                  sessionState.d3d12CopyFence->GetCompletedValue());
+                CHECK_HRCMD(sessionState.d3d12Device->CreatePlacedResource(
+                    placement->heap.Get(),
+                    placement->offset,
+                    &resourceDesc,
+                    getAppResourceState(swapchainState.createInfo),
+                    nullptr,
+                    IID_PPV_ARGS(texture.ReleaseAndGetAddressOf())));
+
+                return texture;
+            }
+
+            D3D12_HEAP_PROPERTIES heapProperties{};
+            heapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
+
+            CHECK_HRCMD(sessionState.d3d12Device->CreateCommittedResource(
+                &heapProperties,
+                D3D12_HEAP_FLAG_NONE,
+                &resourceDesc,
+                getAppResourceState(swapchainState.createInfo),
+                nullptr,
+                IID_PPV_ARGS(texture.ReleaseAndGetAddressOf())));
+
+            return texture;
+        }
+
+        // Placed textures must be initialized before their first use, since they may alias a previous texture.
+        void initializePlacedTextures(Session& sessionState, Swapchain& swapchainState) {
+            ComPtr<ID3D12GraphicsCommandList> commandList;
+            CHECK_HRCMD(
+                sessionState.d3d12Device->CreateCommandList(0,
+                                                            D3D12_COMMAND_LIST_TYPE_DIRECT,
+                                                            swapchainState.directCommandAllocator.Get(),
+                                                            nullptr,
+                                                            IID_PPV_ARGS(commandList.ReleaseAndGetAddressOf())));
+            for (uint32_t i = 0; i < swapchainState.placedAllocations.size(); i++) {
+                if (swapchainState.placedAllocations[i].heap) {
+                    commandList->DiscardResource(swapchainState.d3d12Textures[i].Get(), nullptr);
+                }
+            }
+            CHECK_HRCMD(commandList->Close());
+
+            ID3D12CommandList* const lists[] = {commandList.Get()};
+            sessionState.d3d12Queue->ExecuteCommandLists(1, lists);
+        }
+
+        // Evict the layer's resources once the work queued so far on the app's queues, the copy queue and the D3D11
+        // context is complete: the last frame's copies and the app's rendering may still use them.
+        void evictWhenIdle(Session& sessionState) {
+            std::vector<std::pair<ComPtr<ID3D12Fence>, UINT64>> fences;
+            CHECK_HRCMD(sessionState.d3d12Queue->Signal(sessionState.d3d12ReleaseFence.Get(),
+                                                        ++sessionState.releaseFenceValue));
+            fences.push_back({sessionState.d3d12ReleaseFence, sessionState.releaseFenceValue});
+            if (sessionState.copyQueue) {
+                fences.push_back({sessionState.d3d12CopyFence, sessionState.copyFenceValue});
+            }
+            for (const auto& additionalQueue : signalAdditionalQueues(sessionState)) {
+                fences.push_back({additionalQueue.d3d12Fence, additionalQueue.fenceValue});
+            }
+            wil::unique_handle eventHandle;
+            *eventHandle.put() = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+            sessionState.d3d11Context->Flush1(D3D11_CONTEXT_TYPE_ALL, eventHandle.get());
+
+            sessionState.memory->evictAfter(std::move(fences), std::move(eventHandle));
+        }
+
+        // Release the swapchains destroyed by the app that the GPU is done with. The ring is in submission order, so
+        // we stop at the first swapchain still in use.
+        void releaseRetiredSwapchains(Session& sessionState) {
+            if (m_retiredSwapchains.empty()) {
+                return;
+            }
+
+            const UINT64 completedFenceValue = sessionState.d3d12Fence->GetCompletedValue();
+            const UINT64 completedCopyFenceValue =
+                sessionState.copyQueue ? sessionState.d3d12CopyFence->GetCompletedValue() : 0;
+            for (auto it = m_retiredSwapchains.begin(); it != m_retiredSwapchains.end();) {
+                if (it->swapchain.xrSession != sessionState.xrSession) {
+                    it++;
+                    continue;
+                }
+                if (it->fenceValue > completedFenceValue || it->copyFenceValue > completedCopyFenceValue) {
+                    break;
+                }
+
+                auto& swapchainState = it->swapchain;
+
+                // Return the placed textures' memory to the heaps.
+                for (const auto& allocation : swapchainState.placedAllocations) {
+                    if (allocation.heap) {
+                        sessionState.heapAllocator->free(allocation, 0);
+                    }
+                }
+                sessionState.memory->release((uint64_t)swapchainState.xrSwapchain);
+                sessionState.stats.releasedSwapchains++;
+
+                it = m_retiredSwapchains.erase(it);
+            }
+        }
+
+        // Record the transitions of a texture between the state expected by the app and the common state.
+        void recordTransitions(Session& sessionState,
+                               Swapchain& swapchainState,
+                               ID3D12Resource* texture,
+                               Swapchain::CopyCommands& commands) {
+            const auto recordTransition = [&](D3D12_RESOURCE_STATES before,
+                                              D3D12_RESOURCE_STATES after,
+                                              ComPtr<ID3D12GraphicsCommandList>& commandList) {
+                CHECK_HRCMD(sessionState.d3d12Device->CreateCommandList(
+                    0,
+                    D3D12_COMMAND_LIST_TYPE_DIRECT,
+                    swapchainState.directCommandAllocator.Get(),
+                    nullptr,
+                    IID_PPV_ARGS(commandList.ReleaseAndGetAddressOf())));
+                D3D12_RESOURCE_BARRIER barrier{};
+                barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+                barrier.Transition.pResource = texture;
+                barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+                barrier.Transition.StateBefore = before;
+                barrier.Transition.StateAfter = after;
+                commandList->ResourceBarrier(1, &barrier);
+                CHECK_HRCMD(commandList->Close());
+            };
+
+            const auto appState = getAppResourceState(swapchainState.createInfo);
+            recordTransition(appState, D3D12_RESOURCE_STATE_COMMON, commands.toCommonState);
+            recordTransition(D3D12_RESOURCE_STATE_COMMON, appState, commands.toAppState);
+        }
+
+        void prepareCopyCommands(Session& sessionState, Swapchain& swapchainState, uint32_t index) {
+            ID3D12Resource* const intermediateTexture = swapchainState.d3d12Textures[index].Get();
+            ID3D12Resource* const runtimeTexture = swapchainState.d3d12RuntimeTextures[index].Get();
+            Swapchain::CopyCommands commands;
+
+            recordTransitions(sessionState, swapchainState, intermediateTexture, commands);
+
+            // Both textures are promoted from the common state by the copy queue, and decay back to it afterwards.
+            CHECK_HRCMD(sessionState.d3d12Device->CreateCommandList(
+                0,
+                D3D12_COMMAND_LIST_TYPE_COPY,
+                swapchainState.copyCommandAllocator.Get(),
+                nullptr,
+                IID_PPV_ARGS(commands.copy.ReleaseAndGetAddressOf())));
+            commands.copy->CopyResource(runtimeTexture, intermediateTexture);
+            CHECK_HRCMD(commands.copy->Close());
+
+            swapchainState.copyCommands.push_back(std::move(commands));
+        }
+
+        void copyOnCopyQueue(Session& sessionState, Swapchain& swapchainState, uint32_t index) {
+            auto& commands = swapchainState.copyCommands[index];
+
+            // Wait for the runtime to be done with its texture...
+            CHECK_HRCMD(sessionState.d3d11Context->Signal(sessionState.d3d11RuntimeFence.Get(),
+                                                          ++sessionState.runtimeFenceValue));
+            sessionState.d3d11Context->Flush();
+            CHECK_HRCMD(
+                sessionState.copyQueue->Wait(sessionState.d3d12RuntimeFence.Get(), sessionState.runtimeFenceValue));
+
+            // ...and for the app to be done with the intermediate texture.
+            for (const auto& additionalQueue : signalAdditionalQueues(sessionState)) {
+                CHECK_HRCMD(
+                    sessionState.d3d12Queue->Wait(additionalQueue.d3d12Fence.Get(), additionalQueue.fenceValue));
+            }
+            ID3D12CommandList* lists[] = {commands.toCommonState.Get()};
+            sessionState.d3d12Queue->ExecuteCommandLists(1, lists);
+            CHECK_HRCMD(sessionState.d3d12Queue->Signal(sessionState.d3d12ReleaseFence.Get(),
+                                                        ++sessionState.releaseFenceValue));
+            CHECK_HRCMD(
+                sessionState.copyQueue->Wait(sessionState.d3d12ReleaseFence.Get(), sessionState.releaseFenceValue));
+
+            lists[0] = commands.copy.Get();
+            sessionState.copyQueue->ExecuteCommandLists(1, lists);
+            CHECK_HRCMD(
+                sessionState.copyQueue->Signal(sessionState.d3d12CopyFence.Get(), ++sessionState.copyFenceValue));
+            commands.pendingCopyFenceValue = sessionState.copyFenceValue;
+
+            swapchainState.stats.copies++;
+            sessionState.stats.copies++;
+            sessionState.stats.bytesCopied += swapchainState.bytesPerCopy;
+        }
+
+        void logStatistics(const Session& sessionState) const {
+            const auto& stats = sessionState.stats;
+            if (stats.frames < 2) {
+                return;
+            }
+
+            const double duration =
+                std::chrono::duration<double>(stats.lastFrameTime - stats.firstFrameTime).count();
+            Log("Session statistics: %llu frames, %.1f fps, %llu idle frames, %llu static frames\n",
+                stats.frames,
+                (stats.frames - 1) / duration,
+                stats.idleFrames,
+                stats.staticFrames);
+            Log("  average frames in flight: %.2f\n", (double)stats.framesInFlight / stats.frames);
+            if (stats.staleRingSubmissions || stats.removedRingLayers) {
+                Log("  image ring: %llu stale submissions, %llu layers removed\n",
+                    stats.staleRingSubmissions,
+                    stats.removedRingLayers);
+            }
+            Log("  swapchain images import: %.1f ms, %llu swapchains released after use\n",
+                stats.swapchainImportTime,
+                stats.releasedSwapchains);
+            Log("  average CPU time in the layer: %.1f us\n",
+                std::chrono::duration<double, std::micro>(stats.cpuTime).count() / stats.frames);
+            Log("  average CPU wait: %.1f us (%llu timeouts)\n",
+                (double)stats.cpuWaitTime.count() / stats.frames,
+                stats.cpuWaitTimeouts);
+            if (stats.gpuWaitSamples) {
+                Log("  average GPU wait: %.1f us\n", stats.gpuWaitTime / stats.gpuWaitSamples);
+            }
+
+            const auto& memoryStats = sessionState.memory->getStatistics();
+            Log("  layer memory: %llu MB (peak %llu MB), imported: %llu MB, evictions: %llu\n",
+                memoryStats.allocatedBytes >> 20,
+                memoryStats.peakAllocatedBytes >> 20,
+                memoryStats.importedBytes >> 20,
+                memoryStats.evictions);
+            if (sessionState.crossAdapter) {
+                const auto transferStats = sessionState.crossAdapter->getStatistics();
+                Log("  cross-adapter transfers: %llu (%llu MB), %llu stalls\n",
+                    transferStats.transfers,
+                    transferStats.bytes >> 20,
+                    transferStats.stalls);
+                if (transferStats.transferTime > 0) {
+                    Log("  cross-adapter bandwidth: %.0f MB/s, average transfer time: %.1f us\n",
+                        transferStats.timedBytes / transferStats.transferTime,
+                        transferStats.transferTime / transferStats.timedTransfers);
+                }
+            }
+            if (sessionState.stallWatchdog) {
+                const auto watchdogStats = sessionState.stallWatchdog->getStatistics();
+                const auto& bounds = watchdogStats.frameBounds;
+                const auto& lateBounds = watchdogStats.lateFrameBounds;
+                Log("  frames bound by the app GPU: %llu (%llu late), interop: %llu (%llu late), runtime: %llu (%llu "
+                    "late), %llu stall diagnoses\n",
+                    bounds[0],
+                    lateBounds[0],
+                    bounds[1],
+                    lateBounds[1],
+                    bounds[2],
+                    lateBounds[2],
+                    watchdogStats.diagnoses);
+            }
+            if (sessionState.frameCapture) {
+                const auto captureStats = sessionState.frameCapture->getStatistics();
+                Log("  frame capture: %llu images, %llu dropped\n", captureStats.captured, captureStats.dropped);
+            }
+            if (sessionState.heapAllocator) {
+                const auto heapStats = sessionState.heapAllocator->getStatistics();
+                Log("  placed resources: %llu heaps, %llu allocations (%llu sub-allocated)\n",
+                    heapStats.heaps,
+                    heapStats.allocations,
+                    heapStats.reuses);
+            }
+            if (memoryStats.budget) {
+                Log("  video memory: %llu MB / %llu MB budget (%llu times over budget)\n",
+                    memoryStats.usage >> 20,
+                    memoryStats.budget >> 20,
+                    memoryStats.overBudget);
+            }
+        }
+
+        void logSwapchainStatistics(const Swapchain& swapchainState) const {
+            const auto& stats = swapchainState.stats;
+            if (!stats.copies) {
+                return;
+            }
+
+            Log("Swapchain statistics (%ux%u): %llu copies (%llu deferred, %llu dropped)\n",
+                swapchainState.createInfo.width,
+                swapchainState.createInfo.height,
+                stats.copies,
+                stats.deferredCopies,
+                stats.droppedCopies);
+            if (stats.gpuCopySamples) {
+                Log("  average GPU copy time: %.1f us\n", stats.gpuCopyTime / stats.gpuCopySamples);
+            }
+        }
+
+        // Release the session and its swapchains once all the queued work is complete, on the reclaim thread or on
+        // the calling thread (with a bounded wait).
+        void cleanupSession(Session& sessionState, bool deferRelease) {
+            logStatistics(sessionState);
+
+            Reclaimer::Job job;
+            job.description = "session";
+            CHECK_HRCMD(sessionState.d3d12Queue->Signal(sessionState.d3d12Fence.Get(), ++sessionState.fenceValue));
+            job.fences.push_back({sessionState.d3d12Fence, sessionState.fenceValue});
+            if (sessionState.copyQueue) {
+                job.fences.push_back({sessionState.d3d12CopyFence, sessionState.copyFenceValue});
+            }
+            for (const auto& additionalQueue : signalAdditionalQueues(sessionState)) {
+                job.fences.push_back({additionalQueue.d3d12Fence, additionalQueue.fenceValue});
+            }
+            wil::unique_handle eventHandle;
+            *eventHandle.put() = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+            sessionState.d3d11Context->Flush1(D3D11_CONTEXT_TYPE_ALL, eventHandle.get());
+            job.events.push_back(std::move(eventHandle));
+
+            auto resources = std::make_shared<std::pair<Session, std::vector<Swapchain>>>();
+            for (auto it = m_swapchains.begin(); it != m_swapchains.end();) {
+                auto& swapchainState = it->second;
+                if (swapchainState.xrSession == sessionState.xrSession) {
+                    logSwapchainStatistics(swapchainState);
+                    resources->second.push_back(std::move(swapchainState));
+                    it = m_swapchains.erase(it);
+                } else {
+                    it++;
+                }
+            }
+            for (auto it = m_retiredSwapchains.begin(); it != m_retiredSwapchains.end();) {
+                if (it->swapchain.xrSession == sessionState.xrSession) {
+                    resources->second.push_back(std::move(it->swapchain));
+                    it = m_retiredSwapchains.erase(it);
+                } else {
+                    it++;
+                }
+            }
+            resources->first = std::move(sessionState);
+            job.resources = std::move(resources);
+
+            if (deferRelease) {
+                m_reclaimer.defer(std::move(job));
+            } else {
+                Reclaimer::reclaimNow(std::move(job), 1000ms);
+            }
+        }
+
+        bool isSystemHandled(XrSystemId systemId) const {
+            return systemId == m_systemId;
+        }
+
+        bool isSessionHandled(XrSession session) const {
+            return m_sessions.find(session) != m_sessions.cend();
+        }
+
+        bool isSwapchainHandled(XrSwapchain swapchain) const {
+            return m_swapchains.find(swapchain) != m_swapchains.cend();
+        }
+
+        // TODO: This should be auto-generated in the dispatch layer.
+        static XrResult wrapper_xrGetD3D12GraphicsRequirementsKHR(
+            XrInstance instance, XrSystemId systemId, XrGraphicsRequirementsD3D12KHR* graphicsRequirements) {
             DebugLog("--> xrGetD3D12GraphicsRequirementsKHR\n");
 
             XrResult result;
@@ -515,13 +2568,75 @@ namespace {
             return result;
         }
 
+        static XrResult wrapper_xrRegisterD3D12QueueNOVENDOR(XrSession session, ID3D12CommandQueue* queue) {
+            DebugLog("--> xrRegisterD3D12QueueNOVENDOR\n");
+
+            XrResult result;
+            try {
+                result = dynamic_cast<OpenXrLayer*>(GetInstance())->xrRegisterD3D12QueueNOVENDOR(session, queue);
+            } catch (std::exception& exc) {
+                Log("%s\n", exc.what());
+                result = XR_ERROR_RUNTIME_FAILURE;
+            }
+
+            DebugLog("<-- xrRegisterD3D12QueueNOVENDOR %s\n", xr::ToCString(result));
+            return result;
+        }
+
+        static XrResult wrapper_xrUnregisterD3D12QueueNOVENDOR(XrSession session, ID3D12CommandQueue* queue) {
+            DebugLog("--> xrUnregisterD3D12QueueNOVENDOR\n");
+
+            XrResult result;
+            try {
+                result = dynamic_cast<OpenXrLayer*>(GetInstance())->xrUnregisterD3D12QueueNOVENDOR(session, queue);
+            } catch (std::exception& exc) {
+                Log("%s\n", exc.what());
+                result = XR_ERROR_RUNTIME_FAILURE;
+            }
+
+            DebugLog("<-- xrUnregisterD3D12QueueNOVENDOR %s\n", xr::ToCString(result));
+            return result;
+        }
+
+        static XrResult wrapper_xrGetD3D12on11StatisticsNOVENDOR(XrSession session,
+                                                                 XrD3D12on11StatisticsNOVENDOR* statistics) {
+            DebugLog("--> xrGetD3D12on11StatisticsNOVENDOR\n");
+
+            XrResult result;
+            try {
+                result =
+                    dynamic_cast<OpenXrLayer*>(GetInstance())->xrGetD3D12on11StatisticsNOVENDOR(session, statistics);
+            } catch (std::exception& exc) {
+                Log("%s\n", exc.what());
+                result = XR_ERROR_RUNTIME_FAILURE;
+            }
+
+            DebugLog("<-- xrGetD3D12on11StatisticsNOVENDOR %s\n", xr::ToCString(result));
+            return result;
+        }
+
+        settings::Settings m_settings;
+        std::unique_ptr<WorkerPool> m_workerPool;
+        std::unique_ptr<CapabilityCache> m_capabilityCache;
+        Reclaimer m_reclaimer;
+        std::string m_runtimeName;
         XrSystemId m_systemId{XR_NULL_SYSTEM_ID};
+        bool m_queuesExtensionEnabled{false};
+        bool m_statisticsExtensionEnabled{false};
 
         // TODO: This should be auto-generated and accessible via OpenXrApi.
         PFN_xrGetD3D11GraphicsRequirementsKHR xrGetD3D11GraphicsRequirementsKHR{nullptr};
 
         std::map<XrSession, Session> m_sessions;
         std::map<XrSwapchain, Swapchain> m_swapchains;
+
+        // The swapchains destroyed by the app, with the fence values after which the GPU no longer uses them.
+        struct RetiredSwapchain {
+            UINT64 fenceValue{0};
+            UINT64 copyFenceValue{0};
+            Swapchain swapchain;
+        };
+        std::deque<RetiredSwapchain> m_retiredSwapchains;
     };
 
     std::unique_ptr<OpenXrLayer> g_instance = nullptr;
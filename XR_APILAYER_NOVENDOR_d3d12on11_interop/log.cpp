@@ -23,9 +23,56 @@
 #include "pch.h"
 
 namespace d3d12on11_interop::log {
-    extern std::ofstream logStream;
 
     namespace {
+#ifdef _DEBUG
+        constexpr bool IsDebugBuild = true;
+#else
+        constexpr bool IsDebugBuild = false;
+#endif
+        bool debugLogEnabled = IsDebugBuild;
+
+        // The log may be written from the worker threads.
+        std::mutex logMutex;
+
+        // The log file is a circular buffer of fixed size following a header, mapped in memory. Writing a line is a
+        // copy into the mapping, the file never grows, and the most recent lines survive a crash of the application
+        // since the pages belong to the file cache. See scripts/log_decode.py for the decoder.
+        constexpr char RingMagic[8] = {'X', 'R', 'L', 'O', 'G', 'R', 'N', 'G'};
+        constexpr uint32_t RingVersion = 1;
+        constexpr uint64_t RingFileSize = 4 * 1024 * 1024;
+
+        struct RingHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t headerSize;
+            uint64_t capacity;
+
+            // The total number of bytes ever written. The next byte is written at writeOffset % capacity.
+            uint64_t writeOffset;
+        };
+
+        HANDLE ringFile = INVALID_HANDLE_VALUE;
+        HANDLE ringMapping = nullptr;
+        RingHeader* ringHeader = nullptr;
+        char* ringData = nullptr;
+
+        // Must be called with logMutex held.
+        void WriteToRing(const char* text, size_t length) {
+            const uint64_t capacity = ringHeader->capacity;
+            if (length > capacity) {
+                text += length - capacity;
+                length = (size_t)capacity;
+            }
+            const size_t position = (size_t)(ringHeader->writeOffset % capacity);
+            const size_t firstPart = (std::min)(length, (size_t)capacity - position);
+            memcpy(ringData + position, text, firstPart);
+            memcpy(ringData, text + firstPart, length - firstPart);
+
+            // Publish the text before moving the offset, so that a crash never exposes unwritten bytes.
+            std::atomic_thread_fence(std::memory_order_release);
+            ringHeader->writeOffset += length;
+        }
 
         // Utility logging function.
         void InternalLog(const char* fmt, va_list va) {
@@ -36,13 +83,76 @@ namespace d3d12on11_interop::log {
                 std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S %z: ", std::localtime(&now));
             vsnprintf_s(buf + offset, sizeof(buf) - offset, _TRUNCATE, fmt, va);
             OutputDebugStringA(buf);
-            if (logStream.is_open()) {
-                logStream << buf;
-                logStream.flush();
+            std::unique_lock lock(logMutex);
+            if (ringHeader) {
+                WriteToRing(buf, strlen(buf));
             }
         }
     } // namespace
 
+    void OpenFileLog(const std::filesystem::path& path) {
+        std::unique_lock lock(logMutex);
+        if (ringHeader) {
+            return;
+        }
+
+        // Only one process at a time may write the log, but it can be read while the application runs.
+        ringFile = CreateFileW(path.c_str(),
+                               GENERIC_READ | GENERIC_WRITE,
+                               FILE_SHARE_READ,
+                               nullptr,
+                               OPEN_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL,
+                               nullptr);
+        if (ringFile == INVALID_HANDLE_VALUE) {
+            return;
+        }
+
+        // Bring the file to its fixed size (this discards any log written in the former, unbounded, text format).
+        LARGE_INTEGER size{};
+        GetFileSizeEx(ringFile, &size);
+        const bool isResized = (uint64_t)size.QuadPart != RingFileSize;
+        if (isResized) {
+            size.QuadPart = RingFileSize;
+            if (!SetFilePointerEx(ringFile, size, nullptr, FILE_BEGIN) || !SetEndOfFile(ringFile)) {
+                CloseHandle(ringFile);
+                ringFile = INVALID_HANDLE_VALUE;
+                return;
+            }
+        }
+
+        ringMapping = CreateFileMappingW(ringFile, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+        void* view = ringMapping ? MapViewOfFile(ringMapping, FILE_MAP_WRITE, 0, 0, 0) : nullptr;
+        if (!view) {
+            if (ringMapping) {
+                CloseHandle(ringMapping);
+                ringMapping = nullptr;
+            }
+            CloseHandle(ringFile);
+            ringFile = INVALID_HANDLE_VALUE;
+            return;
+        }
+
+        // Keep appending to the history of the previous run (which may have ended with a crash) when it is valid.
+        RingHeader* header = reinterpret_cast<RingHeader*>(view);
+        if (isResized || memcmp(header->magic, RingMagic, sizeof(RingMagic)) || header->version != RingVersion ||
+            header->headerSize != sizeof(RingHeader) || header->capacity != RingFileSize - sizeof(RingHeader)) {
+            memset(view, 0, (size_t)RingFileSize);
+            memcpy(header->magic, RingMagic, sizeof(RingMagic));
+            header->version = RingVersion;
+            header->headerSize = sizeof(RingHeader);
+            header->capacity = RingFileSize - sizeof(RingHeader);
+            header->writeOffset = 0;
+        }
+        ringData = reinterpret_cast<char*>(view) + sizeof(RingHeader);
+        ringHeader = header;
+    }
+
+    bool IsFileLogOpen() {
+        std::unique_lock lock(logMutex);
+        return ringHeader != nullptr;
+    }
+
     void Log(const char* fmt, ...) {
         va_list va;
         va_start(va, fmt);
@@ -51,12 +161,16 @@ namespace d3d12on11_interop::log {
     }
 
     void DebugLog(const char* fmt, ...) {
-#ifdef _DEBUG
-        va_list va;
-        va_start(va, fmt);
-        InternalLog(fmt, va);
-        va_end(va);
-#endif
+        if (debugLogEnabled) {
+            va_list va;
+            va_start(va, fmt);
+            InternalLog(fmt, va);
+            va_end(va);
+        }
+    }
+
+    void EnableDebugLog(bool enable) {
+        debugLogEnabled = IsDebugBuild || enable;
     }
 
 } // namespace d3d12on11_interop::log
@@ -26,10 +26,20 @@
 
 namespace d3d12on11_interop::log {
 
+    // Start writing the log to the specified file. The file has a fixed size and holds the most recent lines in a
+    // circular buffer. See scripts/log_decode.py for the decoder.
+    void OpenFileLog(const std::filesystem::path& path);
+
+    // Whether the log is being written to a file.
+    bool IsFileLogOpen();
+
     // General logging function.
     void Log(const char* fmt, ...);
 
-    // Debug logging function. Can make things very slow (only enabled on Debug builds).
+    // Debug logging function. Can make things very slow (only enabled on Debug builds or with verbose logging).
     void DebugLog(const char* fmt, ...);
 
+    // Enable the debug logging function on Release builds.
+    void EnableDebugLog(bool enable);
+
 } // namespace d3d12on11_interop::log
@@ -0,0 +1,187 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "memory_manager.h"
+#include "log.h"
+
+namespace d3d12on11_interop {
+
+    using namespace d3d12on11_interop::log;
+
+    MemoryManager::MemoryManager(ID3D12Device* device, IDXGIAdapter3* adapter)
+        : m_device(device), m_adapter(adapter) {
+    }
+
+    void MemoryManager::trackAllocation(uint64_t owner, ID3D12Resource* resource) {
+        ensureResident();
+
+        m_allocations.push_back({owner, getAllocationSize(resource), resource, nullptr});
+        m_stats.allocatedBytes += m_allocations.back().size;
+        m_stats.peakAllocatedBytes = (std::max)(m_stats.peakAllocatedBytes, m_stats.allocatedBytes);
+        checkBudget();
+    }
+
+    void MemoryManager::trackHeap(uint64_t owner, ID3D12Heap* heap) {
+        for (const auto& entry : m_allocations) {
+            if (entry.d3d12Pageable.Get() == heap) {
+                return;
+            }
+        }
+
+        ensureResident();
+
+        m_allocations.push_back({owner, heap->GetDesc().SizeInBytes, heap, nullptr});
+        m_stats.allocatedBytes += m_allocations.back().size;
+        m_stats.peakAllocatedBytes = (std::max)(m_stats.peakAllocatedBytes, m_stats.allocatedBytes);
+        checkBudget();
+    }
+
+    void MemoryManager::trackAllocation(uint64_t owner, ID3D11Texture2D* texture, ID3D12Resource* imported) {
+        ensureResident();
+
+        m_allocations.push_back({owner, getAllocationSize(imported), nullptr, texture});
+        m_stats.allocatedBytes += m_allocations.back().size;
+        m_stats.peakAllocatedBytes = (std::max)(m_stats.peakAllocatedBytes, m_stats.allocatedBytes);
+        checkBudget();
+    }
+
+    void MemoryManager::trackImport(uint64_t owner, ID3D12Resource* resource) {
+        m_imports.push_back({owner, getAllocationSize(resource), nullptr, nullptr});
+        m_stats.importedBytes += m_imports.back().size;
+    }
+
+    void MemoryManager::release(uint64_t owner) {
+        const auto forget = [&](std::vector<Entry>& entries, uint64_t& bytes) {
+            for (auto it = entries.begin(); it != entries.end();) {
+                if (it->owner == owner) {
+                    bytes -= it->size;
+                    it = entries.erase(it);
+                } else {
+                    it++;
+                }
+            }
+        };
+
+        forget(m_allocations, m_stats.allocatedBytes);
+        forget(m_imports, m_stats.importedBytes);
+    }
+
+    void MemoryManager::setResident(bool resident) {
+        m_pendingEviction.reset();
+        if (resident == m_resident) {
+            return;
+        }
+
+        // Batch all the Direct3D 12 resources in a single call.
+        std::vector<ID3D12Pageable*> pageables;
+        for (const auto& entry : m_allocations) {
+            if (entry.d3d12Pageable) {
+                pageables.push_back(entry.d3d12Pageable.Get());
+            } else {
+                setResidency(entry, resident);
+            }
+        }
+        if (!pageables.empty()) {
+            if (resident) {
+                CHECK_HRCMD(m_device->MakeResident((UINT)pageables.size(), pageables.data()));
+            } else {
+                CHECK_HRCMD(m_device->Evict((UINT)pageables.size(), pageables.data()));
+            }
+        }
+
+        m_resident = resident;
+        if (!resident) {
+            m_stats.evictions++;
+        }
+        DebugLog("Layer resources are now %s (%llu bytes)\n",
+                 resident ? "resident" : "evictable",
+                 m_stats.allocatedBytes);
+    }
+
+    void MemoryManager::evictAfter(std::vector<std::pair<ComPtr<ID3D12Fence>, UINT64>> fences,
+                                   wil::unique_handle event) {
+        if (!m_resident) {
+            return;
+        }
+
+        m_pendingEviction = PendingEviction{std::move(fences), std::move(event)};
+        poll();
+    }
+
+    void MemoryManager::poll() {
+        if (!m_pendingEviction) {
+            return;
+        }
+
+        // Evicting resources that the GPU still uses is undefined behavior.
+        for (const auto& [fence, value] : m_pendingEviction->fences) {
+            if (fence->GetCompletedValue() < value) {
+                return;
+            }
+        }
+        if (m_pendingEviction->event && WaitForSingleObject(m_pendingEviction->event.get(), 0) != WAIT_OBJECT_0) {
+            return;
+        }
+
+        setResident(false);
+    }
+
+    bool MemoryManager::checkBudget() {
+        if (!m_adapter) {
+            return true;
+        }
+
+        DXGI_QUERY_VIDEO_MEMORY_INFO info{};
+        if (FAILED(m_adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info))) {
+            return true;
+        }
+
+        m_stats.budget = info.Budget;
+        m_stats.usage = info.CurrentUsage;
+        if (info.CurrentUsage <= info.Budget) {
+            return true;
+        }
+
+        // Only log the first occurrence, this is checked often.
+        if (!m_stats.overBudget++) {
+            Log("Over video memory budget: usage=%llu MB budget=%llu MB (layer=%llu MB)\n",
+                info.CurrentUsage >> 20,
+                info.Budget >> 20,
+                m_stats.allocatedBytes >> 20);
+        }
+        return false;
+    }
+
+    uint64_t MemoryManager::getAllocationSize(ID3D12Resource* resource) const {
+        const D3D12_RESOURCE_DESC desc = resource->GetDesc();
+        return m_device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+    }
+
+    void MemoryManager::setResidency(const Entry& entry, bool resident) {
+        // Direct3D 11 makes the texture resident again automatically upon its next use.
+        entry.d3d11Texture->SetEvictionPriority(resident ? DXGI_RESOURCE_PRIORITY_NORMAL
+                                                         : DXGI_RESOURCE_PRIORITY_MINIMUM);
+    }
+
+} // namespace d3d12on11_interop
@@ -0,0 +1,119 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace d3d12on11_interop {
+
+    // Accounting of the video memory used by the layer for a session, checked against the adapter budget.
+    //
+    // The resources are tracked by owner (the XrSwapchain handle), so they can all be forgotten at once when the
+    // swapchain is destroyed. Only the resources allocated by the layer count towards the budget, the runtime textures
+    // imported into Direct3D 12 are reported separately.
+    class MemoryManager {
+      public:
+        MemoryManager(ID3D12Device* device, IDXGIAdapter3* adapter);
+
+        // Track a texture allocated by the layer on the Direct3D 12 device.
+        void trackAllocation(uint64_t owner, ID3D12Resource* resource);
+
+        // Track a texture allocated by the layer on the Direct3D 11 device, with its import on the Direct3D 12 device
+        // (used to determine the actual allocation size).
+        void trackAllocation(uint64_t owner, ID3D11Texture2D* texture, ID3D12Resource* imported);
+
+        // Track a heap allocated by the layer on the Direct3D 12 device. A heap that is already tracked is ignored.
+        void trackHeap(uint64_t owner, ID3D12Heap* heap);
+
+        // Track a runtime texture imported on the Direct3D 12 device.
+        void trackImport(uint64_t owner, ID3D12Resource* resource);
+
+        // Forget all the resources of an owner.
+        void release(uint64_t owner);
+
+        // Make the resources resident again (canceling a pending eviction), or let them be paged out while the session
+        // is not visible. The Direct3D 12 resources are evicted, the Direct3D 11 textures are given the lowest eviction
+        // priority.
+        void setResident(bool resident);
+
+        // Let the resources be paged out once the GPU is done with them: when the fences reach their values and the
+        // event is signaled (for example from ID3D11DeviceContext3::Flush1()). The eviction is made by poll().
+        void evictAfter(std::vector<std::pair<ComPtr<ID3D12Fence>, UINT64>> fences, wil::unique_handle event);
+
+        // Make the pending eviction if the GPU is done, without blocking.
+        void poll();
+
+        // Ensure the resources are resident before the app or the layer uses them again.
+        void ensureResident() {
+            if (!m_resident || m_pendingEviction) {
+                setResident(true);
+            }
+        }
+
+        // Query the adapter budget and compare it to the current usage. Returns false when over budget.
+        bool checkBudget();
+
+        struct Statistics {
+            uint64_t allocatedBytes{0};
+            uint64_t peakAllocatedBytes{0};
+            uint64_t importedBytes{0};
+            uint64_t evictions{0};
+
+            // The latest values from the adapter (0 if not available).
+            uint64_t budget{0};
+            uint64_t usage{0};
+            uint64_t overBudget{0};
+        };
+
+        const Statistics& getStatistics() const {
+            return m_stats;
+        }
+
+      private:
+        struct Entry {
+            uint64_t owner;
+            uint64_t size;
+            ComPtr<ID3D12Pageable> d3d12Pageable;
+            ComPtr<ID3D11Texture2D> d3d11Texture;
+        };
+
+        uint64_t getAllocationSize(ID3D12Resource* resource) const;
+        void setResidency(const Entry& entry, bool resident);
+
+        const ComPtr<ID3D12Device> m_device;
+        const ComPtr<IDXGIAdapter3> m_adapter;
+
+        std::vector<Entry> m_allocations;
+        std::vector<Entry> m_imports;
+        bool m_resident{true};
+
+        struct PendingEviction {
+            std::vector<std::pair<ComPtr<ID3D12Fence>, UINT64>> fences;
+            wil::unique_handle event;
+        };
+        std::optional<PendingEviction> m_pendingEviction;
+
+        Statistics m_stats;
+    };
+
+} // namespace d3d12on11_interop
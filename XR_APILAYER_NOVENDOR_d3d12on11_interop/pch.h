@@ -23,19 +23,30 @@
 #pragma once
 
 // Standard library.
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <cstdarg>
 #include <ctime>
+#include <deque>
 #include <iomanip>
 #include <iostream>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <memory>
 #include <map>
+#include <mutex>
 #include <optional>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 using namespace std::chrono_literals;
@@ -52,7 +63,10 @@ using Microsoft::WRL::ComPtr;
 // Graphics APIs.
 #include <d3d12.h>
 #include <d3d11_4.h>
+#include <d3d11on12.h>
+#include <d3dcompiler.h>
 #include <dxgi.h>
+#include <dxgi1_4.h>
 
 // OpenXR + Windows-specific definitions.
 #define XR_NO_PROTOTYPES
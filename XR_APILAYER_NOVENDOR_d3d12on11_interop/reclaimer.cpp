@@ -0,0 +1,148 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "reclaimer.h"
+#include "log.h"
+
+namespace d3d12on11_interop {
+
+    using namespace d3d12on11_interop::log;
+
+    Reclaimer::~Reclaimer() {
+        // The thread was terminated with the process, and the jobs it did not complete are abandoned.
+        if (m_thread.joinable() && !isThreadAlive()) {
+            m_thread.detach();
+            return;
+        }
+
+        {
+            std::unique_lock lock(m_mutex);
+            m_shutdown = true;
+        }
+        m_wakeUp.notify_all();
+
+        // The pending jobs are completed before exiting.
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    void Reclaimer::defer(Job job) {
+        std::unique_lock lock(m_mutex);
+
+        // The thread is only started upon first use.
+        if (!m_thread.joinable()) {
+            m_thread = std::thread([this] { reclaimThread(); });
+        }
+
+        m_jobs.push_back(std::move(job));
+        m_wakeUp.notify_all();
+    }
+
+    void Reclaimer::reclaimNow(Job job, std::chrono::milliseconds timeout) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto remaining = [&] {
+            const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start);
+            return (DWORD)(std::max)(timeout - elapsed, 0ms).count();
+        };
+
+        bool isComplete = true;
+        wil::unique_handle fenceEvent;
+        *fenceEvent.put() = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);
+        for (const auto& [fence, value] : job.fences) {
+            // The call fails if the device was removed, in which case there is nothing to wait for.
+            if (fence->GetCompletedValue() < value && SUCCEEDED(fence->SetEventOnCompletion(value, fenceEvent.get())) &&
+                WaitForSingleObject(fenceEvent.get(), remaining()) != WAIT_OBJECT_0) {
+                isComplete = false;
+            }
+        }
+        for (const auto& event : job.events) {
+            if (WaitForSingleObject(event.get(), remaining()) != WAIT_OBJECT_0) {
+                isComplete = false;
+            }
+        }
+
+        const double duration =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (!isComplete) {
+            // The GPU may still use the resources: they are deliberately leaked, and reclaimed upon process exit.
+            new std::shared_ptr<void>(std::move(job.resources));
+            Log("Leaked %s, the GPU did not complete after %.1f ms\n", job.description.c_str(), duration);
+            return;
+        }
+        job.resources.reset();
+
+        Log("Released %s after %.1f ms\n", job.description.c_str(), duration);
+    }
+
+    void Reclaimer::drain() {
+        if (!isThreadAlive()) {
+            return;
+        }
+
+        std::unique_lock lock(m_mutex);
+        m_idle.wait(lock, [&] { return m_jobs.empty() && !m_busy; });
+    }
+
+    void Reclaimer::reclaimThread() {
+        std::unique_lock lock(m_mutex);
+        while (true) {
+            m_wakeUp.wait(lock, [&] { return m_shutdown || !m_jobs.empty(); });
+            if (m_jobs.empty()) {
+                break;
+            }
+
+            Job job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_busy = true;
+            lock.unlock();
+
+            const auto start = std::chrono::steady_clock::now();
+            for (const auto& [fence, value] : job.fences) {
+                // Without an event, this call blocks until the fence reaches the value. It fails if the device was
+                // removed, in which case there is nothing to wait for.
+                fence->SetEventOnCompletion(value, nullptr);
+            }
+            for (const auto& event : job.events) {
+                WaitForSingleObject(event.get(), INFINITE);
+            }
+            job.resources.reset();
+
+            Log("Released %s in the background after %.1f ms\n",
+                job.description.c_str(),
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+            lock.lock();
+            m_busy = false;
+            m_idle.notify_all();
+        }
+    }
+
+    bool Reclaimer::isThreadAlive() const {
+        return m_thread.joinable() &&
+               WaitForSingleObject(const_cast<std::thread&>(m_thread).native_handle(), 0) == WAIT_TIMEOUT;
+    }
+
+} // namespace d3d12on11_interop
@@ -0,0 +1,72 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace d3d12on11_interop {
+
+    // Releases resources on a background thread once the GPU is done with them, so the application's thread never
+    // blocks on the GPU upon teardown.
+    class Reclaimer {
+      public:
+        ~Reclaimer();
+
+        struct Job {
+            // The fence values to wait for.
+            std::vector<std::pair<ComPtr<ID3D12Fence>, UINT64>> fences;
+
+            // The events to wait for (for example from ID3D11DeviceContext3::Flush1()).
+            std::vector<wil::unique_handle> events;
+
+            // The resources to release, and a description for the log.
+            std::shared_ptr<void> resources;
+            std::string description;
+        };
+
+        void defer(Job job);
+
+        // Complete a job on the calling thread, waiting at most the timeout for the GPU. For when no thread can be
+        // started, such as upon process exit under the loader lock. If the GPU is not done with the resources by then,
+        // they are leaked rather than released.
+        static void reclaimNow(Job job, std::chrono::milliseconds timeout);
+
+        // Block until all the jobs are completed.
+        void drain();
+
+      private:
+        void reclaimThread();
+
+        // Upon process exit, the thread is terminated without notice before the layer is unloaded.
+        bool isThreadAlive() const;
+
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_wakeUp;
+        std::condition_variable m_idle;
+        std::deque<Job> m_jobs;
+        bool m_busy{false};
+        bool m_shutdown{false};
+    };
+
+} // namespace d3d12on11_interop
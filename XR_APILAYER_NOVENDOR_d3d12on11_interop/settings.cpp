@@ -0,0 +1,480 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "layer.h"
+#include "log.h"
+#include "settings.h"
+
+namespace d3d12on11_interop {
+    extern std::filesystem::path dllHome;
+    extern std::filesystem::path localAppData;
+} // namespace d3d12on11_interop
+
+namespace d3d12on11_interop::settings {
+
+    using namespace d3d12on11_interop::log;
+
+    namespace {
+
+        struct EnumValue {
+            const char* name;
+            int64_t value;
+        };
+
+        const EnumValue BoolValues[] = {{"false", 0}, {"true", 1}, {"off", 0}, {"on", 1}, {nullptr, 0}};
+        const EnumValue SyncModeValues[] = {{"gpu", (int64_t)SyncMode::GpuWait},
+                                            {"cpu", (int64_t)SyncMode::CpuWait},
+                                            {"deferred", (int64_t)SyncMode::Deferred},
+                                            {"none", (int64_t)SyncMode::None},
+                                            {nullptr, 0}};
+        const EnumValue CopyStrategyValues[] = {{"d3d11", (int64_t)CopyStrategy::D3D11Context},
+                                                {"d3d12_copy_queue", (int64_t)CopyStrategy::D3D12CopyQueue},
+                                                {nullptr, 0}};
+        const EnumValue CopyTimingValues[] = {
+            {"eager", (int64_t)CopyTiming::Eager}, {"deferred", (int64_t)CopyTiming::Deferred}, {nullptr, 0}};
+        const EnumValue AutoTuneValues[] = {{"off", (int64_t)AutoTune::Off},
+                                            {"sync", (int64_t)AutoTune::Sync},
+                                            {"copy", (int64_t)AutoTune::Copy},
+                                            {"all", (int64_t)AutoTune::All},
+                                            {nullptr, 0}};
+        const EnumValue BackendValues[] = {
+            {"d3d11", (int64_t)Backend::SharedDevice}, {"d3d11on12", (int64_t)Backend::D3D11On12}, {nullptr, 0}};
+        const EnumValue LogLevelValues[] = {
+            {"normal", (int64_t)LogLevel::Normal}, {"verbose", (int64_t)LogLevel::Verbose}, {nullptr, 0}};
+
+        // The description of each key in the settings file. The index in this table is used as the key identifier in
+        // the binary cache, therefore new keys must be added at the end.
+        struct KeyDescriptor {
+            const char* name;
+
+            // Textual values for the key, or nullptr if the value is a number.
+            const EnumValue* values;
+
+            void (*set)(Settings& settings, int64_t value);
+            int64_t (*get)(const Settings& settings);
+
+            // The range of a number value. Values out of range are clamped.
+            int64_t minValue;
+            int64_t maxValue;
+        };
+
+        const KeyDescriptor Keys[] = {
+            {"sync_mode",
+             SyncModeValues,
+             [](Settings& s, int64_t v) { s.syncMode = (SyncMode)v; },
+             [](const Settings& s) { return (int64_t)s.syncMode; }},
+            {"copy_strategy",
+             CopyStrategyValues,
+             [](Settings& s, int64_t v) { s.copyStrategy = (CopyStrategy)v; },
+             [](const Settings& s) { return (int64_t)s.copyStrategy; }},
+            {"log_level",
+             LogLevelValues,
+             [](Settings& s, int64_t v) { s.logLevel = (LogLevel)v; },
+             [](const Settings& s) { return (int64_t)s.logLevel; }},
+            {"pool_size",
+             nullptr,
+             [](Settings& s, int64_t v) { s.poolSize = (uint32_t)v; },
+             [](const Settings& s) { return (int64_t)s.poolSize; },
+             0,
+             (int64_t)std::thread::hardware_concurrency()},
+            {"worker_thread",
+             BoolValues,
+             [](Settings& s, int64_t v) { s.workerThread = v != 0; },
+             [](const Settings& s) { return (int64_t)s.workerThread; }},
+            {"capture",
+             BoolValues,
+             [](Settings& s, int64_t v) { s.capture = v != 0; },
+             [](const Settings& s) { return (int64_t)s.capture; }},
+            {"frames_in_flight",
+             nullptr,
+             [](Settings& s, int64_t v) { s.framesInFlight = (uint32_t)v; },
+             [](const Settings& s) { return (int64_t)s.framesInFlight; },
+             0,
+             16},
+            {"sync_timeout",
+             nullptr,
+             [](Settings& s, int64_t v) { s.syncTimeout = (uint32_t)v; },
+             [](const Settings& s) { return (int64_t)s.syncTimeout; },
+             1,
+             10000},
+            {"gpu_timers",
+             BoolValues,
+             [](Settings& s, int64_t v) { s.gpuTimers = v != 0; },
+             [](const Settings& s) { return (int64_t)s.gpuTimers; }},
+            {"placed_resources",
+             BoolValues,
+             [](Settings& s, int64_t v) { s.placedResources = v != 0; },
+             [](const Settings& s) { return (int64_t)s.placedResources; }},
+            {"image_ring",
+             nullptr,
+             [](Settings& s, int64_t v) { s.imageRing = (uint32_t)v; },
+             [](const Settings& s) { return (int64_t)s.imageRing; },
+             0,
+             8},
+            {"frame_capture",
+             nullptr,
+             [](Settings& s, int64_t v) { s.frameCapture = (uint32_t)v; },
+             [](const Settings& s) { return (int64_t)s.frameCapture; },
+             0,
+             100000},
+            {"frame_capture_depth",
+             nullptr,
+             [](Settings& s, int64_t v) { s.frameCaptureDepth = (uint32_t)v; },
+             [](const Settings& s) { return (int64_t)s.frameCaptureDepth; },
+             2,
+             64},
+            {"cross_adapter",
+             BoolValues,
+             [](Settings& s, int64_t v) { s.crossAdapter = v != 0; },
+             [](const Settings& s) { return (int64_t)s.crossAdapter; }},
+            {"backend",
+             BackendValues,
+             [](Settings& s, int64_t v) { s.backend = (Backend)v; },
+             [](const Settings& s) { return (int64_t)s.backend; }},
+            {"format_emulation",
+             BoolValues,
+             [](Settings& s, int64_t v) { s.formatEmulation = v != 0; },
+             [](const Settings& s) { return (int64_t)s.formatEmulation; }},
+            {"stall_watchdog",
+             nullptr,
+             [](Settings& s, int64_t v) { s.stallWatchdog = (uint32_t)v; },
+             [](const Settings& s) { return (int64_t)s.stallWatchdog; },
+             0,
+             100},
+            {"copy_timing",
+             CopyTimingValues,
+             [](Settings& s, int64_t v) { s.copyTiming = (CopyTiming)v; },
+             [](const Settings& s) { return (int64_t)s.copyTiming; }},
+            {"auto_tune",
+             AutoTuneValues,
+             [](Settings& s, int64_t v) { s.autoTune = (AutoTune)v; },
+             [](const Settings& s) { return (int64_t)s.autoTune; }},
+        };
+
+        // A section of the settings file.
+        struct Profile {
+            std::string pattern;
+            std::vector<std::pair<uint16_t, int64_t>> values;
+        };
+
+        // Binary cache format (all values are little-endian):
+        //   header: uint32_t magic, uint32_t version, uint64_t keysHash, int64_t sourceWriteTime,
+        //           uint64_t sourceSize, uint32_t profileCount
+        //   profiles: uint16_t patternLength, char[patternLength] pattern, uint16_t valueCount,
+        //             { uint16_t key, int64_t value }[valueCount]
+        constexpr uint32_t CacheMagic = 0x47464358; // 'XCFG'
+        constexpr uint32_t CacheVersion = 3;
+
+        std::string ToLower(std::string str) {
+            std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return std::tolower(c); });
+            return str;
+        }
+
+        std::string Trim(const std::string& str) {
+            const auto begin = str.find_first_not_of(" \t\r\n");
+            if (begin == std::string::npos) {
+                return "";
+            }
+            const auto end = str.find_last_not_of(" \t\r\n");
+            return str.substr(begin, end - begin + 1);
+        }
+
+        // Remove the comment from a line: '#' or ';' starts a comment at the beginning of the line, or after whitespace
+        // outside of a section header. Elsewhere, they are part of the application names and the values.
+        std::string StripComment(const std::string& line) {
+            const auto trimmed = Trim(line);
+            if (trimmed.empty() || trimmed.front() == '#' || trimmed.front() == ';') {
+                return "";
+            }
+            if (trimmed.front() == '[') {
+                return trimmed;
+            }
+
+            for (size_t i = 1; i < trimmed.size(); i++) {
+                if ((trimmed[i] == '#' || trimmed[i] == ';') && (trimmed[i - 1] == ' ' || trimmed[i - 1] == '\t')) {
+                    return Trim(trimmed.substr(0, i));
+                }
+            }
+            return trimmed;
+        }
+
+        // Case-insensitive glob matching, supporting * and ?.
+        bool GlobMatch(const char* pattern, const char* str) {
+            const char* starPattern = nullptr;
+            const char* starStr = nullptr;
+            while (*str) {
+                if (*pattern == '*') {
+                    starPattern = ++pattern;
+                    starStr = str;
+                } else if (*pattern == '?' ||
+                           std::tolower((unsigned char)*pattern) == std::tolower((unsigned char)*str)) {
+                    pattern++;
+                    str++;
+                } else if (starPattern) {
+                    pattern = starPattern;
+                    str = ++starStr;
+                } else {
+                    return false;
+                }
+            }
+            while (*pattern == '*') {
+                pattern++;
+            }
+            return !*pattern;
+        }
+
+        // A fingerprint of the key table, so that the cache is invalidated when the keys change.
+        uint64_t HashKeys() {
+            uint64_t hash = 14695981039346656037ull;
+            for (const auto& key : Keys) {
+                for (const char* c = key.name; *c; c++) {
+                    hash = (hash ^ (uint8_t)*c) * 1099511628211ull;
+                }
+                hash = (hash ^ 0xff) * 1099511628211ull;
+            }
+            return hash;
+        }
+
+        std::optional<int64_t> ParseValue(const KeyDescriptor& key, const std::string& value) {
+            if (key.values) {
+                const auto lowerValue = ToLower(value);
+                for (const EnumValue* entry = key.values; entry->name; entry++) {
+                    if (lowerValue == entry->name) {
+                        return entry->value;
+                    }
+                }
+                return {};
+            }
+
+            try {
+                size_t end;
+                const int64_t number = std::stoll(value, &end, 0);
+                if (end == value.size() && number >= 0) {
+                    return number;
+                }
+            } catch (std::exception&) {
+            }
+            return {};
+        }
+
+        std::vector<Profile> ParseFile(const std::filesystem::path& path) {
+            std::vector<Profile> profiles;
+            // Keys outside of any section apply to all applications.
+            profiles.push_back({"*", {}});
+
+            std::ifstream file(path);
+            std::string line;
+            unsigned int lineNumber = 0;
+            while (std::getline(file, line)) {
+                lineNumber++;
+
+                line = StripComment(line);
+                if (line.empty()) {
+                    continue;
+                }
+
+                if (line.front() == '[' && line.back() == ']') {
+                    profiles.push_back({Trim(line.substr(1, line.size() - 2)), {}});
+                    continue;
+                }
+
+                const auto equal = line.find('=');
+                if (equal == std::string::npos) {
+                    Log("%s:%u: Syntax error\n", path.filename().string().c_str(), lineNumber);
+                    continue;
+                }
+
+                const auto name = ToLower(Trim(line.substr(0, equal)));
+                const auto value = Trim(line.substr(equal + 1));
+                bool found = false;
+                for (uint16_t i = 0; i < std::size(Keys); i++) {
+                    if (name == Keys[i].name) {
+                        const auto parsed = ParseValue(Keys[i], value);
+                        if (parsed) {
+                            int64_t number = parsed.value();
+                            if (!Keys[i].values) {
+                                number = std::clamp(number, Keys[i].minValue, Keys[i].maxValue);
+                                if (number != parsed.value()) {
+                                    Log("%s:%u: Value %lld for %s is out of range, using %lld\n",
+                                        path.filename().string().c_str(),
+                                        lineNumber,
+                                        parsed.value(),
+                                        name.c_str(),
+                                        number);
+                                }
+                            }
+                            profiles.back().values.push_back({i, number});
+                        } else {
+                            Log("%s:%u: Invalid value '%s' for %s\n",
+                                path.filename().string().c_str(),
+                                lineNumber,
+                                value.c_str(),
+                                name.c_str());
+                        }
+                        found = true;
+                        break;
+                    }
+                }
+                if (!found) {
+                    Log("%s:%u: Unknown setting '%s'\n", path.filename().string().c_str(), lineNumber, name.c_str());
+                }
+            }
+
+            return profiles;
+        }
+
+        template <typename T>
+        bool Read(std::istream& stream, T& value) {
+            return !!stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+        }
+
+        template <typename T>
+        void Write(std::ostream& stream, const T& value) {
+            stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        std::optional<std::vector<Profile>>
+        ReadCache(const std::filesystem::path& path, int64_t sourceWriteTime, uint64_t sourceSize) {
+            std::ifstream file(path, std::ios_base::binary);
+            if (!file.is_open()) {
+                return {};
+            }
+
+            uint32_t magic, version, profileCount;
+            uint64_t keysHash, size;
+            int64_t writeTime;
+            if (!Read(file, magic) || !Read(file, version) || !Read(file, keysHash) || !Read(file, writeTime) ||
+                !Read(file, size) || !Read(file, profileCount) || magic != CacheMagic || version != CacheVersion ||
+                keysHash != HashKeys() || writeTime != sourceWriteTime || size != sourceSize) {
+                return {};
+            }
+
+            std::vector<Profile> profiles(profileCount);
+            for (auto& profile : profiles) {
+                uint16_t patternLength, valueCount;
+                if (!Read(file, patternLength)) {
+                    return {};
+                }
+                profile.pattern.resize(patternLength);
+                if (!file.read(profile.pattern.data(), patternLength) || !Read(file, valueCount)) {
+                    return {};
+                }
+                profile.values.resize(valueCount);
+                for (auto& value : profile.values) {
+                    if (!Read(file, value.first) || !Read(file, value.second) || value.first >= std::size(Keys)) {
+                        return {};
+                    }
+                }
+            }
+
+            return profiles;
+        }
+
+        void WriteCache(const std::filesystem::path& path,
+                        int64_t sourceWriteTime,
+                        uint64_t sourceSize,
+                        const std::vector<Profile>& profiles) {
+            std::ofstream file(path, std::ios_base::binary | std::ios_base::trunc);
+            if (!file.is_open()) {
+                return;
+            }
+
+            Write(file, CacheMagic);
+            Write(file, CacheVersion);
+            Write(file, HashKeys());
+            Write(file, sourceWriteTime);
+            Write(file, sourceSize);
+            Write(file, (uint32_t)profiles.size());
+            for (const auto& profile : profiles) {
+                Write(file, (uint16_t)profile.pattern.size());
+                file.write(profile.pattern.data(), profile.pattern.size());
+                Write(file, (uint16_t)profile.values.size());
+                for (const auto& value : profile.values) {
+                    Write(file, value.first);
+                    Write(file, value.second);
+                }
+            }
+        }
+
+    } // namespace
+
+    Settings Load(const std::string& applicationName) {
+        Settings settings;
+
+        // The settings file in the user's folder takes precedence over the one installed with the layer.
+        std::filesystem::path settingsFile;
+        for (const auto& folder : {localAppData, dllHome}) {
+            if (!folder.empty() && std::filesystem::exists(folder / (LayerName + ".cfg"))) {
+                settingsFile = folder / (LayerName + ".cfg");
+                break;
+            }
+        }
+        if (settingsFile.empty()) {
+            return settings;
+        }
+
+        std::error_code ec;
+        const int64_t writeTime = std::filesystem::last_write_time(settingsFile, ec).time_since_epoch().count();
+        const uint64_t size = std::filesystem::file_size(settingsFile, ec);
+
+        const auto cacheFile = localAppData / (LayerName + ".cfg.cache");
+        auto profiles = ReadCache(cacheFile, writeTime, size);
+        if (!profiles) {
+            Log("Parsing settings file: %s\n", settingsFile.string().c_str());
+            profiles = ParseFile(settingsFile);
+            WriteCache(cacheFile, writeTime, size, profiles.value());
+        }
+
+        // Apply all the matching sections in the order they appear in the file.
+        for (const auto& profile : profiles.value()) {
+            if (!GlobMatch(profile.pattern.c_str(), applicationName.c_str())) {
+                continue;
+            }
+            for (const auto& value : profile.values) {
+                Keys[value.first].set(settings, value.second);
+            }
+        }
+
+        return settings;
+    }
+
+    void Dump(const Settings& settings) {
+        for (const auto& key : Keys) {
+            const int64_t value = key.get(settings);
+            const char* valueName = nullptr;
+            for (const EnumValue* entry = key.values; entry && entry->name; entry++) {
+                if (entry->value == value) {
+                    valueName = entry->name;
+                    break;
+                }
+            }
+            if (valueName) {
+                Log("  %s = %s\n", key.name, valueName);
+            } else {
+                Log("  %s = %lld\n", key.name, value);
+            }
+        }
+    }
+
+} // namespace d3d12on11_interop::settings
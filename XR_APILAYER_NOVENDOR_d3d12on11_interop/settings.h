@@ -0,0 +1,156 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace d3d12on11_interop::settings {
+
+    // How to serialize the app's Direct3D 12 work with the runtime's Direct3D 11 work upon xrEndFrame().
+    enum class SyncMode : int64_t {
+        // The Direct3D 11 context waits on the GPU for the Direct3D 12 fence.
+        GpuWait = 0,
+
+        // The CPU waits for the Direct3D 12 fence before calling the runtime (bounded by the sync timeout).
+        CpuWait,
+
+        // The Direct3D 11 context waits on the GPU for the frame that is framesInFlight - 1 frames behind. Only for
+        // apps that already synchronize their rendering of the swapchain images externally.
+        Deferred,
+
+        // No synchronization, for apps that already synchronize externally.
+        None,
+    };
+
+    // How to copy the intermediate textures into the runtime textures (when they are not shareable).
+    enum class CopyStrategy : int64_t {
+        // Copy on the runtime's Direct3D 11 context.
+        D3D11Context = 0,
+
+        // Copy on a layer-owned Direct3D 12 copy queue.
+        D3D12CopyQueue,
+    };
+
+    // When to copy the intermediate textures into the runtime textures.
+    enum class CopyTiming : int64_t {
+        // Upon xrReleaseSwapchainImage().
+        Eager = 0,
+
+        // Upon xrEndFrame(), only for the images submitted.
+        Deferred,
+    };
+
+    // Which strategies the layer picks by itself from the timings measured at the start of the session.
+    enum class AutoTune : int64_t {
+        Off = 0,
+        Sync,
+        Copy,
+        All,
+    };
+
+    // How the runtime's Direct3D 11 device relates to the app's Direct3D 12 device.
+    enum class Backend : int64_t {
+        // A separate Direct3D 11 device, sharing the textures and a fence with the Direct3D 12 device.
+        SharedDevice = 0,
+
+        // A Direct3D 11On12 device wrapping the app's device and queue. The app renders directly to the resources
+        // underlying the runtime textures.
+        D3D11On12,
+    };
+
+    enum class LogLevel : int64_t {
+        Normal = 0,
+
+        // Also output the debug log messages (even in Release builds).
+        Verbose,
+    };
+
+    // The per-application settings. The defaults are used when no settings file is present.
+    struct Settings {
+        SyncMode syncMode{SyncMode::GpuWait};
+        CopyStrategy copyStrategy{CopyStrategy::D3D11Context};
+        LogLevel logLevel{LogLevel::Normal};
+
+        // The number of threads in the worker pool (0 means based on the number of CPU cores).
+        uint32_t poolSize{0};
+
+        // Whether to use worker threads to offload work from the application's thread.
+        bool workerThread{true};
+
+        // Whether to capture the OpenXR calls (see capture.h).
+        bool capture{false};
+
+        // The maximum number of frames the app may queue ahead of the GPU (0 means unbounded). The CPU waits upon
+        // xrEndFrame() when the limit is reached.
+        uint32_t framesInFlight{0};
+
+        // The maximum time to block the app's thread for a CPU wait (in milliseconds).
+        uint32_t syncTimeout{100};
+
+        // Whether to measure the GPU time of the interop work (copies and fence waits) with timestamp queries.
+        bool gpuTimers{false};
+
+        // Whether to allocate the intermediate textures for the Direct3D 12 copy queue as placed resources in a few
+        // large heaps, instead of one allocation per texture.
+        bool placedResources{false};
+
+        // The number of images of the layer-owned ring exposed to the app instead of the runtime's images (0 means
+        // disabled). The latest image released by the app is copied into a runtime image upon xrEndFrame().
+        uint32_t imageRing{0};
+
+        // Capture the images submitted every frameCapture frames (0 means disabled), with a ring of
+        // frameCaptureDepth staging textures (see frame_capture.h).
+        uint32_t frameCapture{0};
+        uint32_t frameCaptureDepth{4};
+
+        // Whether to allow the app to render on another adapter than the runtime's, transferring the images between
+        // the adapters (see cross_adapter.h).
+        bool crossAdapter{false};
+
+        Backend backend{Backend::SharedDevice};
+
+        // Whether to offer the app the formats that the runtime does not, converting them into the closest runtime
+        // format upon xrReleaseSwapchainImage() (see format_converter.h).
+        bool formatEmulation{false};
+
+        // The percentage of late frames over the last 90 frames above which the stall watchdog writes a diagnosis to
+        // the log (0 means disabled, see stall_watchdog.h).
+        uint32_t stallWatchdog{0};
+
+        CopyTiming copyTiming{CopyTiming::Eager};
+
+        // The strategies not tuned are taken from syncMode and copyTiming (see strategy_tuner.h).
+        AutoTune autoTune{AutoTune::Off};
+    };
+
+    // Load the settings for the application.
+    //
+    // The settings file is an INI-like text file with one section per application name (glob patterns with * and ?
+    // are allowed). The keys outside of any section apply to all applications. A parsed copy of the file is cached in
+    // a binary form, and the text is only parsed again when the file is modified.
+    Settings Load(const std::string& applicationName);
+
+    // Dump the settings to the log file.
+    void Dump(const Settings& settings);
+
+} // namespace d3d12on11_interop::settings
@@ -0,0 +1,128 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "stall_watchdog.h"
+#include "log.h"
+
+namespace {
+
+    // The minimum time between two diagnoses.
+    constexpr auto DiagnosisInterval = 10s;
+
+    const char* const BoundNames[] = {"app GPU", "interop", "runtime"};
+
+} // namespace
+
+namespace d3d12on11_interop {
+
+    using namespace d3d12on11_interop::log;
+
+    StallWatchdog::StallWatchdog(ID3D11Device5* device,
+                                 ID3D11DeviceContext4* context,
+                                 ID3D12Fence* appFence,
+                                 uint32_t thresholdPercent)
+        : m_context(context), m_appFence(appFence), m_thresholdPercent(thresholdPercent) {
+        CHECK_HRCMD(
+            device->CreateFence(0, D3D11_FENCE_FLAG_NONE, IID_PPV_ARGS(m_interopFence.ReleaseAndGetAddressOf())));
+    }
+
+    void StallWatchdog::endFrame(UINT64 appFenceValue) {
+        // The interop fence completes once the Direct3D 11 context went through the layer's work for the frame.
+        CHECK_HRCMD(m_context->Signal(m_interopFence.Get(), appFenceValue));
+
+        m_pendingFenceValue = appFenceValue;
+        m_pendingAppFrames = (uint32_t)(appFenceValue - (std::min)(m_appFence->GetCompletedValue(), appFenceValue));
+    }
+
+    void StallWatchdog::waitFrame(const XrFrameState& frameState) {
+        // A display period was skipped since the previous frame.
+        const bool late = m_lastDisplayTime && frameState.predictedDisplayPeriod &&
+                          frameState.predictedDisplayTime - m_lastDisplayTime >
+                              frameState.predictedDisplayPeriod + frameState.predictedDisplayPeriod / 2;
+        m_lastDisplayTime = frameState.predictedDisplayTime;
+        if (!m_pendingFenceValue) {
+            return;
+        }
+
+        const UINT64 fenceValue = m_pendingFenceValue.value();
+        m_pendingFenceValue.reset();
+        Sample sample{Bound::Runtime, late, m_pendingAppFrames};
+        if (m_appFence->GetCompletedValue() < fenceValue) {
+            sample.bound = Bound::AppGpu;
+        } else if (m_interopFence->GetCompletedValue() < fenceValue) {
+            sample.bound = Bound::Interop;
+        }
+
+        m_stats.frames++;
+        m_stats.frameBounds[(size_t)sample.bound]++;
+        if (sample.late) {
+            m_stats.lateFrameBounds[(size_t)sample.bound]++;
+        }
+
+        // Update the rolling window.
+        if (m_window.size() == WindowSize) {
+            const Sample& oldest = m_window.front();
+            if (oldest.late) {
+                m_windowLateBounds[(size_t)oldest.bound]--;
+                m_windowLateFrames--;
+            }
+            m_windowAppFramesPending -= oldest.appFramesPending;
+            m_window.pop_front();
+        }
+        m_window.push_back(sample);
+        if (sample.late) {
+            m_windowLateBounds[(size_t)sample.bound]++;
+            m_windowLateFrames++;
+        }
+        m_windowAppFramesPending += sample.appFramesPending;
+
+        if (m_window.size() == WindowSize && m_windowLateFrames * 100 > m_thresholdPercent * WindowSize) {
+            diagnose();
+        }
+    }
+
+    void StallWatchdog::diagnose() {
+        const auto now = std::chrono::steady_clock::now();
+        if (m_lastDiagnosisTime && now - m_lastDiagnosisTime.value() < DiagnosisInterval) {
+            return;
+        }
+        m_lastDiagnosisTime = now;
+        m_stats.diagnoses++;
+
+        const auto mostLikely = std::max_element(m_windowLateBounds.cbegin(), m_windowLateBounds.cend());
+        Log("Stalls: %u of the last %zu frames were late (%s: %u, %s: %u, %s: %u), most likely %s-bound, app GPU "
+            "work pending upon xrEndFrame(): %.2f frames\n",
+            m_windowLateFrames,
+            m_window.size(),
+            BoundNames[0],
+            m_windowLateBounds[0],
+            BoundNames[1],
+            m_windowLateBounds[1],
+            BoundNames[2],
+            m_windowLateBounds[2],
+            BoundNames[mostLikely - m_windowLateBounds.cbegin()],
+            (double)m_windowAppFramesPending / m_window.size());
+    }
+
+} // namespace d3d12on11_interop
@@ -0,0 +1,105 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace d3d12on11_interop {
+
+    // Attributes the frames to the app's GPU work, the layer's interop work or the runtime, by sampling the fences
+    // upon xrEndFrame() and upon the next xrWaitFrame(), without ever blocking:
+    // - the app's fence, signaled on the app's queue after the frame's rendering;
+    // - the interop fence, signaled on the Direct3D 11 context after the layer's copies and waits for the frame.
+    // A frame is late when the runtime skips a display period. When the late frames exceed the threshold over the
+    // rolling window, a diagnosis is written to the log (at most every few seconds).
+    class StallWatchdog {
+      public:
+        enum class Bound : uint8_t {
+            // The app's GPU work was not complete by the next xrWaitFrame().
+            AppGpu = 0,
+
+            // The app's GPU work was complete, but not the layer's work on the Direct3D 11 context.
+            Interop,
+
+            // Both were complete, the frame was paced by the runtime.
+            Runtime,
+
+            Count,
+        };
+
+        StallWatchdog(ID3D11Device5* device,
+                      ID3D11DeviceContext4* context,
+                      ID3D12Fence* appFence,
+                      uint32_t thresholdPercent);
+
+        // After the synchronization of a frame, with the app's fence value signaled for the frame.
+        void endFrame(UINT64 appFenceValue);
+
+        // After the runtime's xrWaitFrame(), which classifies the previous frame.
+        void waitFrame(const XrFrameState& frameState);
+
+        struct Statistics {
+            uint64_t frames{0};
+            std::array<uint64_t, (size_t)Bound::Count> frameBounds{};
+            std::array<uint64_t, (size_t)Bound::Count> lateFrameBounds{};
+            uint64_t diagnoses{0};
+        };
+        Statistics getStatistics() const {
+            return m_stats;
+        }
+
+      private:
+        static constexpr size_t WindowSize = 90;
+
+        struct Sample {
+            Bound bound;
+            bool late;
+
+            // The number of frames of the app's GPU work not complete upon xrEndFrame().
+            uint32_t appFramesPending;
+        };
+
+        void diagnose();
+
+        const ComPtr<ID3D11DeviceContext4> m_context;
+        const ComPtr<ID3D12Fence> m_appFence;
+        const uint32_t m_thresholdPercent;
+        ComPtr<ID3D11Fence> m_interopFence;
+
+        // The frame submitted upon the last xrEndFrame(), not classified yet.
+        std::optional<UINT64> m_pendingFenceValue;
+        uint32_t m_pendingAppFrames{0};
+
+        XrTime m_lastDisplayTime{0};
+
+        // The rolling window, with the sums over its frames.
+        std::deque<Sample> m_window;
+        std::array<uint32_t, (size_t)Bound::Count> m_windowLateBounds{};
+        uint32_t m_windowLateFrames{0};
+        uint64_t m_windowAppFramesPending{0};
+
+        std::optional<std::chrono::steady_clock::time_point> m_lastDiagnosisTime;
+        Statistics m_stats;
+    };
+
+} // namespace d3d12on11_interop
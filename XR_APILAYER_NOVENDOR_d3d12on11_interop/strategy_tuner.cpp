@@ -0,0 +1,141 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "strategy_tuner.h"
+#include "log.h"
+
+namespace {
+
+    using namespace d3d12on11_interop;
+
+    // The weight of the frame time (mean plus standard deviation) in the score, next to the time spent in the layer.
+    constexpr double FrameTimeWeight = 0.01;
+
+    std::string ToString(const Strategy& strategy) {
+        const char* const syncModes[] = {"gpu", "cpu", "deferred", "none"};
+        const char* const copyTimings[] = {"eager", "deferred"};
+        return fmt::format(
+            "sync_mode={} copy_timing={}", syncModes[(int)strategy.syncMode], copyTimings[(int)strategy.copyTiming]);
+    }
+
+} // namespace
+
+namespace d3d12on11_interop {
+
+    using namespace d3d12on11_interop::log;
+
+    StrategyTuner::StrategyTuner(const Strategy& strategy, uint32_t warmupFrames, uint32_t measuredFrames)
+        : m_warmupFrames(warmupFrames), m_measuredFrames(measuredFrames), m_strategy(strategy) {
+    }
+
+    void StrategyTuner::restart(const std::vector<Strategy>& candidates) {
+        if (candidates.empty()) {
+            return;
+        }
+
+        m_trials.clear();
+        for (const auto& candidate : candidates) {
+            m_trials.push_back({candidate});
+        }
+        m_currentTrial = 0;
+        m_trialFrame = 0;
+        m_lastFrameTime.reset();
+        m_strategy = candidates[0];
+        m_isLocked = candidates.size() < 2;
+
+        if (m_isLocked) {
+            Log("Using %s (nothing to tune)\n", ToString(m_strategy).c_str());
+        } else {
+            Log("Evaluating %zu strategies over %u frames each\n",
+                candidates.size(),
+                m_warmupFrames + m_measuredFrames);
+        }
+    }
+
+    void StrategyTuner::endFrame(bool isSynchronized, std::chrono::nanoseconds cpuTime, double gpuTime) {
+        const auto now = std::chrono::steady_clock::now();
+        const auto lastFrameTime = m_lastFrameTime;
+        const auto frameCpuTime = cpuTime - m_lastCpuTime;
+        const double frameGpuTime = gpuTime - m_lastGpuTime;
+        m_lastCpuTime = cpuTime;
+        m_lastGpuTime = gpuTime;
+        if (isSynchronized) {
+            m_lastFrameTime = now;
+        } else {
+            m_lastFrameTime.reset();
+        }
+        if (m_isLocked || !isSynchronized || !lastFrameTime) {
+            return;
+        }
+
+        // The first frames after a change of strategy are not representative.
+        auto& trial = m_trials[m_currentTrial];
+        if (m_trialFrame++ >= m_warmupFrames) {
+            const double frameTime = std::chrono::duration<double, std::micro>(now - lastFrameTime.value()).count();
+            trial.frames++;
+            trial.frameTimeSum += frameTime;
+            trial.frameTimeSquaresSum += frameTime * frameTime;
+            trial.cpuTimeSum += std::chrono::duration<double, std::micro>(frameCpuTime).count();
+
+            // The GPU timings are read back a few frames late, which the warm-up frames absorb.
+            trial.gpuTimeSum += frameGpuTime;
+        }
+
+        if (m_trialFrame == m_warmupFrames + m_measuredFrames) {
+            m_trialFrame = 0;
+            if (++m_currentTrial == m_trials.size()) {
+                lock();
+            }
+        }
+    }
+
+    void StrategyTuner::lock() {
+        Log("Strategy evaluation:\n");
+        double bestScore = 0;
+        for (const auto& trial : m_trials) {
+            const double mean = trial.frameTimeSum / trial.frames;
+            const double stddev = std::sqrt((std::max)(trial.frameTimeSquaresSum / trial.frames - mean * mean, 0.0));
+            const double cpuTime = trial.cpuTimeSum / trial.frames;
+            const double gpuTime = trial.gpuTimeSum / trial.frames;
+            const double score = cpuTime + gpuTime + FrameTimeWeight * (mean + stddev);
+            Log("  %s: layer CPU time %.1f us, GPU copy and wait time %.1f us, frame time %.2f ms (stddev %.2f ms), "
+                "score %.1f\n",
+                ToString(trial.strategy).c_str(),
+                cpuTime,
+                gpuTime,
+                mean / 1000,
+                stddev / 1000,
+                score);
+
+            if (&trial == &m_trials.front() || score < bestScore) {
+                bestScore = score;
+                m_strategy = trial.strategy;
+            }
+        }
+        m_isLocked = true;
+
+        Log("Selected %s\n", ToString(m_strategy).c_str());
+    }
+
+} // namespace d3d12on11_interop
@@ -0,0 +1,90 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+#include "settings.h"
+
+namespace d3d12on11_interop {
+
+    // The strategies that can be changed from one frame to the next.
+    struct Strategy {
+        settings::SyncMode syncMode;
+        settings::CopyTiming copyTiming;
+    };
+
+    // Picks the cheapest of the candidate strategies at the start of a session. Each candidate is tried in turn for a
+    // few warm-up frames, then measured over the next frames: the CPU time spent in the layer (which includes the CPU
+    // fence waits), the GPU time of the copies and fence waits (when the GPU timers are enabled), and the frame time
+    // seen by the app (between consecutive xrEndFrame()). The frame time is paced by the runtime, so it is only a
+    // secondary term that penalizes the candidates causing stutters. The candidate with the lowest score is then kept,
+    // until the next restart.
+    class StrategyTuner {
+      public:
+        // The initial strategy is used until the first evaluation.
+        StrategyTuner(const Strategy& strategy, uint32_t warmupFrames = 20, uint32_t measuredFrames = 80);
+
+        // Evaluate the candidates again, in order, for example when the swapchains changed. A single candidate is
+        // used right away.
+        void restart(const std::vector<Strategy>& candidates);
+
+        // The strategy for the current frame.
+        const Strategy& getStrategy() const {
+            return m_isLocked ? m_strategy : m_trials[m_currentTrial].strategy;
+        }
+
+        // Upon xrEndFrame(), with the total CPU time spent in the layer so far, and the total GPU time of the copies
+        // and fence waits measured so far (in microseconds). Frames that were not synchronized (idle or static frames)
+        // are not measured.
+        void endFrame(bool isSynchronized, std::chrono::nanoseconds cpuTime, double gpuTime);
+
+      private:
+        struct Trial {
+            Strategy strategy;
+            uint32_t frames{0};
+
+            // In microseconds.
+            double frameTimeSum{0};
+            double frameTimeSquaresSum{0};
+            double cpuTimeSum{0};
+            double gpuTimeSum{0};
+        };
+
+        void lock();
+
+        const uint32_t m_warmupFrames;
+        const uint32_t m_measuredFrames;
+
+        std::vector<Trial> m_trials;
+        size_t m_currentTrial{0};
+        uint32_t m_trialFrame{0};
+        bool m_isLocked{true};
+        Strategy m_strategy;
+
+        std::optional<std::chrono::steady_clock::time_point> m_lastFrameTime;
+        std::chrono::nanoseconds m_lastCpuTime{0};
+        double m_lastGpuTime{0};
+    };
+
+} // namespace d3d12on11_interop
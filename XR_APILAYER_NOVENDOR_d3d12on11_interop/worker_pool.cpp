@@ -0,0 +1,113 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "worker_pool.h"
+
+namespace d3d12on11_interop {
+
+    WorkerPool::WorkerPool(uint32_t size) {
+        if (!size) {
+            // Keep the pool small, the work is mostly spent in the drivers.
+            size = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+        }
+
+        for (uint32_t i = 0; i < size; i++) {
+            m_threads.emplace_back([this] { workerThread(); });
+        }
+    }
+
+    WorkerPool::~WorkerPool() {
+        {
+            std::unique_lock lock(m_mutex);
+            m_shutdown = true;
+        }
+        m_wakeUp.notify_all();
+
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)>& function) {
+        std::unique_lock lock(m_mutex);
+
+        // Only one batch at a time.
+        m_done.wait(lock, [&] { return !m_function; });
+
+        m_function = &function;
+        m_count = count;
+        m_nextIndex = 0;
+        m_pending = count;
+        m_exception = nullptr;
+        m_wakeUp.notify_all();
+
+        runTasks(lock);
+        m_done.wait(lock, [&] { return !m_pending; });
+
+        m_function = nullptr;
+        const std::exception_ptr exception = m_exception;
+        m_exception = nullptr;
+        m_done.notify_all();
+
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    void WorkerPool::workerThread() {
+        std::unique_lock lock(m_mutex);
+        while (true) {
+            m_wakeUp.wait(lock, [&] { return m_shutdown || (m_function && m_nextIndex < m_count); });
+            if (m_shutdown) {
+                break;
+            }
+
+            runTasks(lock);
+        }
+    }
+
+    void WorkerPool::runTasks(std::unique_lock<std::mutex>& lock) {
+        const auto& function = *m_function;
+        while (m_nextIndex < m_count) {
+            const size_t index = m_nextIndex++;
+
+            lock.unlock();
+            std::exception_ptr exception;
+            try {
+                function(index);
+            } catch (...) {
+                exception = std::current_exception();
+            }
+            lock.lock();
+
+            if (exception && !m_exception) {
+                m_exception = exception;
+            }
+            if (!--m_pending) {
+                m_done.notify_all();
+            }
+        }
+    }
+
+} // namespace d3d12on11_interop
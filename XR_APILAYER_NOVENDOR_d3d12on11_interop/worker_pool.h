@@ -0,0 +1,64 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+namespace d3d12on11_interop {
+
+    // A small pool of threads to run independent pieces of work in parallel, such as the creation and import of the
+    // swapchain images. The caller's thread participates in the work and returns once all of it is done.
+    class WorkerPool {
+      public:
+        // A size of 0 picks a size based on the number of CPU cores.
+        explicit WorkerPool(uint32_t size = 0);
+        ~WorkerPool();
+
+        uint32_t getSize() const {
+            return (uint32_t)m_threads.size();
+        }
+
+        // Invoke the function for each index in [0, count) and wait for completion. The first exception thrown by the
+        // function is re-thrown on the caller's thread.
+        void parallelFor(size_t count, const std::function<void(size_t)>& function);
+
+      private:
+        void workerThread();
+        void runTasks(std::unique_lock<std::mutex>& lock);
+
+        std::vector<std::thread> m_threads;
+
+        std::mutex m_mutex;
+        std::condition_variable m_wakeUp;
+        std::condition_variable m_done;
+        bool m_shutdown{false};
+
+        // The current batch of work.
+        const std::function<void(size_t)>* m_function{nullptr};
+        size_t m_count{0};
+        size_t m_nextIndex{0};
+        size_t m_pending{0};
+        std::exception_ptr m_exception;
+    };
+
+} // namespace d3d12on11_interop
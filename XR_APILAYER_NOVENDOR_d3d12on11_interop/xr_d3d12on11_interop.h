@@ -0,0 +1,78 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+// Public interface of the extensions implemented by the layer. Applications may include this file after
+// openxr_platform.h (with XR_USE_GRAPHICS_API_D3D12 defined), and must enable the extensions upon xrCreateInstance().
+
+// XR_NOVENDOR_d3d12on11_queues: synchronize the runtime with additional Direct3D 12 queues.
+//
+// By default, the layer only synchronizes the runtime with the queue passed in XrGraphicsBindingD3D12KHR. Applications
+// rendering to the swapchain images from other queues (for example async compute) can register those queues, and the
+// layer will make the runtime wait on the GPU for all of them upon xrReleaseSwapchainImage() and xrEndFrame().
+//
+// These functions must be externally synchronized with the frame functions of the session.
+#define XR_NOVENDOR_d3d12on11_queues 1
+#define XR_NOVENDOR_d3d12on11_queues_SPEC_VERSION 1
+#define XR_NOVENDOR_D3D12ON11_QUEUES_EXTENSION_NAME "XR_NOVENDOR_d3d12on11_queues"
+
+typedef XrResult(XRAPI_PTR* PFN_xrRegisterD3D12QueueNOVENDOR)(XrSession session, ID3D12CommandQueue* queue);
+typedef XrResult(XRAPI_PTR* PFN_xrUnregisterD3D12QueueNOVENDOR)(XrSession session, ID3D12CommandQueue* queue);
+
+// XR_NOVENDOR_d3d12on11_statistics: query the cost of the interop for a session.
+//
+// The statistics are accumulated since the creation of the session. This function must be externally synchronized
+// with the frame functions of the session.
+#define XR_NOVENDOR_d3d12on11_statistics 1
+#define XR_NOVENDOR_d3d12on11_statistics_SPEC_VERSION 1
+#define XR_NOVENDOR_D3D12ON11_STATISTICS_EXTENSION_NAME "XR_NOVENDOR_d3d12on11_statistics"
+
+// There is no registered structure type for this layer, we use a value outside of the ranges reserved by the
+// specification.
+#define XR_TYPE_D3D12ON11_STATISTICS_NOVENDOR ((XrStructureType)0x7ffd3d01)
+
+typedef struct XrD3D12on11StatisticsNOVENDOR {
+    XrStructureType type;
+    void* XR_MAY_ALIAS next;
+
+    // Number of frames submitted to the runtime.
+    uint64_t frameCount;
+
+    // Number of copies from the intermediate textures, and their total size.
+    uint64_t copyCount;
+    uint64_t bytesCopied;
+
+    // Time spent waiting for the application's GPU work: on the CPU (sync_mode = cpu or frames_in_flight), and on the
+    // GPU (only measured with gpu_timers = true).
+    XrDuration cpuFenceWaitTime;
+    XrDuration gpuFenceWaitTime;
+
+    // CPU time spent by the layer in the frame functions, excluding the calls to the runtime.
+    XrDuration cpuTime;
+
+    // Video memory allocated by the layer for the intermediate textures.
+    uint64_t intermediateMemoryBytes;
+} XrD3D12on11StatisticsNOVENDOR;
+
+typedef XrResult(XRAPI_PTR* PFN_xrGetD3D12on11StatisticsNOVENDOR)(XrSession session,
+                                                                   XrD3D12on11StatisticsNOVENDOR* statistics);
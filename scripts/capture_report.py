@@ -0,0 +1,200 @@
+# MIT License
+#
+# Copyright(c) 2022 Matthieu Bucchianeri
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this softwareand associated documentation files(the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions :
+#
+# The above copyright noticeand this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Decode a capture of OpenXR calls recorded by the layer and report the latency distribution of each call. The latency
+# of a call includes the next layers and the runtime, and the time spent in the layer itself (excluding the calls to
+# the next layers and the runtime) is reported separately.
+#
+# Enable the capture by setting the CAPTURE_XR_APILAYER_NOVENDOR_d3d12on11_interop environment variable before starting
+# the application. The capture is appended to %LOCALAPPDATA%\XR_APILAYER_NOVENDOR_d3d12on11_interop.capture.
+#
+# The report can be saved as a baseline, and later captures of the same scenario compared against it. The comparison
+# fails (non-zero exit code) when the time spent in the layer per frame or per call regresses by more than the
+# threshold. Only the layer's own time is compared, since the time spent in the runtime depends on the system, and
+# xrWaitFrame is excluded since it blocks for the frame pacing. The captures from before version 2 do not record the
+# time spent downstream: their latencies (still excluding xrWaitFrame) are compared instead.
+#
+# Usage: python capture_report.py <capture file> [--save-baseline <json>] [--baseline <json>] [--threshold <percent>]
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = b'XRCAPTUR'
+SUPPORTED_VERSIONS = (1, 2)
+
+# The calls that block for the frame pacing of the runtime, excluded from the comparison with the baseline.
+PACING_APIS = ('xrWaitFrame',)
+
+class Call:
+    def __init__(self, name, thread_id, result, start, end, downstream, payload):
+        self.name = name
+        self.thread_id = thread_id
+        self.result = result
+        self.start = start
+        self.end = end
+        # The time spent in the next layers and the runtime (None before version 2).
+        self.downstream = downstream
+        self.payload = payload
+
+def read_capture(path):
+    '''Yield (ticks_per_second, Call) for each call in the capture. A file may contain several capture sessions.'''
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    offset = 0
+    frequency = None
+    version = None
+    api_names = {}
+    while offset < len(data):
+        if data[offset:offset + len(MAGIC)] == MAGIC:
+            version, _, frequency = struct.unpack_from('<IIq', data, offset + len(MAGIC))
+            if version not in SUPPORTED_VERSIONS:
+                raise Exception(f'Unsupported capture version {version}')
+            api_names = {}
+            offset += len(MAGIC) + 16
+            continue
+
+        tag = data[offset:offset + 1]
+        offset += 1
+        if tag == b'N':
+            api_id, length = struct.unpack_from('<HH', data, offset)
+            offset += 4
+            api_names[api_id] = data[offset:offset + length].decode('ascii')
+            offset += length
+        elif tag == b'C':
+            record_format = '<HIiqqI' if version == 1 else '<HIiqqqI'
+            if offset + struct.calcsize(record_format) > len(data):
+                break
+            fields = struct.unpack_from(record_format, data, offset)
+            api_id, thread_id, result, start, end = fields[:5]
+            downstream = fields[5] if version > 1 else None
+            payload_size = fields[-1]
+            offset += struct.calcsize(record_format)
+            payload = data[offset:offset + payload_size]
+            offset += payload_size
+            yield frequency, Call(api_names.get(api_id, f'<api {api_id}>'), thread_id, result, start, end, downstream,
+                                  payload)
+        else:
+            # A truncated record (the application was terminated during a write).
+            break
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return 0
+    index = min(len(sorted_values) - 1, int(round(p / 100 * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+def latency_report(path):
+    '''Return two dictionaries of API name to sorted list of times (in microseconds): the latencies of the calls, and
+    the time spent in the layer itself (only for the captures recording the downstream time).'''
+    latencies = {}
+    layer_times = {}
+    for frequency, call in read_capture(path):
+        latencies.setdefault(call.name, []).append((call.end - call.start) * 1e6 / frequency)
+        if call.downstream is not None:
+            layer_times.setdefault(call.name, []).append((call.end - call.start - call.downstream) * 1e6 / frequency)
+    for values in list(latencies.values()) + list(layer_times.values()):
+        values.sort()
+    return latencies, layer_times
+
+def summarize(latencies, layer_times):
+    '''Return the metrics compared between a capture and a baseline.'''
+    # Prefer the time spent in the layer itself when the capture records it.
+    if layer_times:
+        times, prefix = layer_times, 'layer '
+    else:
+        times, prefix = latencies, ''
+    times = {name: values for name, values in times.items() if name not in PACING_APIS}
+
+    metrics = {}
+    for name, values in times.items():
+        metrics[f'{name} {prefix}mean'] = sum(values) / len(values)
+        metrics[f'{name} {prefix}p99'] = percentile(values, 99)
+
+    # The frame count is given by xrEndFrame.
+    frames = len(latencies.get('xrEndFrame', []))
+    if frames:
+        metrics[f'{prefix}time per frame'] = sum(sum(values) for values in times.values()) / frames
+        metrics['calls per frame'] = sum(len(values) for values in latencies.values()) / frames
+    return metrics
+
+def compare(metrics, baseline, threshold, min_delta):
+    '''Print the metrics that regressed compared to the baseline, and return their count.'''
+    regressions = 0
+    for name, reference in sorted(baseline.items()):
+        if name not in metrics:
+            continue
+        value = metrics[name]
+        # Ignore the noise on very short calls.
+        if value > reference * (1 + threshold / 100) and value - reference > min_delta:
+            print(f'REGRESSION: {name}: {value:.1f} (baseline {reference:.1f}, +{(value / reference - 1) * 100:.0f}%)')
+            regressions += 1
+    return regressions
+
+def print_distributions(title, times):
+    print(title)
+    print(f'{"API":<32} {"count":>8} {"mean":>10} {"p50":>10} {"p90":>10} {"p99":>10} {"max":>10}  (us)')
+    for name, values in sorted(times.items()):
+        mean = sum(values) / len(values)
+        print(f'{name:<32} {len(values):>8} {mean:>10.1f} {percentile(values, 50):>10.1f} '
+              f'{percentile(values, 90):>10.1f} {percentile(values, 99):>10.1f} {values[-1]:>10.1f}')
+
+def main():
+    parser = argparse.ArgumentParser(description='Report the latency of the OpenXR calls from a capture.')
+    parser.add_argument('capture', help='the capture file')
+    parser.add_argument('--save-baseline', metavar='JSON', help='save the metrics as a baseline')
+    parser.add_argument('--baseline', metavar='JSON', help='compare the metrics against a baseline')
+    parser.add_argument('--threshold', type=float, default=10, help='the allowed regression in percent (default 10)')
+    parser.add_argument('--min-delta', type=float, default=5, help='the allowed regression in us (default 5)')
+    args = parser.parse_args()
+
+    latencies, layer_times = latency_report(args.capture)
+
+    print_distributions('Latency of the calls', latencies)
+    if layer_times:
+        print()
+        print_distributions('Time spent in the layer (excluding the next layers and the runtime)', layer_times)
+
+    metrics = summarize(latencies, layer_times)
+    if 'calls per frame' in metrics:
+        where = 'in the layer' if layer_times else 'in the calls'
+        time_per_frame = metrics['layer time per frame' if layer_times else 'time per frame']
+        print(f'{metrics["calls per frame"]:.1f} calls per frame, {time_per_frame:.1f} us per frame {where} '
+              f'(excluding {", ".join(PACING_APIS)})')
+
+    if args.save_baseline:
+        with open(args.save_baseline, 'w') as f:
+            json.dump(metrics, f, indent=2, sort_keys=True)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        if compare(metrics, baseline, args.threshold, args.min_delta):
+            return 1
+        print('No regression against the baseline')
+
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,77 @@
+# MIT License
+#
+# Copyright(c) 2022 Matthieu Bucchianeri
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this softwareand associated documentation files(the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions :
+#
+# The above copyright noticeand this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Decode the log file written by the layer into ordered text.
+#
+# The log is written to %LOCALAPPDATA%\XR_APILAYER_NOVENDOR_d3d12on11_interop.log as a circular buffer of fixed size
+# following a header that holds the total number of bytes written. Once the buffer has wrapped around, the oldest
+# (partially overwritten) line is dropped.
+#
+# Usage: python log_decode.py <log file> [--output <text file>]
+
+import argparse
+import struct
+import sys
+
+MAGIC = b'XRLOGRNG'
+SUPPORTED_VERSION = 1
+HEADER_FORMAT = '<8sIIQQ'
+
+def decode_log(path):
+    '''Return the text of the log, from the oldest to the most recent line.'''
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    # Logs from older versions of the layer are plain text.
+    if not data.startswith(MAGIC):
+        return data.decode('utf-8', errors='replace')
+
+    _, version, header_size, capacity, write_offset = struct.unpack_from(HEADER_FORMAT, data)
+    if version != SUPPORTED_VERSION:
+        raise ValueError('Unsupported log version {}'.format(version))
+    ring = data[header_size:header_size + capacity]
+    if len(ring) != capacity:
+        raise ValueError('Truncated log file')
+
+    if write_offset <= capacity:
+        text = ring[:write_offset]
+    else:
+        position = write_offset % capacity
+        text = ring[position:] + ring[:position]
+        text = text[text.find(b'\n') + 1:]
+    return text.decode('utf-8', errors='replace')
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode the log file of the layer.')
+    parser.add_argument('log', help='the log file')
+    parser.add_argument('--output', help='write the text to this file instead of the standard output')
+    args = parser.parse_args()
+
+    text = decode_log(args.log)
+    if args.output:
+        with open(args.output, 'w', encoding='utf-8') as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,1057 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Benchmark of the layer over a stub runtime (see stub_runtime.h), on the WARP software adapter so that it runs
+// without a GPU. Each scenario submits frames with a number of swapchains, periodically recreating a swapchain and
+// restarting the session, and reports per frame the CPU time of the layer (excluding the runtime and the application),
+// the heap allocations, and the heap memory held at the end of the run.
+//
+// With --replay, the calls recorded in a capture of an application (see capture.h) are replayed through the layer
+// instead, and the latency distribution of each call is reported. Since the stub runtime does almost no work, the
+// latencies are essentially the time spent in the layer.
+//
+// The report can be saved as a baseline, and later runs compared against it. The comparison fails (non-zero exit
+// code) when a metric regresses by more than the threshold.
+//
+// Usage: benchmark.exe [--frames <count>] [--swapchains <count>,...] [--recreate-every <frames>]
+//                      [--restart-every <frames>] [--size <pixels>] [--shareable] [--hardware]
+//                      [--replay <capture>] [--save-baseline <json>] [--baseline <json>] [--threshold <percent>]
+
+#include "pch.h"
+
+#include <malloc.h>
+#include <numeric>
+#include <regex>
+
+#include "layer.h"
+#include "xr_d3d12on11_interop.h"
+#include "stub_runtime.h"
+
+// Count the heap allocations of the whole process, which includes the layer (compiled in this executable).
+namespace {
+    std::atomic<uint64_t> g_allocations{0};
+    std::atomic<int64_t> g_heapBytes{0};
+} // namespace
+
+void* operator new(size_t size) {
+    void* const ptr = malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    g_allocations++;
+    g_heapBytes += _msize(ptr);
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr) {
+        g_heapBytes -= _msize(ptr);
+        free(ptr);
+    }
+}
+
+void operator delete(void* ptr, size_t size) noexcept {
+    operator delete(ptr);
+}
+
+extern "C" XrResult XRAPI_CALL xrNegotiateLoaderApiLayerInterface(const XrNegotiateLoaderInfo* const loaderInfo,
+                                                                  const char* const apiLayerName,
+                                                                  XrNegotiateApiLayerRequest* const apiLayerRequest);
+
+namespace {
+
+    using namespace d3d12on11_interop;
+
+    struct Options {
+        uint64_t frames{10000};
+        std::vector<uint32_t> swapchainCounts{1, 4, 16, 64};
+        uint64_t recreateEvery{500};
+        uint64_t restartEvery{2500};
+        uint32_t size{128};
+        bool shareableImages{false};
+        bool useHardware{false};
+        std::string replay;
+        std::string saveBaseline;
+        std::string baseline;
+        double threshold{10};
+    };
+
+    // The application side of the benchmark: a Direct3D 12 application submitting frames through the layer.
+    class Application {
+      public:
+        Application(const Options& options, const XrNegotiateApiLayerRequest& apiLayerRequest) : m_options(options) {
+            // Create the application's device.
+            ComPtr<IDXGIFactory4> dxgiFactory;
+            CHECK_HRCMD(CreateDXGIFactory1(IID_PPV_ARGS(dxgiFactory.ReleaseAndGetAddressOf())));
+            ComPtr<IDXGIAdapter1> dxgiAdapter;
+            if (options.useHardware) {
+                CHECK_HRCMD(dxgiFactory->EnumAdapters1(0, dxgiAdapter.ReleaseAndGetAddressOf()));
+            } else {
+                CHECK_HRCMD(dxgiFactory->EnumWarpAdapter(IID_PPV_ARGS(dxgiAdapter.ReleaseAndGetAddressOf())));
+            }
+            DXGI_ADAPTER_DESC1 adapterDesc;
+            CHECK_HRCMD(dxgiAdapter->GetDesc1(&adapterDesc));
+            CHECK_HRCMD(D3D12CreateDevice(
+                dxgiAdapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(m_device.ReleaseAndGetAddressOf())));
+            D3D12_COMMAND_QUEUE_DESC queueDesc{};
+            queueDesc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
+            CHECK_HRCMD(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(m_queue.ReleaseAndGetAddressOf())));
+
+            stub_runtime::Options runtimeOptions;
+            runtimeOptions.adapterLuid = adapterDesc.AdapterLuid;
+            runtimeOptions.shareableImages = options.shareableImages;
+            stub_runtime::SetOptions(runtimeOptions);
+
+            // Create the instance through the layer, with the stub runtime next in the chain.
+            XrApiLayerNextInfo nextInfo{XR_LOADER_INTERFACE_STRUCT_API_LAYER_NEXT_INFO,
+                                        XR_API_LAYER_NEXT_INFO_STRUCT_VERSION,
+                                        sizeof(XrApiLayerNextInfo)};
+            strncpy_s(nextInfo.layerName, LayerName.c_str(), _TRUNCATE);
+            nextInfo.nextGetInstanceProcAddr = stub_runtime::xrGetInstanceProcAddr;
+            nextInfo.nextCreateApiLayerInstance = stub_runtime::xrCreateApiLayerInstance;
+            XrApiLayerCreateInfo apiLayerInfo{XR_LOADER_INTERFACE_STRUCT_API_LAYER_CREATE_INFO,
+                                              XR_API_LAYER_CREATE_INFO_STRUCT_VERSION,
+                                              sizeof(XrApiLayerCreateInfo)};
+            apiLayerInfo.nextInfo = &nextInfo;
+
+            const char* const extensions[] = {XR_KHR_D3D12_ENABLE_EXTENSION_NAME,
+                                              XR_NOVENDOR_D3D12ON11_STATISTICS_EXTENSION_NAME};
+            XrInstanceCreateInfo createInfo{XR_TYPE_INSTANCE_CREATE_INFO};
+            strncpy_s(createInfo.applicationInfo.applicationName, "benchmark", _TRUNCATE);
+            createInfo.applicationInfo.apiVersion = XR_CURRENT_API_VERSION;
+            createInfo.enabledExtensionCount = (uint32_t)std::size(extensions);
+            createInfo.enabledExtensionNames = extensions;
+            CHECK_XRCMD(apiLayerRequest.createApiLayerInstance(&createInfo, &apiLayerInfo, &m_instance));
+
+            m_xrGetInstanceProcAddr = apiLayerRequest.getInstanceProcAddr;
+            resolve("xrDestroyInstance", xrDestroyInstance);
+            resolve("xrPollEvent", xrPollEvent);
+            resolve("xrGetSystem", xrGetSystem);
+            resolve("xrGetD3D12GraphicsRequirementsKHR", xrGetD3D12GraphicsRequirementsKHR);
+            resolve("xrGetD3D12on11StatisticsNOVENDOR", xrGetD3D12on11StatisticsNOVENDOR);
+            resolve("xrCreateSession", xrCreateSession);
+            resolve("xrDestroySession", xrDestroySession);
+            resolve("xrBeginSession", xrBeginSession);
+            resolve("xrRequestExitSession", xrRequestExitSession);
+            resolve("xrEndSession", xrEndSession);
+            resolve("xrCreateSwapchain", xrCreateSwapchain);
+            resolve("xrDestroySwapchain", xrDestroySwapchain);
+            resolve("xrEnumerateSwapchainImages", xrEnumerateSwapchainImages);
+            resolve("xrAcquireSwapchainImage", xrAcquireSwapchainImage);
+            resolve("xrWaitSwapchainImage", xrWaitSwapchainImage);
+            resolve("xrReleaseSwapchainImage", xrReleaseSwapchainImage);
+            resolve("xrWaitFrame", xrWaitFrame);
+            resolve("xrBeginFrame", xrBeginFrame);
+            resolve("xrEndFrame", xrEndFrame);
+
+            XrSystemGetInfo getInfo{XR_TYPE_SYSTEM_GET_INFO};
+            getInfo.formFactor = XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY;
+            CHECK_XRCMD(xrGetSystem(m_instance, &getInfo, &m_systemId));
+            XrGraphicsRequirementsD3D12KHR requirements{XR_TYPE_GRAPHICS_REQUIREMENTS_D3D12_KHR};
+            CHECK_XRCMD(xrGetD3D12GraphicsRequirementsKHR(m_instance, m_systemId, &requirements));
+        }
+
+        ~Application() {
+            if (m_session != XR_NULL_HANDLE) {
+                xrDestroySession(m_session);
+            }
+            xrDestroyInstance(m_instance);
+        }
+
+        XrResult createSession() {
+            XrGraphicsBindingD3D12KHR d3d12Bindings{XR_TYPE_GRAPHICS_BINDING_D3D12_KHR};
+            d3d12Bindings.device = m_device.Get();
+            d3d12Bindings.queue = m_queue.Get();
+            XrSessionCreateInfo createInfo{XR_TYPE_SESSION_CREATE_INFO, &d3d12Bindings};
+            createInfo.systemId = m_systemId;
+            return xrCreateSession(m_instance, &createInfo, &m_session);
+        }
+
+        XrResult destroySession() {
+            const XrResult result = xrDestroySession(m_session);
+            m_session = XR_NULL_HANDLE;
+            return result;
+        }
+
+        // Begin the session and wait for it to be focused.
+        void startSession() {
+            waitForState(XR_SESSION_STATE_READY);
+            XrSessionBeginInfo beginInfo{XR_TYPE_SESSION_BEGIN_INFO};
+            beginInfo.primaryViewConfigurationType = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+            CHECK_XRCMD(xrBeginSession(m_session, &beginInfo));
+            waitForState(XR_SESSION_STATE_FOCUSED);
+        }
+
+        // Exit the session like upon a request from the runtime.
+        void stopSession() {
+            CHECK_XRCMD(xrRequestExitSession(m_session));
+            waitForState(XR_SESSION_STATE_STOPPING);
+            CHECK_XRCMD(xrEndSession(m_session));
+            waitForState(XR_SESSION_STATE_EXITING);
+
+            // The statistics are accumulated per session.
+            XrD3D12on11StatisticsNOVENDOR statistics{XR_TYPE_D3D12ON11_STATISTICS_NOVENDOR};
+            CHECK_XRCMD(xrGetD3D12on11StatisticsNOVENDOR(m_session, &statistics));
+            m_layerCpuTime += statistics.cpuTime;
+        }
+
+        // Create the session and its swapchains, and wait for the session to be focused.
+        void beginSession(uint32_t swapchainCount) {
+            CHECK_XRCMD(createSession());
+            startSession();
+
+            // The first swapchain is used for a stereo projection layer, the others for quad layers.
+            m_swapchains.resize(swapchainCount, XR_NULL_HANDLE);
+            m_quadLayers.resize(swapchainCount - 1, {XR_TYPE_COMPOSITION_LAYER_QUAD});
+            m_layers.clear();
+            m_layers.push_back(reinterpret_cast<const XrCompositionLayerBaseHeader*>(&m_projectionLayer));
+            for (const auto& quadLayer : m_quadLayers) {
+                m_layers.push_back(reinterpret_cast<const XrCompositionLayerBaseHeader*>(&quadLayer));
+            }
+            for (uint32_t i = 0; i < swapchainCount; i++) {
+                createSwapchain(i);
+            }
+        }
+
+        // Exit the session like upon a request from the runtime, and destroy the session and its swapchains.
+        void endSession() {
+            stopSession();
+            for (const XrSwapchain swapchain : m_swapchains) {
+                CHECK_XRCMD(xrDestroySwapchain(swapchain));
+            }
+            CHECK_XRCMD(destroySession());
+        }
+
+        void recreateSwapchain(uint32_t index) {
+            CHECK_XRCMD(xrDestroySwapchain(m_swapchains[index]));
+            createSwapchain(index);
+        }
+
+        void runFrame() {
+            pollEvents();
+
+            XrFrameWaitInfo waitInfo{XR_TYPE_FRAME_WAIT_INFO};
+            XrFrameState frameState{XR_TYPE_FRAME_STATE};
+            CHECK_XRCMD(xrWaitFrame(m_session, &waitInfo, &frameState));
+            XrFrameBeginInfo beginInfo{XR_TYPE_FRAME_BEGIN_INFO};
+            CHECK_XRCMD(xrBeginFrame(m_session, &beginInfo));
+
+            for (const XrSwapchain swapchain : m_swapchains) {
+                uint32_t index;
+                XrSwapchainImageAcquireInfo acquireInfo{XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
+                CHECK_XRCMD(xrAcquireSwapchainImage(swapchain, &acquireInfo, &index));
+                XrSwapchainImageWaitInfo imageWaitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+                imageWaitInfo.timeout = XR_INFINITE_DURATION;
+                CHECK_XRCMD(xrWaitSwapchainImage(swapchain, &imageWaitInfo));
+                XrSwapchainImageReleaseInfo releaseInfo{XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
+                CHECK_XRCMD(xrReleaseSwapchainImage(swapchain, &releaseInfo));
+            }
+
+            XrFrameEndInfo endInfo{XR_TYPE_FRAME_END_INFO};
+            endInfo.displayTime = frameState.predictedDisplayTime;
+            endInfo.environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
+            endInfo.layerCount = (uint32_t)m_layers.size();
+            endInfo.layers = m_layers.data();
+            CHECK_XRCMD(xrEndFrame(m_session, &endInfo));
+        }
+
+        // The CPU time of the layer in the frame functions, for the sessions ended so far.
+        uint64_t getLayerCpuTime() const {
+            return m_layerCpuTime;
+        }
+
+        XrSession getSession() const {
+            return m_session;
+        }
+
+        template <typename T>
+        void resolve(const char* name, T& function) {
+            CHECK_XRCMD(
+                m_xrGetInstanceProcAddr(m_instance, name, reinterpret_cast<PFN_xrVoidFunction*>(&function)));
+        }
+
+      private:
+
+        void pollEvents() {
+            XrEventDataBuffer event{XR_TYPE_EVENT_DATA_BUFFER};
+            while (xrPollEvent(m_instance, &event) == XR_SUCCESS) {
+                if (event.type == XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED) {
+                    m_sessionState = reinterpret_cast<const XrEventDataSessionStateChanged*>(&event)->state;
+                }
+                event = {XR_TYPE_EVENT_DATA_BUFFER};
+            }
+        }
+
+        void waitForState(XrSessionState state) {
+            pollEvents();
+            if (m_sessionState != state) {
+                throw std::runtime_error(fmt::format("Session state is {} instead of {}",
+                                                     xr::ToCString(m_sessionState),
+                                                     xr::ToCString(state)));
+            }
+        }
+
+        void createSwapchain(uint32_t index) {
+            const bool isProjection = index == 0;
+            XrSwapchainCreateInfo createInfo{XR_TYPE_SWAPCHAIN_CREATE_INFO};
+            createInfo.usageFlags = XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT | XR_SWAPCHAIN_USAGE_SAMPLED_BIT;
+            createInfo.format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+            createInfo.sampleCount = 1;
+            createInfo.width = createInfo.height = m_options.size;
+            createInfo.faceCount = 1;
+            createInfo.arraySize = isProjection ? 2 : 1;
+            createInfo.mipCount = 1;
+            CHECK_XRCMD(xrCreateSwapchain(m_session, &createInfo, &m_swapchains[index]));
+
+            uint32_t imageCount = 0;
+            CHECK_XRCMD(xrEnumerateSwapchainImages(m_swapchains[index], 0, &imageCount, nullptr));
+            std::vector<XrSwapchainImageD3D12KHR> images(imageCount, {XR_TYPE_SWAPCHAIN_IMAGE_D3D12_KHR});
+            CHECK_XRCMD(xrEnumerateSwapchainImages(m_swapchains[index],
+                                                   imageCount,
+                                                   &imageCount,
+                                                   reinterpret_cast<XrSwapchainImageBaseHeader*>(images.data())));
+
+            XrSwapchainSubImage subImage{};
+            subImage.swapchain = m_swapchains[index];
+            subImage.imageRect.extent.width = subImage.imageRect.extent.height = m_options.size;
+            if (isProjection) {
+                m_projectionLayer.viewCount = (uint32_t)std::size(m_projectionViews);
+                m_projectionLayer.views = m_projectionViews;
+                for (uint32_t eye = 0; eye < std::size(m_projectionViews); eye++) {
+                    m_projectionViews[eye].subImage = subImage;
+                    m_projectionViews[eye].subImage.imageArrayIndex = eye;
+                }
+            } else {
+                m_quadLayers[index - 1].eyeVisibility = XR_EYE_VISIBILITY_BOTH;
+                m_quadLayers[index - 1].subImage = subImage;
+                m_quadLayers[index - 1].size = {1.f, 1.f};
+            }
+        }
+
+        const Options& m_options;
+        ComPtr<ID3D12Device> m_device;
+        ComPtr<ID3D12CommandQueue> m_queue;
+
+        XrInstance m_instance{XR_NULL_HANDLE};
+        XrSystemId m_systemId{XR_NULL_SYSTEM_ID};
+        XrSession m_session{XR_NULL_HANDLE};
+        XrSessionState m_sessionState{XR_SESSION_STATE_UNKNOWN};
+        std::vector<XrSwapchain> m_swapchains;
+        uint64_t m_layerCpuTime{0};
+
+        XrCompositionLayerProjectionView m_projectionViews[2]{{XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW},
+                                                              {XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW}};
+        XrCompositionLayerProjection m_projectionLayer{XR_TYPE_COMPOSITION_LAYER_PROJECTION};
+        std::vector<XrCompositionLayerQuad> m_quadLayers;
+        std::vector<const XrCompositionLayerBaseHeader*> m_layers;
+
+        PFN_xrGetInstanceProcAddr m_xrGetInstanceProcAddr{nullptr};
+        PFN_xrDestroyInstance xrDestroyInstance{nullptr};
+        PFN_xrPollEvent xrPollEvent{nullptr};
+        PFN_xrGetSystem xrGetSystem{nullptr};
+        PFN_xrGetD3D12GraphicsRequirementsKHR xrGetD3D12GraphicsRequirementsKHR{nullptr};
+        PFN_xrGetD3D12on11StatisticsNOVENDOR xrGetD3D12on11StatisticsNOVENDOR{nullptr};
+        PFN_xrCreateSession xrCreateSession{nullptr};
+        PFN_xrDestroySession xrDestroySession{nullptr};
+        PFN_xrBeginSession xrBeginSession{nullptr};
+        PFN_xrRequestExitSession xrRequestExitSession{nullptr};
+        PFN_xrEndSession xrEndSession{nullptr};
+        PFN_xrCreateSwapchain xrCreateSwapchain{nullptr};
+        PFN_xrDestroySwapchain xrDestroySwapchain{nullptr};
+        PFN_xrEnumerateSwapchainImages xrEnumerateSwapchainImages{nullptr};
+        PFN_xrAcquireSwapchainImage xrAcquireSwapchainImage{nullptr};
+        PFN_xrWaitSwapchainImage xrWaitSwapchainImage{nullptr};
+        PFN_xrReleaseSwapchainImage xrReleaseSwapchainImage{nullptr};
+        PFN_xrWaitFrame xrWaitFrame{nullptr};
+        PFN_xrBeginFrame xrBeginFrame{nullptr};
+        PFN_xrEndFrame xrEndFrame{nullptr};
+    };
+
+    // Run one scenario and add its metrics to the report.
+    void runScenario(const Options& options,
+                     const XrNegotiateApiLayerRequest& apiLayerRequest,
+                     uint32_t swapchainCount,
+                     std::map<std::string, double>& metrics) {
+        Application application(options, apiLayerRequest);
+
+        const int64_t startHeapBytes = g_heapBytes;
+        const uint64_t startAllocations = g_allocations;
+        const auto startTime = std::chrono::steady_clock::now();
+
+        application.beginSession(swapchainCount);
+        for (uint64_t frame = 1; frame <= options.frames; frame++) {
+            application.runFrame();
+
+            if (frame == options.frames) {
+                break;
+            }
+            if (options.restartEvery && frame % options.restartEvery == 0) {
+                application.endSession();
+                application.beginSession(swapchainCount);
+            } else if (options.recreateEvery && frame % options.recreateEvery == 0) {
+                application.recreateSwapchain((uint32_t)((frame / options.recreateEvery) % swapchainCount));
+            }
+        }
+
+        // The memory still held by the layer for the session, its swapchains and the retired resources.
+        const int64_t heapBytes = g_heapBytes - startHeapBytes;
+        application.endSession();
+
+        const double wallTime =
+            std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+        const double frames = (double)options.frames;
+        if (stub_runtime::GetSubmittedFrames() != options.frames) {
+            throw std::runtime_error(fmt::format(
+                "The runtime received {} frames instead of {}", stub_runtime::GetSubmittedFrames(), options.frames));
+        }
+
+        const std::string prefix = fmt::format("{} swapchains ", swapchainCount);
+        metrics[prefix + "layer cpu ns per frame"] = application.getLayerCpuTime() / frames;
+        metrics[prefix + "allocations per frame"] = (g_allocations - startAllocations) / frames;
+        metrics[prefix + "heap bytes"] = (double)heapBytes;
+
+        printf("%10u %10llu %16.0f %14.2f %12lld %12.1f\n",
+               swapchainCount,
+               (unsigned long long)options.frames,
+               metrics[prefix + "layer cpu ns per frame"],
+               metrics[prefix + "allocations per frame"],
+               (long long)heapBytes,
+               wallTime / frames);
+    }
+
+    // Reads the values stored in a capture (see scripts/capture_report.py for the format).
+    class CaptureReader {
+      public:
+        CaptureReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {
+        }
+
+        template <typename T>
+        T read() {
+            T value;
+            memcpy(&value, get(sizeof(value)), sizeof(value));
+            return value;
+        }
+
+        const uint8_t* get(size_t size) {
+            if (m_size - m_offset < size) {
+                throw std::out_of_range("Truncated capture");
+            }
+            const uint8_t* const data = m_data + m_offset;
+            m_offset += size;
+            return data;
+        }
+
+        bool startsWith(const void* data, size_t size) const {
+            return m_size - m_offset >= size && !memcmp(m_data + m_offset, data, size);
+        }
+
+        bool isEmpty() const {
+            return m_offset == m_size;
+        }
+
+      private:
+        const uint8_t* const m_data;
+        const size_t m_size;
+        size_t m_offset{0};
+    };
+
+    struct CapturedCall {
+        std::string apiName;
+        XrResult result;
+        std::vector<uint8_t> payload;
+    };
+
+    // Read the calls from a capture file, grouped by capture (the file is appended to by each run of an application).
+    std::vector<std::vector<CapturedCall>> ReadCapture(const std::string& path) {
+        std::ifstream file(path, std::ios_base::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error(fmt::format("Cannot open {}", path));
+        }
+        const std::vector<uint8_t> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        constexpr char Magic[8] = {'X', 'R', 'C', 'A', 'P', 'T', 'U', 'R'};
+        std::vector<std::vector<CapturedCall>> captures;
+        std::map<uint16_t, std::string> apiNames;
+        uint32_t version = 0;
+        CaptureReader reader(contents.data(), contents.size());
+        try {
+            while (!reader.isEmpty()) {
+                if (reader.startsWith(Magic, sizeof(Magic))) {
+                    reader.get(sizeof(Magic));
+                    version = reader.read<uint32_t>();
+                    if (version < 1 || version > 2) {
+                        throw std::runtime_error(fmt::format("Unsupported capture version {}", version));
+                    }
+                    reader.get(sizeof(uint32_t) + sizeof(int64_t));
+                    captures.emplace_back();
+                    apiNames.clear();
+                    continue;
+                }
+                if (captures.empty()) {
+                    throw std::runtime_error(fmt::format("{} is not a capture", path));
+                }
+
+                const auto tag = reader.read<uint8_t>();
+                if (tag == 'N') {
+                    const auto apiId = reader.read<uint16_t>();
+                    const auto length = reader.read<uint16_t>();
+                    apiNames[apiId] = std::string(reinterpret_cast<const char*>(reader.get(length)), length);
+                } else if (tag == 'C') {
+                    CapturedCall call;
+                    call.apiName = apiNames[reader.read<uint16_t>()];
+                    reader.read<uint32_t>();
+                    call.result = (XrResult)reader.read<int32_t>();
+                    // The timestamps are not needed for the replay.
+                    reader.get(sizeof(int64_t) * (version > 1 ? 3 : 2));
+                    const auto payloadSize = reader.read<uint32_t>();
+                    const uint8_t* const payload = reader.get(payloadSize);
+                    call.payload.assign(payload, payload + payloadSize);
+                    captures.back().push_back(std::move(call));
+                } else {
+                    break;
+                }
+            }
+        } catch (std::out_of_range&) {
+            // A truncated record (the application was terminated during a write).
+        }
+        return captures;
+    }
+
+    // Replays the calls from a capture through the layer, and measures the latency of each call. The captured handles
+    // are mapped to the replayed ones, and the calls that cannot be replayed are skipped: the calls that failed in the
+    // capture, the calls on unknown handles, and the calls that are not intercepted by the layer. The layer does not
+    // intercept xrBeginSession() and xrBeginFrame(), and they are therefore not captured: the session is begun after
+    // xrCreateSession() and ended before xrDestroySession(), and each frame is begun after xrWaitFrame().
+    class CaptureReplay {
+      public:
+        CaptureReplay(Application& application) : m_application(application) {
+            application.resolve("xrCreateSwapchain", xrCreateSwapchain);
+            application.resolve("xrDestroySwapchain", xrDestroySwapchain);
+            application.resolve("xrEnumerateSwapchainImages", xrEnumerateSwapchainImages);
+            application.resolve("xrAcquireSwapchainImage", xrAcquireSwapchainImage);
+            application.resolve("xrWaitSwapchainImage", xrWaitSwapchainImage);
+            application.resolve("xrReleaseSwapchainImage", xrReleaseSwapchainImage);
+            application.resolve("xrWaitFrame", xrWaitFrame);
+            application.resolve("xrBeginFrame", xrBeginFrame);
+            application.resolve("xrEndFrame", xrEndFrame);
+        }
+
+        void replay(const CapturedCall& call) {
+            if (XR_FAILED(call.result)) {
+                m_skippedCalls++;
+                return;
+            }
+
+            CaptureReader payload(call.payload.data(), call.payload.size());
+            bool replayed = false;
+            if (call.apiName == "xrCreateSession") {
+                replayed = replayCreateSession(payload);
+            } else if (call.apiName == "xrDestroySession") {
+                replayed = replayDestroySession(payload);
+            } else if (call.apiName == "xrCreateSwapchain") {
+                replayed = replayCreateSwapchain(payload);
+            } else if (call.apiName == "xrDestroySwapchain") {
+                replayed = replayDestroySwapchain(payload);
+            } else if (call.apiName == "xrEnumerateSwapchainImages") {
+                replayed = replayEnumerateSwapchainImages(payload);
+            } else if (call.apiName == "xrAcquireSwapchainImage") {
+                replayed = replaySwapchainImageCall(payload, call.apiName, [&](XrSwapchain swapchain) {
+                    XrSwapchainImageAcquireInfo acquireInfo{XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
+                    uint32_t index;
+                    return xrAcquireSwapchainImage(swapchain, &acquireInfo, &index);
+                });
+            } else if (call.apiName == "xrWaitSwapchainImage") {
+                replayed = replaySwapchainImageCall(payload, call.apiName, [&](XrSwapchain swapchain) {
+                    XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+                    waitInfo.timeout = XR_INFINITE_DURATION;
+                    return xrWaitSwapchainImage(swapchain, &waitInfo);
+                });
+            } else if (call.apiName == "xrReleaseSwapchainImage") {
+                replayed = replaySwapchainImageCall(payload, call.apiName, [&](XrSwapchain swapchain) {
+                    XrSwapchainImageReleaseInfo releaseInfo{XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
+                    return xrReleaseSwapchainImage(swapchain, &releaseInfo);
+                });
+            } else if (call.apiName == "xrWaitFrame") {
+                replayed = replayWaitFrame(payload);
+            } else if (call.apiName == "xrEndFrame") {
+                replayed = replayEndFrame(payload);
+            }
+            if (!replayed) {
+                m_skippedCalls++;
+            }
+        }
+
+        // Destroy the swapchains and the session left by the capture.
+        void finish() {
+            destroySwapchains();
+            if (m_application.getSession() != XR_NULL_HANDLE) {
+                m_application.stopSession();
+                CHECK_XRCMD(m_application.destroySession());
+            }
+        }
+
+        // The latencies of the replayed calls (in microseconds), by API.
+        std::map<std::string, std::vector<double>>& getLatencies() {
+            return m_latencies;
+        }
+
+        uint64_t getSkippedCalls() const {
+            return m_skippedCalls;
+        }
+
+        uint64_t getFailedCalls() const {
+            return m_failedCalls;
+        }
+
+      private:
+        template <typename Function>
+        XrResult measure(const std::string& apiName, Function function) {
+            const auto startTime = std::chrono::steady_clock::now();
+            const XrResult result = function();
+            const double latency =
+                std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+            if (XR_SUCCEEDED(result)) {
+                m_latencies[apiName].push_back(latency);
+            } else {
+                m_failedCalls++;
+            }
+            return result;
+        }
+
+        bool replayCreateSession(CaptureReader& payload) {
+            if (m_application.getSession() != XR_NULL_HANDLE) {
+                return false;
+            }
+            payload.read<uint64_t>();
+            payload.read<uint8_t>();
+            const auto capturedSession = payload.read<uint64_t>();
+
+            if (XR_SUCCEEDED(measure("xrCreateSession", [&]() { return m_application.createSession(); }))) {
+                m_capturedSession = capturedSession;
+                m_application.startSession();
+            }
+            return true;
+        }
+
+        bool replayDestroySession(CaptureReader& payload) {
+            if (!isCapturedSession(payload.read<uint64_t>())) {
+                return false;
+            }
+
+            destroySwapchains();
+            m_application.stopSession();
+            measure("xrDestroySession", [&]() { return m_application.destroySession(); });
+            return true;
+        }
+
+        bool replayCreateSwapchain(CaptureReader& payload) {
+            if (!isCapturedSession(payload.read<uint64_t>()) || !payload.read<uint8_t>()) {
+                return false;
+            }
+            XrSwapchainCreateInfo createInfo{XR_TYPE_SWAPCHAIN_CREATE_INFO};
+            createInfo.createFlags = payload.read<XrSwapchainCreateFlags>();
+            createInfo.usageFlags = payload.read<XrSwapchainUsageFlags>();
+            createInfo.format = payload.read<int64_t>();
+            createInfo.sampleCount = payload.read<uint32_t>();
+            createInfo.width = payload.read<uint32_t>();
+            createInfo.height = payload.read<uint32_t>();
+            createInfo.faceCount = payload.read<uint32_t>();
+            createInfo.arraySize = payload.read<uint32_t>();
+            createInfo.mipCount = payload.read<uint32_t>();
+            const auto capturedSwapchain = payload.read<uint64_t>();
+
+            XrSwapchain swapchain;
+            if (XR_SUCCEEDED(measure("xrCreateSwapchain", [&]() {
+                    return xrCreateSwapchain(m_application.getSession(), &createInfo, &swapchain);
+                }))) {
+                m_swapchains.insert_or_assign(capturedSwapchain, swapchain);
+            }
+            return true;
+        }
+
+        bool replayDestroySwapchain(CaptureReader& payload) {
+            const auto it = m_swapchains.find(payload.read<uint64_t>());
+            if (it == m_swapchains.cend()) {
+                return false;
+            }
+
+            measure("xrDestroySwapchain", [&]() { return xrDestroySwapchain(it->second); });
+            m_swapchains.erase(it);
+            return true;
+        }
+
+        bool replayEnumerateSwapchainImages(CaptureReader& payload) {
+            const XrSwapchain swapchain = getSwapchain(payload.read<uint64_t>());
+            if (swapchain == XR_NULL_HANDLE) {
+                return false;
+            }
+            const auto capacity = payload.read<uint32_t>();
+
+            std::vector<XrSwapchainImageD3D12KHR> images(capacity, {XR_TYPE_SWAPCHAIN_IMAGE_D3D12_KHR});
+            uint32_t count;
+            measure("xrEnumerateSwapchainImages", [&]() {
+                return xrEnumerateSwapchainImages(swapchain,
+                                                  capacity,
+                                                  &count,
+                                                  capacity
+                                                      ? reinterpret_cast<XrSwapchainImageBaseHeader*>(images.data())
+                                                      : nullptr);
+            });
+            return true;
+        }
+
+        template <typename Function>
+        bool replaySwapchainImageCall(CaptureReader& payload, const std::string& apiName, Function function) {
+            const XrSwapchain swapchain = getSwapchain(payload.read<uint64_t>());
+            if (swapchain == XR_NULL_HANDLE) {
+                return false;
+            }
+
+            measure(apiName, [&]() { return function(swapchain); });
+            return true;
+        }
+
+        bool replayWaitFrame(CaptureReader& payload) {
+            if (!isCapturedSession(payload.read<uint64_t>())) {
+                return false;
+            }
+
+            XrFrameWaitInfo waitInfo{XR_TYPE_FRAME_WAIT_INFO};
+            XrFrameState frameState{XR_TYPE_FRAME_STATE};
+            if (XR_SUCCEEDED(measure("xrWaitFrame", [&]() {
+                    return xrWaitFrame(m_application.getSession(), &waitInfo, &frameState);
+                }))) {
+                m_displayTime = frameState.predictedDisplayTime;
+                XrFrameBeginInfo beginInfo{XR_TYPE_FRAME_BEGIN_INFO};
+                CHECK_XRCMD(xrBeginFrame(m_application.getSession(), &beginInfo));
+            }
+            return true;
+        }
+
+        bool replayEndFrame(CaptureReader& payload) {
+            if (!isCapturedSession(payload.read<uint64_t>()) || !payload.read<uint8_t>()) {
+                return false;
+            }
+            XrFrameEndInfo endInfo{XR_TYPE_FRAME_END_INFO};
+            payload.read<XrTime>();
+            endInfo.displayTime = m_displayTime;
+            endInfo.environmentBlendMode = payload.read<XrEnvironmentBlendMode>();
+            const auto layerCount = payload.read<uint32_t>();
+
+            const auto readSubImage = [&](XrSwapchainSubImage& subImage) {
+                subImage.swapchain = getSwapchain(payload.read<uint64_t>());
+                subImage.imageRect.offset.x = payload.read<int32_t>();
+                subImage.imageRect.offset.y = payload.read<int32_t>();
+                subImage.imageRect.extent.width = payload.read<int32_t>();
+                subImage.imageRect.extent.height = payload.read<int32_t>();
+                subImage.imageArrayIndex = payload.read<uint32_t>();
+                return subImage.swapchain != XR_NULL_HANDLE;
+            };
+
+            // The layers referencing unknown swapchains, and the types of layers without details in the capture, are
+            // not submitted.
+            m_projectionLayers.clear();
+            m_projectionViews.clear();
+            m_quadLayers.clear();
+            m_layers.clear();
+            for (uint32_t i = 0; i < layerCount; i++) {
+                const auto type = payload.read<XrStructureType>();
+                const auto layerFlags = payload.read<XrCompositionLayerFlags>();
+                payload.read<uint64_t>();
+
+                if (type == XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
+                    auto& projection = m_projectionLayers.emplace_back(XrCompositionLayerProjection{type});
+                    projection.layerFlags = layerFlags;
+                    projection.viewCount = payload.read<uint32_t>();
+                    auto& views = m_projectionViews.emplace_back(
+                        projection.viewCount,
+                        XrCompositionLayerProjectionView{XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW});
+                    bool isValid = true;
+                    for (auto& view : views) {
+                        isValid = readSubImage(view.subImage) && isValid;
+                    }
+                    projection.views = views.data();
+                    if (isValid) {
+                        m_layers.push_back(reinterpret_cast<const XrCompositionLayerBaseHeader*>(&projection));
+                    }
+                } else if (type == XR_TYPE_COMPOSITION_LAYER_QUAD) {
+                    auto& quad = m_quadLayers.emplace_back(XrCompositionLayerQuad{type});
+                    quad.layerFlags = layerFlags;
+                    quad.eyeVisibility = payload.read<XrEyeVisibility>();
+                    const bool isValid = readSubImage(quad.subImage);
+                    quad.size.width = payload.read<float>();
+                    quad.size.height = payload.read<float>();
+                    if (isValid) {
+                        m_layers.push_back(reinterpret_cast<const XrCompositionLayerBaseHeader*>(&quad));
+                    }
+                }
+            }
+            endInfo.layerCount = (uint32_t)m_layers.size();
+            endInfo.layers = m_layers.data();
+
+            measure("xrEndFrame", [&]() { return xrEndFrame(m_application.getSession(), &endInfo); });
+            return true;
+        }
+
+        // Destroy the swapchains that the application did not destroy before its session.
+        void destroySwapchains() {
+            for (const auto& [capturedSwapchain, swapchain] : m_swapchains) {
+                CHECK_XRCMD(xrDestroySwapchain(swapchain));
+            }
+            m_swapchains.clear();
+        }
+
+        bool isCapturedSession(uint64_t capturedSession) const {
+            return m_application.getSession() != XR_NULL_HANDLE && capturedSession == m_capturedSession;
+        }
+
+        XrSwapchain getSwapchain(uint64_t capturedSwapchain) const {
+            const auto it = m_swapchains.find(capturedSwapchain);
+            return it != m_swapchains.cend() ? it->second : XR_NULL_HANDLE;
+        }
+
+        Application& m_application;
+        uint64_t m_capturedSession{0};
+        std::map<uint64_t, XrSwapchain> m_swapchains;
+        XrTime m_displayTime{0};
+
+        // The deques keep the layers and their views at stable addresses while the frame is built.
+        std::deque<std::vector<XrCompositionLayerProjectionView>> m_projectionViews;
+        std::deque<XrCompositionLayerProjection> m_projectionLayers;
+        std::deque<XrCompositionLayerQuad> m_quadLayers;
+        std::vector<const XrCompositionLayerBaseHeader*> m_layers;
+
+        std::map<std::string, std::vector<double>> m_latencies;
+        uint64_t m_skippedCalls{0};
+        uint64_t m_failedCalls{0};
+
+        PFN_xrCreateSwapchain xrCreateSwapchain{nullptr};
+        PFN_xrDestroySwapchain xrDestroySwapchain{nullptr};
+        PFN_xrEnumerateSwapchainImages xrEnumerateSwapchainImages{nullptr};
+        PFN_xrAcquireSwapchainImage xrAcquireSwapchainImage{nullptr};
+        PFN_xrWaitSwapchainImage xrWaitSwapchainImage{nullptr};
+        PFN_xrReleaseSwapchainImage xrReleaseSwapchainImage{nullptr};
+        PFN_xrWaitFrame xrWaitFrame{nullptr};
+        PFN_xrBeginFrame xrBeginFrame{nullptr};
+        PFN_xrEndFrame xrEndFrame{nullptr};
+    };
+
+    double Percentile(const std::vector<double>& sortedValues, double p) {
+        const size_t index = (size_t)std::round(p / 100 * (sortedValues.size() - 1));
+        return sortedValues[(std::min)(index, sortedValues.size() - 1)];
+    }
+
+    // Replay a capture and add the latency of each call to the report.
+    void runReplay(const Options& options,
+                   const XrNegotiateApiLayerRequest& apiLayerRequest,
+                   std::map<std::string, double>& metrics) {
+        std::map<std::string, std::vector<double>> latencies;
+        uint64_t skippedCalls = 0;
+        uint64_t failedCalls = 0;
+        for (const auto& calls : ReadCapture(options.replay)) {
+            Application application(options, apiLayerRequest);
+            CaptureReplay replay(application);
+            for (const auto& call : calls) {
+                replay.replay(call);
+            }
+            replay.finish();
+
+            for (auto& [apiName, values] : replay.getLatencies()) {
+                auto& allValues = latencies[apiName];
+                allValues.insert(allValues.end(), values.cbegin(), values.cend());
+            }
+            skippedCalls += replay.getSkippedCalls();
+            failedCalls += replay.getFailedCalls();
+        }
+
+        printf("%-32s %8s %10s %10s %10s %10s %10s  (us)\n", "API", "count", "mean", "p50", "p90", "p99", "max");
+        uint64_t replayedCalls = 0;
+        for (auto& [apiName, values] : latencies) {
+            std::sort(values.begin(), values.end());
+            const double mean = std::accumulate(values.cbegin(), values.cend(), 0.0) / values.size();
+            printf("%-32s %8zu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                   apiName.c_str(),
+                   values.size(),
+                   mean,
+                   Percentile(values, 50),
+                   Percentile(values, 90),
+                   Percentile(values, 99),
+                   values.back());
+            // The calls made only a few times (such as the creation of the swapchains) are too noisy to compare.
+            if (values.size() >= 100) {
+                metrics[apiName + " mean us"] = mean;
+                metrics[apiName + " p99 us"] = Percentile(values, 99);
+            }
+            replayedCalls += values.size();
+        }
+        printf("%llu calls replayed, %llu skipped, %llu failed\n",
+               (unsigned long long)replayedCalls,
+               (unsigned long long)skippedCalls,
+               (unsigned long long)failedCalls);
+    }
+
+    std::map<std::string, double> loadBaseline(const std::string& path) {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            throw std::runtime_error(fmt::format("Cannot open {}", path));
+        }
+        const std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        // The baseline is a flat JSON object of metric names to values.
+        std::map<std::string, double> baseline;
+        const std::regex entry("\"([^\"]+)\"\\s*:\\s*([-+0-9.eE]+)");
+        for (auto it = std::sregex_iterator(contents.begin(), contents.end(), entry); it != std::sregex_iterator();
+             ++it) {
+            baseline[(*it)[1].str()] = std::stod((*it)[2].str());
+        }
+        return baseline;
+    }
+
+    void saveBaseline(const std::string& path, const std::map<std::string, double>& metrics) {
+        std::ofstream file(path);
+        file << "{\n";
+        for (auto it = metrics.cbegin(); it != metrics.cend(); ++it) {
+            const char* const separator = std::next(it) != metrics.cend() ? "," : "";
+            file << fmt::format("  \"{}\": {:.3f}{}\n", it->first, it->second, separator);
+        }
+        file << "}\n";
+    }
+
+    // Print the metrics that regressed compared to the baseline, and return their count.
+    int compare(const std::map<std::string, double>& metrics,
+                const std::map<std::string, double>& baseline,
+                double threshold) {
+        int regressions = 0;
+        for (const auto& [name, reference] : baseline) {
+            const auto it = metrics.find(name);
+            if (it == metrics.cend()) {
+                continue;
+            }
+            // Ignore the differences below one unit (nanosecond, allocation or byte).
+            const double value = it->second;
+            if (value > reference * (1 + threshold / 100) && value - reference >= 1) {
+                printf("REGRESSION: %s: %.1f (baseline %.1f, +%.0f%%)\n",
+                       name.c_str(),
+                       value,
+                       reference,
+                       reference ? (value / reference - 1) * 100 : 100.0);
+                regressions++;
+            }
+        }
+        return regressions;
+    }
+
+    Options parseOptions(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; i++) {
+            const std::string_view arg(argv[i]);
+            const auto value = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::runtime_error(fmt::format("Missing value for {}", arg));
+                }
+                return argv[++i];
+            };
+
+            if (arg == "--frames") {
+                options.frames = std::stoull(value());
+            } else if (arg == "--swapchains") {
+                options.swapchainCounts.clear();
+                std::stringstream list(value());
+                std::string count;
+                while (std::getline(list, count, ',')) {
+                    options.swapchainCounts.push_back(std::clamp((uint32_t)std::stoul(count), 1u, 64u));
+                }
+            } else if (arg == "--recreate-every") {
+                options.recreateEvery = std::stoull(value());
+            } else if (arg == "--restart-every") {
+                options.restartEvery = std::stoull(value());
+            } else if (arg == "--size") {
+                options.size = std::stoul(value());
+            } else if (arg == "--shareable") {
+                options.shareableImages = true;
+            } else if (arg == "--hardware") {
+                options.useHardware = true;
+            } else if (arg == "--replay") {
+                options.replay = value();
+            } else if (arg == "--save-baseline") {
+                options.saveBaseline = value();
+            } else if (arg == "--baseline") {
+                options.baseline = value();
+            } else if (arg == "--threshold") {
+                options.threshold = std::stod(value());
+            } else {
+                throw std::runtime_error(fmt::format("Unknown option {}", arg));
+            }
+        }
+        return options;
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        const Options options = parseOptions(argc, argv);
+
+        // Load the layer like the loader does.
+        XrNegotiateLoaderInfo loaderInfo{XR_LOADER_INTERFACE_STRUCT_LOADER_INFO,
+                                         XR_LOADER_INFO_STRUCT_VERSION,
+                                         sizeof(XrNegotiateLoaderInfo)};
+        loaderInfo.minInterfaceVersion = loaderInfo.maxInterfaceVersion = XR_CURRENT_LOADER_API_LAYER_VERSION;
+        loaderInfo.minApiVersion = loaderInfo.maxApiVersion = XR_CURRENT_API_VERSION;
+        XrNegotiateApiLayerRequest apiLayerRequest{XR_LOADER_INTERFACE_STRUCT_API_LAYER_REQUEST,
+                                                   XR_API_LAYER_INFO_STRUCT_VERSION,
+                                                   sizeof(XrNegotiateApiLayerRequest)};
+        CHECK_XRCMD(xrNegotiateLoaderApiLayerInterface(&loaderInfo, LayerName.c_str(), &apiLayerRequest));
+
+        std::map<std::string, double> metrics;
+        if (!options.replay.empty()) {
+            runReplay(options, apiLayerRequest, metrics);
+        } else {
+            printf("%10s %10s %16s %14s %12s %12s\n",
+                   "swapchains",
+                   "frames",
+                   "layer CPU ns/fr",
+                   "allocs/frame",
+                   "heap bytes",
+                   "wall us/fr");
+            for (const uint32_t swapchainCount : options.swapchainCounts) {
+                runScenario(options, apiLayerRequest, swapchainCount, metrics);
+            }
+        }
+
+        if (!options.saveBaseline.empty()) {
+            saveBaseline(options.saveBaseline, metrics);
+        }
+
+        if (!options.baseline.empty()) {
+            if (compare(metrics, loadBaseline(options.baseline), options.threshold)) {
+                return 1;
+            }
+            printf("No regression against the baseline\n");
+        }
+    } catch (std::exception& exc) {
+        fprintf(stderr, "%s\n", exc.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,139 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Unit tests for the subresource copy planning. These do not need a D3D device and run as a plain console program.
+
+#include "pch.h"
+
+#include "copy_engine.h"
+
+namespace {
+
+    using namespace d3d12on11_interop;
+
+    int g_failures = 0;
+
+#define CHECK(expr)                                                                                                    \
+    do {                                                                                                               \
+        if (!(expr)) {                                                                                                 \
+            std::cerr << __FILE__ << "(" << __LINE__ << "): check failed: " #expr << std::endl;                        \
+            g_failures++;                                                                                              \
+        }                                                                                                              \
+    } while (0)
+
+    XrSwapchainCreateInfo makeCreateInfo(
+        uint32_t width, uint32_t height, uint32_t arraySize, uint32_t mipCount, uint32_t faceCount = 1) {
+        XrSwapchainCreateInfo createInfo{XR_TYPE_SWAPCHAIN_CREATE_INFO};
+        createInfo.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        createInfo.sampleCount = 1;
+        createInfo.width = width;
+        createInfo.height = height;
+        createInfo.arraySize = arraySize;
+        createInfo.mipCount = mipCount;
+        createInfo.faceCount = faceCount;
+        return createInfo;
+    }
+
+    D3D11_TEXTURE2D_DESC makeDesc(UINT width, UINT height, UINT arraySize, UINT mipLevels) {
+        D3D11_TEXTURE2D_DESC desc{};
+        desc.Width = width;
+        desc.Height = height;
+        desc.ArraySize = arraySize;
+        desc.MipLevels = mipLevels;
+        desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        desc.SampleDesc.Count = 1;
+        return desc;
+    }
+
+    void testMips() {
+        const auto copies = ComputeSubresourceCopies(1, 3, 3, 3);
+        CHECK((copies == std::vector<SubresourceCopy>{{0, 0}, {1, 1}, {2, 2}}));
+    }
+
+    void testArray() {
+        const auto copies = ComputeSubresourceCopies(2, 1, 1, 1);
+        CHECK((copies == std::vector<SubresourceCopy>{{0, 0}, {1, 1}}));
+    }
+
+    void testArrayWithMips() {
+        const auto copies = ComputeSubresourceCopies(2, 2, 2, 2);
+        CHECK((copies == std::vector<SubresourceCopy>{{0, 0}, {1, 1}, {2, 2}, {3, 3}}));
+    }
+
+    void testCube() {
+        const auto copies = ComputeSubresourceCopies(6, 2, 2, 2);
+        CHECK(copies.size() == 12);
+        CHECK((copies.back() == SubresourceCopy{11, 11}));
+
+        // The faces are folded into the array size.
+        const D3D11CopyEngine engine(
+            makeCreateInfo(256, 256, 1, 1, 6), makeDesc(512, 512, 6, 1), makeDesc(256, 256, 6, 1));
+        CHECK(!engine.isWholeResource());
+        CHECK((engine.getCopies() == std::vector<SubresourceCopy>{{0, 0}, {1, 1}, {2, 2}, {3, 3}, {4, 4}, {5, 5}}));
+    }
+
+    void testMismatchedMips() {
+        // The destination has more mip levels than the source: the slice stride differs on each side.
+        auto copies = ComputeSubresourceCopies(2, 1, 4, 1);
+        CHECK((copies == std::vector<SubresourceCopy>{{0, 0}, {4, 1}}));
+
+        // Only the mip levels present on both sides are copied.
+        copies = ComputeSubresourceCopies(1, 3, 3, 1);
+        CHECK((copies == std::vector<SubresourceCopy>{{0, 0}}));
+
+        copies = ComputeSubresourceCopies(2, 2, 3, 2);
+        CHECK((copies == std::vector<SubresourceCopy>{{0, 0}, {1, 1}, {3, 2}, {4, 3}}));
+    }
+
+    void testWholeResource() {
+        const D3D11CopyEngine engine(
+            makeCreateInfo(256, 256, 2, 3), makeDesc(256, 256, 2, 3), makeDesc(256, 256, 2, 3));
+        CHECK(engine.isWholeResource());
+        CHECK(engine.getCopies().empty());
+    }
+
+    void testLargerRuntimeTexture() {
+        // The runtime allocated a larger texture with more slices than requested: only the app's slices are copied.
+        const D3D11CopyEngine engine(
+            makeCreateInfo(256, 256, 1, 1), makeDesc(512, 256, 2, 1), makeDesc(256, 256, 1, 1));
+        CHECK(!engine.isWholeResource());
+        CHECK((engine.getCopies() == std::vector<SubresourceCopy>{{0, 0}}));
+    }
+
+} // namespace
+
+int main() {
+    testMips();
+    testArray();
+    testArrayWithMips();
+    testCube();
+    testMismatchedMips();
+    testWholeResource();
+    testLargerRuntimeTexture();
+
+    if (g_failures) {
+        std::cerr << g_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All tests passed" << std::endl;
+    return 0;
+}
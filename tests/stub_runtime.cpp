@@ -0,0 +1,440 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pch.h"
+
+#include "stub_runtime.h"
+
+namespace {
+
+    using namespace stub_runtime;
+
+    struct Session {
+        ComPtr<ID3D11Device> device;
+        bool isRunning{false};
+    };
+
+    struct Swapchain {
+        XrSession session{XR_NULL_HANDLE};
+        std::vector<ComPtr<ID3D11Texture2D>> images;
+        uint32_t nextIndex{0};
+        uint32_t acquiredCount{0};
+        bool isWaited{false};
+        bool hasReleasedImage{false};
+    };
+
+    Options g_options;
+    uint64_t g_lastHandle = 0;
+    uint64_t g_submittedFrames = 0;
+    XrTime g_displayTime = 0;
+    std::map<XrSession, Session> g_sessions;
+    std::map<XrSwapchain, Swapchain> g_swapchains;
+    std::deque<XrEventDataSessionStateChanged> g_events;
+
+    const XrInstance StubInstance = (XrInstance)1;
+    constexpr XrSystemId StubSystemId = 1;
+    constexpr XrDuration DisplayPeriod = 11'111'111;
+
+    template <typename T>
+    T newHandle() {
+        return (T)++g_lastHandle;
+    }
+
+    void queueStateChange(XrSession session, XrSessionState state) {
+        XrEventDataSessionStateChanged event{XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED};
+        event.session = session;
+        event.state = state;
+        event.time = g_displayTime;
+        g_events.push_back(event);
+    }
+
+    bool isDepthFormat(DXGI_FORMAT format) {
+        return format == DXGI_FORMAT_D32_FLOAT || format == DXGI_FORMAT_D24_UNORM_S8_UINT ||
+               format == DXGI_FORMAT_D16_UNORM || format == DXGI_FORMAT_D32_FLOAT_S8X24_UINT;
+    }
+
+    XrResult XRAPI_CALL xrDestroyInstance(XrInstance instance) {
+        g_events.clear();
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrEnumerateInstanceExtensionProperties(const char* layerName,
+                                                                uint32_t propertyCapacityInput,
+                                                                uint32_t* propertyCountOutput,
+                                                                XrExtensionProperties* properties) {
+        *propertyCountOutput = 1;
+        if (propertyCapacityInput == 0) {
+            return XR_SUCCESS;
+        }
+        strncpy_s(properties[0].extensionName, XR_KHR_D3D11_ENABLE_EXTENSION_NAME, _TRUNCATE);
+        properties[0].extensionVersion = XR_KHR_D3D11_enable_SPEC_VERSION;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrGetInstanceProperties(XrInstance instance, XrInstanceProperties* instanceProperties) {
+        instanceProperties->runtimeVersion = XR_MAKE_VERSION(1, 0, 0);
+        strncpy_s(instanceProperties->runtimeName, "Stub runtime", _TRUNCATE);
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrPollEvent(XrInstance instance, XrEventDataBuffer* eventData) {
+        if (g_events.empty()) {
+            return XR_EVENT_UNAVAILABLE;
+        }
+        memcpy(eventData, &g_events.front(), sizeof(g_events.front()));
+        g_events.pop_front();
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrGetSystem(XrInstance instance, const XrSystemGetInfo* getInfo, XrSystemId* systemId) {
+        if (getInfo->formFactor != XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY) {
+            return XR_ERROR_FORM_FACTOR_UNSUPPORTED;
+        }
+        *systemId = StubSystemId;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrGetSystemProperties(XrInstance instance,
+                                              XrSystemId systemId,
+                                              XrSystemProperties* properties) {
+        properties->systemId = systemId;
+        strncpy_s(properties->systemName, "Stub system", _TRUNCATE);
+        properties->graphicsProperties.maxLayerCount = XR_MIN_COMPOSITION_LAYERS_SUPPORTED;
+        properties->graphicsProperties.maxSwapchainImageWidth = 16384;
+        properties->graphicsProperties.maxSwapchainImageHeight = 16384;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrGetD3D11GraphicsRequirementsKHR(XrInstance instance,
+                                                          XrSystemId systemId,
+                                                          XrGraphicsRequirementsD3D11KHR* graphicsRequirements) {
+        graphicsRequirements->adapterLuid = g_options.adapterLuid;
+        graphicsRequirements->minFeatureLevel = D3D_FEATURE_LEVEL_11_0;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrCreateSession(XrInstance instance,
+                                        const XrSessionCreateInfo* createInfo,
+                                        XrSession* session) {
+        const XrBaseInStructure* entry = reinterpret_cast<const XrBaseInStructure*>(createInfo->next);
+        while (entry && entry->type != XR_TYPE_GRAPHICS_BINDING_D3D11_KHR) {
+            entry = entry->next;
+        }
+        if (!entry) {
+            return XR_ERROR_GRAPHICS_DEVICE_INVALID;
+        }
+
+        Session newSession;
+        newSession.device = reinterpret_cast<const XrGraphicsBindingD3D11KHR*>(entry)->device;
+        *session = newHandle<XrSession>();
+        g_sessions.insert_or_assign(*session, std::move(newSession));
+
+        queueStateChange(*session, XR_SESSION_STATE_IDLE);
+        queueStateChange(*session, XR_SESSION_STATE_READY);
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrDestroySession(XrSession session) {
+        for (auto it = g_swapchains.begin(); it != g_swapchains.end();) {
+            it = it->second.session == session ? g_swapchains.erase(it) : std::next(it);
+        }
+        return g_sessions.erase(session) ? XR_SUCCESS : XR_ERROR_HANDLE_INVALID;
+    }
+
+    XrResult XRAPI_CALL xrBeginSession(XrSession session, const XrSessionBeginInfo* beginInfo) {
+        g_sessions[session].isRunning = true;
+        queueStateChange(session, XR_SESSION_STATE_SYNCHRONIZED);
+        queueStateChange(session, XR_SESSION_STATE_VISIBLE);
+        queueStateChange(session, XR_SESSION_STATE_FOCUSED);
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrRequestExitSession(XrSession session) {
+        queueStateChange(session, XR_SESSION_STATE_VISIBLE);
+        queueStateChange(session, XR_SESSION_STATE_SYNCHRONIZED);
+        queueStateChange(session, XR_SESSION_STATE_STOPPING);
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrEndSession(XrSession session) {
+        g_sessions[session].isRunning = false;
+        queueStateChange(session, XR_SESSION_STATE_IDLE);
+        queueStateChange(session, XR_SESSION_STATE_EXITING);
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrEnumerateSwapchainFormats(XrSession session,
+                                                    uint32_t formatCapacityInput,
+                                                    uint32_t* formatCountOutput,
+                                                    int64_t* formats) {
+        static const int64_t runtimeFormats[] = {DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,
+                                                 DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,
+                                                 DXGI_FORMAT_R8G8B8A8_UNORM,
+                                                 DXGI_FORMAT_B8G8R8A8_UNORM,
+                                                 DXGI_FORMAT_R16G16B16A16_FLOAT,
+                                                 DXGI_FORMAT_D32_FLOAT,
+                                                 DXGI_FORMAT_D24_UNORM_S8_UINT,
+                                                 DXGI_FORMAT_D16_UNORM};
+        *formatCountOutput = (uint32_t)std::size(runtimeFormats);
+        if (formatCapacityInput == 0) {
+            return XR_SUCCESS;
+        }
+        if (formatCapacityInput < *formatCountOutput) {
+            return XR_ERROR_SIZE_INSUFFICIENT;
+        }
+        std::copy(std::begin(runtimeFormats), std::end(runtimeFormats), formats);
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrCreateSwapchain(XrSession session,
+                                          const XrSwapchainCreateInfo* createInfo,
+                                          XrSwapchain* swapchain) {
+        const auto it = g_sessions.find(session);
+        if (it == g_sessions.end()) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+
+        const DXGI_FORMAT format = (DXGI_FORMAT)createInfo->format;
+        D3D11_TEXTURE2D_DESC desc{};
+        desc.Width = createInfo->width;
+        desc.Height = createInfo->height;
+        desc.ArraySize = createInfo->arraySize * createInfo->faceCount;
+        desc.MipLevels = createInfo->mipCount;
+        desc.Format = format;
+        desc.SampleDesc.Count = createInfo->sampleCount;
+        desc.Usage = D3D11_USAGE_DEFAULT;
+        desc.BindFlags = isDepthFormat(format) ? D3D11_BIND_DEPTH_STENCIL
+                                               : D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+        if (createInfo->faceCount == 6) {
+            desc.MiscFlags |= D3D11_RESOURCE_MISC_TEXTURECUBE;
+        }
+        if (g_options.shareableImages) {
+            desc.MiscFlags |= D3D11_RESOURCE_MISC_SHARED | D3D11_RESOURCE_MISC_SHARED_NTHANDLE;
+        }
+
+        Swapchain newSwapchain;
+        newSwapchain.session = session;
+        newSwapchain.images.resize(createInfo->createFlags & XR_SWAPCHAIN_CREATE_STATIC_IMAGE_BIT
+                                       ? 1
+                                       : g_options.imageCount);
+        for (auto& image : newSwapchain.images) {
+            if (FAILED(it->second.device->CreateTexture2D(&desc, nullptr, image.ReleaseAndGetAddressOf()))) {
+                return XR_ERROR_RUNTIME_FAILURE;
+            }
+        }
+
+        *swapchain = newHandle<XrSwapchain>();
+        g_swapchains.insert_or_assign(*swapchain, std::move(newSwapchain));
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrDestroySwapchain(XrSwapchain swapchain) {
+        return g_swapchains.erase(swapchain) ? XR_SUCCESS : XR_ERROR_HANDLE_INVALID;
+    }
+
+    XrResult XRAPI_CALL xrEnumerateSwapchainImages(XrSwapchain swapchain,
+                                                   uint32_t imageCapacityInput,
+                                                   uint32_t* imageCountOutput,
+                                                   XrSwapchainImageBaseHeader* images) {
+        const auto it = g_swapchains.find(swapchain);
+        if (it == g_swapchains.end()) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+
+        const auto& swapchainImages = it->second.images;
+        *imageCountOutput = (uint32_t)swapchainImages.size();
+        if (imageCapacityInput == 0) {
+            return XR_SUCCESS;
+        }
+        if (imageCapacityInput < *imageCountOutput) {
+            return XR_ERROR_SIZE_INSUFFICIENT;
+        }
+
+        XrSwapchainImageD3D11KHR* d3d11Images = reinterpret_cast<XrSwapchainImageD3D11KHR*>(images);
+        for (uint32_t i = 0; i < *imageCountOutput; i++) {
+            d3d11Images[i].texture = swapchainImages[i].Get();
+        }
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrAcquireSwapchainImage(XrSwapchain swapchain,
+                                                const XrSwapchainImageAcquireInfo* acquireInfo,
+                                                uint32_t* index) {
+        const auto it = g_swapchains.find(swapchain);
+        if (it == g_swapchains.end()) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+
+        auto& swapchainState = it->second;
+        if (swapchainState.acquiredCount == swapchainState.images.size()) {
+            return XR_ERROR_CALL_ORDER_INVALID;
+        }
+        *index = swapchainState.nextIndex;
+        swapchainState.acquiredCount++;
+        swapchainState.nextIndex = (swapchainState.nextIndex + 1) % (uint32_t)swapchainState.images.size();
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrWaitSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageWaitInfo* waitInfo) {
+        const auto it = g_swapchains.find(swapchain);
+        if (it == g_swapchains.end()) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (!it->second.acquiredCount || it->second.isWaited) {
+            return XR_ERROR_CALL_ORDER_INVALID;
+        }
+        it->second.isWaited = true;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrReleaseSwapchainImage(XrSwapchain swapchain,
+                                                const XrSwapchainImageReleaseInfo* releaseInfo) {
+        const auto it = g_swapchains.find(swapchain);
+        if (it == g_swapchains.end()) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (!it->second.isWaited) {
+            return XR_ERROR_CALL_ORDER_INVALID;
+        }
+        it->second.acquiredCount--;
+        it->second.isWaited = false;
+        it->second.hasReleasedImage = true;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrWaitFrame(XrSession session, const XrFrameWaitInfo* frameWaitInfo, XrFrameState* frameState) {
+        const auto it = g_sessions.find(session);
+        if (it == g_sessions.end()) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+        if (!it->second.isRunning) {
+            return XR_ERROR_SESSION_NOT_RUNNING;
+        }
+
+        // No pacing: the frames are only limited by the application and the layer.
+        g_displayTime += DisplayPeriod;
+        frameState->predictedDisplayTime = g_displayTime;
+        frameState->predictedDisplayPeriod = DisplayPeriod;
+        frameState->shouldRender = XR_TRUE;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrBeginFrame(XrSession session, const XrFrameBeginInfo* frameBeginInfo) {
+        return g_sessions.count(session) ? XR_SUCCESS : XR_ERROR_HANDLE_INVALID;
+    }
+
+    XrResult XRAPI_CALL xrEndFrame(XrSession session, const XrFrameEndInfo* frameEndInfo) {
+        if (!g_sessions.count(session)) {
+            return XR_ERROR_HANDLE_INVALID;
+        }
+
+        // Like a real runtime, reject the swapchains without any released image.
+        const auto checkSubImage = [](const XrSwapchainSubImage& subImage) {
+            const auto it = g_swapchains.find(subImage.swapchain);
+            return it != g_swapchains.end() && it->second.hasReleasedImage;
+        };
+        for (uint32_t i = 0; i < frameEndInfo->layerCount; i++) {
+            const XrCompositionLayerBaseHeader* layer = frameEndInfo->layers[i];
+            bool isValid = true;
+            if (layer->type == XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
+                const XrCompositionLayerProjection* projection =
+                    reinterpret_cast<const XrCompositionLayerProjection*>(layer);
+                for (uint32_t view = 0; view < projection->viewCount; view++) {
+                    isValid = isValid && checkSubImage(projection->views[view].subImage);
+                }
+            } else if (layer->type == XR_TYPE_COMPOSITION_LAYER_QUAD) {
+                isValid = checkSubImage(reinterpret_cast<const XrCompositionLayerQuad*>(layer)->subImage);
+            }
+            if (!isValid) {
+                return XR_ERROR_LAYER_INVALID;
+            }
+        }
+
+        g_submittedFrames++;
+        return XR_SUCCESS;
+    }
+
+} // namespace
+
+namespace stub_runtime {
+
+    void SetOptions(const Options& options) {
+        g_options = options;
+    }
+
+    uint64_t GetSubmittedFrames() {
+        return g_submittedFrames;
+    }
+
+    XrResult XRAPI_CALL xrGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function) {
+        static const std::map<std::string_view, PFN_xrVoidFunction> functions = {
+#define STUB_FUNCTION(name) {#name, reinterpret_cast<PFN_xrVoidFunction>(::name)}
+            {"xrGetInstanceProcAddr", reinterpret_cast<PFN_xrVoidFunction>(stub_runtime::xrGetInstanceProcAddr)},
+            STUB_FUNCTION(xrDestroyInstance),
+            STUB_FUNCTION(xrEnumerateInstanceExtensionProperties),
+            STUB_FUNCTION(xrGetInstanceProperties),
+            STUB_FUNCTION(xrPollEvent),
+            STUB_FUNCTION(xrGetSystem),
+            STUB_FUNCTION(xrGetSystemProperties),
+            STUB_FUNCTION(xrGetD3D11GraphicsRequirementsKHR),
+            STUB_FUNCTION(xrCreateSession),
+            STUB_FUNCTION(xrDestroySession),
+            STUB_FUNCTION(xrBeginSession),
+            STUB_FUNCTION(xrRequestExitSession),
+            STUB_FUNCTION(xrEndSession),
+            STUB_FUNCTION(xrEnumerateSwapchainFormats),
+            STUB_FUNCTION(xrCreateSwapchain),
+            STUB_FUNCTION(xrDestroySwapchain),
+            STUB_FUNCTION(xrEnumerateSwapchainImages),
+            STUB_FUNCTION(xrAcquireSwapchainImage),
+            STUB_FUNCTION(xrWaitSwapchainImage),
+            STUB_FUNCTION(xrReleaseSwapchainImage),
+            STUB_FUNCTION(xrWaitFrame),
+            STUB_FUNCTION(xrBeginFrame),
+            STUB_FUNCTION(xrEndFrame),
+#undef STUB_FUNCTION
+        };
+
+        const auto it = functions.find(name);
+        if (it == functions.cend()) {
+            *function = nullptr;
+            return XR_ERROR_FUNCTION_UNSUPPORTED;
+        }
+        *function = it->second;
+        return XR_SUCCESS;
+    }
+
+    XrResult XRAPI_CALL xrCreateApiLayerInstance(const XrInstanceCreateInfo* createInfo,
+                                                 const XrApiLayerCreateInfo* apiLayerInfo,
+                                                 XrInstance* instance) {
+        g_lastHandle = 0;
+        g_submittedFrames = 0;
+        g_displayTime = 0;
+        g_sessions.clear();
+        g_swapchains.clear();
+        g_events.clear();
+
+        *instance = StubInstance;
+        return XR_SUCCESS;
+    }
+
+} // namespace stub_runtime
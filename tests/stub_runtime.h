@@ -0,0 +1,55 @@
+// MIT License
+//
+// Copyright(c) 2022 Matthieu Bucchianeri
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this softwareand associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright noticeand this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "pch.h"
+
+// A minimal OpenXR runtime with Direct3D 11 sessions, used to drive the layer without a headset or a real runtime. It
+// creates the swapchain images on the device given by the layer, emits the session state changes, and does not pace
+// the frames. It is not thread-safe.
+namespace stub_runtime {
+
+    struct Options {
+        // The adapter returned by xrGetD3D11GraphicsRequirementsKHR().
+        LUID adapterLuid{};
+
+        // The number of images in each swapchain.
+        uint32_t imageCount{3};
+
+        // Whether the swapchain images can be shared with the application's device. When they cannot (like with most
+        // runtimes), the layer copies from intermediate textures.
+        bool shareableImages{false};
+    };
+
+    void SetOptions(const Options& options);
+
+    // The number of frames submitted with xrEndFrame() since the creation of the instance.
+    uint64_t GetSubmittedFrames();
+
+    // The entry points to pass to the layer in XrApiLayerNextInfo.
+    XrResult XRAPI_CALL xrGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function);
+    XrResult XRAPI_CALL xrCreateApiLayerInstance(const XrInstanceCreateInfo* createInfo,
+                                                 const XrApiLayerCreateInfo* apiLayerInfo,
+                                                 XrInstance* instance);
+
+} // namespace stub_runtime